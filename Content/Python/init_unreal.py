@@ -9,79 +9,119 @@ import openpyxl
 import json
 import pm_xlsx_field_parser as fp
 import pm_xlsx_parser as xlsx_parser
+import pm_xlsx_columnar as columnar
 from importlib import *
 
 reload(xlsx_parser)
 reload(fp)
+reload(columnar)
+
+
+def read_worksheet_asset_names(absolute_file_path, worksheet_name, header_row, data_start_row):
+    result = unreal.PMXlsxImporterPythonBridgeAssetNames()
+    try:
+        workbook = xlsx_parser.load_workbook(absolute_file_path)
+        worksheet = workbook[worksheet_name]
+
+        asset_names = []
+
+        for row in worksheet.iter_rows(min_row=data_start_row):
+            name_cell = row[0]  # Name should always be the first column
+            if not name_cell.value or str(name_cell.value).isspace():
+                break  # not valid since this row
+            asset_names.append(str(name_cell.value))
+
+        result.asset_names = asset_names
+    except (ValueError, Exception) as ex:
+        result.error = traceback.format_exc()
+    finally:
+        return result
+
+
+def read_worksheet_as_json(absolute_file_path, worksheet_name, header_row, data_start_row, worksheet_type_info):
+    result = unreal.PMXlsxImporterPythonBridgeJsonString()
+    try:
+        parser = xlsx_parser.PMXlsxParser(absolute_file_path, worksheet_name, worksheet_type_info)
+
+        # parse header row
+        parser.parse_header_row(header_row)
+
+        # parse data rows
+        data_list = parser.parse_data(data_start_row)
+
+        # convert data to json string. Debug copies in Intermediate/XlsxJsonFiles are written by C++, see
+        # UPMXlsxImporterSettings::JsonDebugDump
+        result.json_string = json.dumps(data_list)
+
+    except fp.ValidationError as ex:
+        result.error = str(ex)
+    except Exception as ex:
+        # handle all other exceptions
+        result.error = traceback.format_exc()
+    finally:
+        return result
+
+
+def read_worksheet_as_binary(absolute_file_path, worksheet_name, header_row, data_start_row, worksheet_type_info):
+    result = unreal.PMXlsxImporterPythonBridgeJsonString()
+    try:
+        parser = xlsx_parser.PMXlsxParser(absolute_file_path, worksheet_name, worksheet_type_info)
+        parser.parse_header_row(header_row)
+        data_list = parser.parse_data(data_start_row)
+
+        # typed columns and a string table instead of a json string, see pm_xlsx_columnar.py
+        column_names = [field_parser.get_field_name() for field_parser in parser.field_parsers]
+        result.binary_data = columnar.encode(column_names, data_list)
+
+    except fp.ValidationError as ex:
+        result.error = str(ex)
+    except Exception as ex:
+        # handle all other exceptions
+        result.error = traceback.format_exc()
+    finally:
+        return result
 
 
 @unreal.uclass()
 class PMXlsxImporterPythonBridgeImpl(unreal.PMXlsxImporterPythonBridge):
 
+    @unreal.ufunction(override=True)
+    def begin_import_run(self):
+        xlsx_parser.begin_workbook_cache()
+
+    @unreal.ufunction(override=True)
+    def end_import_run(self):
+        xlsx_parser.end_workbook_cache()
+
     @unreal.ufunction(override=True)
     def read_worksheet_names(self, absolute_file_path):
         unreal.log("Reading xlsx file \"{0}\"".format(absolute_file_path))
 
-        with open(absolute_file_path, "rb") as f:
-            in_mem_file = io.BytesIO(f.read())
-        workbook = openpyxl.load_workbook(in_mem_file, read_only=True, data_only=True)
+        workbook = xlsx_parser.load_workbook(absolute_file_path)
         unreal.log("All sheet names: {0}".format(workbook.sheetnames))
         return workbook.sheetnames
 
     @unreal.ufunction(override=True)
     def read_worksheet_asset_names(self, absolute_file_path, worksheet_name, header_row, data_start_row):
-        result = unreal.PMXlsxImporterPythonBridgeAssetNames()
-        try:
-            with open(absolute_file_path, "rb") as f:
-                in_mem_file = io.BytesIO(f.read())
-            workbook = openpyxl.load_workbook(in_mem_file, read_only=True, data_only=True)
-            worksheet = workbook[worksheet_name]
-
-            asset_names = []
-
-            for row in worksheet.iter_rows(min_row=data_start_row):
-                name_cell = row[0]  # Name should always be the first column
-                if not name_cell.value or str(name_cell.value).isspace():
-                    break  # not valid since this row
-                asset_names.append(str(name_cell.value))
-
-            result.asset_names = asset_names
-        except (ValueError, Exception) as ex:
-            result.error = traceback.format_exc()
-        finally:
-            return result
+        return read_worksheet_asset_names(absolute_file_path, worksheet_name, header_row, data_start_row)
 
     @unreal.ufunction(override=True)
     def read_worksheet_as_json(self, absolute_file_path, worksheet_name, header_row, data_start_row,
                                worksheet_type_info):
-        result = unreal.PMXlsxImporterPythonBridgeJsonString()
-        try:
-            parser = xlsx_parser.PMXlsxParser(absolute_file_path, worksheet_name, worksheet_type_info)
-
-            # parse header row
-            parser.parse_header_row(header_row)
-
-            # parse data rows
-            data_list = parser.parse_data(data_start_row)
-
-            # convert data to json string
-            json_string = json.dumps(data_list, indent=4)
-
-            # write json string to Intermediate folder for debug purpose
-            json_parent_dir = Path(absolute_file_path).stem
-            json_file_name = worksheet_name + '.json'
-            json_output_file = Path(os.path.join(
-                unreal.Paths.convert_relative_path_to_full(unreal.Paths.project_intermediate_dir()), 'XlsxJsonFiles',
-                json_parent_dir, json_file_name))
-            json_output_file.parent.mkdir(exist_ok=True, parents=True)
-            json_output_file.write_text(json_string)
-
-            result.json_string = json_string
-
-        except fp.ValidationError as ex:
-            result.error = str(ex)
-        except Exception as ex:
-            # handle all other exceptions
-            result.error = traceback.format_exc()
-        finally:
-            return result
+        return read_worksheet_as_json(absolute_file_path, worksheet_name, header_row, data_start_row,
+                                      worksheet_type_info)
+
+    @unreal.ufunction(override=True)
+    def read_worksheets(self, absolute_file_path, requests):
+        # reads all requested worksheets of a file in one call from C++
+        results = []
+        for request in requests:
+            result = unreal.PMXlsxImporterPythonBridgeWorksheetResult()
+            result.worksheet_name = request.worksheet_name
+            result.asset_names = read_worksheet_asset_names(absolute_file_path, request.worksheet_name,
+                                                            request.header_row, request.data_start_row)
+            read_worksheet = read_worksheet_as_json if request.use_json else read_worksheet_as_binary
+            result.json_string = read_worksheet(absolute_file_path, request.worksheet_name, request.header_row,
+                                                request.data_start_row, request.worksheet_type_info)
+            results.append(result)
+        return results
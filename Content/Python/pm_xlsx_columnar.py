@@ -0,0 +1,90 @@
+# Copyright 2022 Tianqi Li.
+
+# Encodes parsed worksheet rows in the compact binary format read by FPMXlsxWorksheetData, see PMXlsxWorksheetData.h
+# for the layout. Much smaller and faster to produce and read than the same rows as json.
+
+import base64
+import json
+import struct
+
+MAGIC = b"PMXB"
+VERSION = 1
+
+COLUMN_NUMBER = 0
+COLUMN_BOOL = 1
+COLUMN_VARIANT = 2
+
+VALUE_NULL = 0
+VALUE_FALSE = 1
+VALUE_TRUE = 2
+VALUE_NUMBER = 3
+VALUE_STRING = 4
+VALUE_JSON = 5
+
+
+def _is_number(value):
+    return type(value) is int or type(value) is float
+
+
+class _StringTable:
+    def __init__(self):
+        self.strings = []
+        self.indices = {}
+
+    def add(self, string):
+        index = self.indices.get(string)
+        if index is None:
+            index = len(self.strings)
+            self.indices[string] = index
+            self.strings.append(string)
+        return index
+
+
+def _column_type(values):
+    if all(type(value) is bool for value in values):
+        return COLUMN_BOOL
+    if all(_is_number(value) for value in values):
+        return COLUMN_NUMBER
+    return COLUMN_VARIANT
+
+
+def _encode_variant(value, strings: _StringTable):
+    if value is None:
+        return struct.pack("<B", VALUE_NULL)
+    if type(value) is bool:
+        return struct.pack("<B", VALUE_TRUE if value else VALUE_FALSE)
+    if _is_number(value):
+        return struct.pack("<Bd", VALUE_NUMBER, value)
+    if isinstance(value, str):
+        return struct.pack("<BI", VALUE_STRING, strings.add(value))
+    return struct.pack("<BI", VALUE_JSON, strings.add(json.dumps(value, separators=(",", ":"))))
+
+
+def encode(column_names, rows):
+    """
+    :param column_names: top field names, in the order of the worksheet's columns
+    :param rows: dicts keyed by column name, as returned by PMXlsxParser.parse_data
+    :return: the encoded rows as a base64 string
+    """
+    strings = _StringTable()
+    columns = bytearray()
+    for column_name in column_names:
+        values = [row.get(column_name) for row in rows]
+        column_type = _column_type(values)
+        columns += struct.pack("<IB", strings.add(column_name), column_type)
+        if column_type == COLUMN_NUMBER:
+            columns += struct.pack("<{0}d".format(len(values)), *values)
+        elif column_type == COLUMN_BOOL:
+            columns += bytes(1 if value else 0 for value in values)
+        else:
+            for value in values:
+                columns += _encode_variant(value, strings)
+
+    data = bytearray(MAGIC)
+    data += struct.pack("<IIII", VERSION, len(rows), len(column_names), len(strings.strings))
+    for string in strings.strings:
+        encoded_string = string.encode("utf-8")
+        data += struct.pack("<I", len(encoded_string))
+        data += encoded_string
+    data += columns
+    return base64.b64encode(bytes(data)).decode("ascii")
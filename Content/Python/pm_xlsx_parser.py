@@ -12,6 +12,43 @@ from importlib import *
 
 reload(fp)
 
+# workbooks opened during the current import run, keyed by absolute path. None if no import is running.
+_workbook_cache = None
+
+
+def begin_workbook_cache():
+    global _workbook_cache
+    end_workbook_cache()
+    _workbook_cache = {}
+
+
+def end_workbook_cache():
+    global _workbook_cache
+    if _workbook_cache is not None:
+        for _, _, workbook in _workbook_cache.values():
+            workbook.close()
+    _workbook_cache = None
+
+
+def load_workbook(absolute_file_path):
+    """
+    Opens a workbook in read only mode. During an import run the workbook is cached and only reopened if
+    the file's modification time or size changed.
+    """
+    stat = os.stat(absolute_file_path)
+    if _workbook_cache is not None:
+        cached = _workbook_cache.get(absolute_file_path)
+        if cached is not None and cached[0] == stat.st_mtime_ns and cached[1] == stat.st_size:
+            return cached[2]
+
+    with open(absolute_file_path, "rb") as f:
+        in_mem_file = io.BytesIO(f.read())
+    workbook = openpyxl.load_workbook(in_mem_file, read_only=True, data_only=True)
+
+    if _workbook_cache is not None:
+        _workbook_cache[absolute_file_path] = (stat.st_mtime_ns, stat.st_size, workbook)
+    return workbook
+
 
 class PMXlsxParser:
     def __init__(self, absolute_file_path, worksheet_name, worksheet_type_info: unreal.PMXlsxWorksheetTypeInfo):
@@ -21,9 +58,7 @@ class PMXlsxParser:
         self.worksheet_type_info = worksheet_type_info
         self.field_parsers: List[fp.PMXlsxFieldParser] = []
 
-        with open(self.absolute_file_path, "rb") as f:
-            in_mem_file = io.BytesIO(f.read())
-        workbook = openpyxl.load_workbook(in_mem_file, read_only=True, data_only=True)
+        workbook = load_workbook(self.absolute_file_path)
         self.worksheet = workbook[self.worksheet_name]
 
     def parse_header_row(self, header_row_index):
@@ -33,7 +68,10 @@ class PMXlsxParser:
                        format(self.file_name, self.worksheet_name, field.index, field.name_cpp, field.type,
                               field.cpp_type, field.element_type))
 
-        row = list(self.worksheet.rows)[header_row_index - 1]
+        row = next(self.worksheet.iter_rows(min_row=header_row_index, max_row=header_row_index), None)
+        if row is None:
+            raise fp.ValidationError("header row {0} does not exist".format(header_row_index),
+                                     None, None, self.file_name, self.worksheet_name)
 
         # should have at least one data row
         # if len(worksheet.rows) < header_row_index + 1:
@@ -66,9 +104,8 @@ class PMXlsxParser:
                               field_parser.start_column_index, field_parser.end_column_index - 1))
             self.field_parsers.append(field_parser)
 
-    def __parse_data_row(self, row_index):
+    def __parse_data_row(self, row, row_index):
         result = {}
-        row = list(self.worksheet.rows)[row_index - 1]
         column_index = 0
         for field_parser in self.field_parsers:
             try:
@@ -86,11 +123,10 @@ class PMXlsxParser:
 
     def parse_data(self, start_row):
         result_array = []
-        row_index = start_row
-        for row in self.worksheet.iter_rows(min_row=start_row):
+        # parse each row as iter_rows yields it, so the worksheet is only read once
+        for row_index, row in enumerate(self.worksheet.iter_rows(min_row=start_row), start_row):
             if not row[0].value or str(row[0].value).isspace():
                 break  # not valid since this row
-            row_dict = self.__parse_data_row(row_index)
+            row_dict = self.__parse_data_row(row, row_index)
             result_array.append(row_dict)
-            row_index += 1
         return result_array
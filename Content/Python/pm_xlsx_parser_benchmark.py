@@ -0,0 +1,104 @@
+# Copyright 2022 Tianqi Li.
+
+# Regression benchmark for PMXlsxParser. Run it inside Unreal Editor from the Output Log's Python console:
+#
+#     py pm_xlsx_parser_benchmark.py
+#
+# It generates worksheets of increasing size and checks that the parse time per row stays flat, i.e. that
+# PMXlsxParser reads a worksheet only once no matter how many rows it has.
+
+import unreal
+import os
+import tempfile
+import time
+import openpyxl
+import pm_xlsx_parser as xlsx_parser
+from importlib import *
+
+reload(xlsx_parser)
+
+ROW_COUNTS = [1000, 10000, 100000]
+
+# time per row of the biggest worksheet may be at most this many times the time per row of the smallest one
+MAX_TIME_PER_ROW_RATIO = 2.0
+
+WORKSHEET_NAME = "Benchmark"
+HEADER_ROW = 1
+DATA_START_ROW = 2
+
+FIELDS = [
+    ("Name", unreal.PMXlsxFieldType.OTHERS, "FString"),
+    ("IntValue", unreal.PMXlsxFieldType.NUMERIC, "int32"),
+    ("FloatValue", unreal.PMXlsxFieldType.NUMERIC, "float"),
+    ("BoolValue", unreal.PMXlsxFieldType.BOOL, "bool"),
+    ("StringValue", unreal.PMXlsxFieldType.OTHERS, "FString"),
+]
+
+
+def make_worksheet_type_info():
+    all_fields = []
+    for index, (name, field_type, cpp_type) in enumerate(FIELDS):
+        field = unreal.PMXlsxFieldTypeInfo()
+        field.name_cpp = name
+        field.type = field_type
+        field.cpp_type = cpp_type
+        field.index = index
+        field.parent_index = -1
+        all_fields.append(field)
+
+    worksheet_type_info = unreal.PMXlsxWorksheetTypeInfo()
+    worksheet_type_info.all_fields = all_fields
+    worksheet_type_info.top_fields = list(range(len(FIELDS)))
+    return worksheet_type_info
+
+
+def write_workbook(file_path, row_count):
+    workbook = openpyxl.Workbook(write_only=True)
+    worksheet = workbook.create_sheet(WORKSHEET_NAME)
+    worksheet.append([name for name, _, _ in FIELDS])
+    for index in range(row_count):
+        worksheet.append(["Asset_{0}".format(index), index, index * 0.5, index % 2 == 0, "text {0}".format(index)])
+    workbook.save(file_path)
+
+
+def parse_workbook(file_path, worksheet_type_info):
+    start_time = time.perf_counter()
+    parser = xlsx_parser.PMXlsxParser(file_path, WORKSHEET_NAME, worksheet_type_info)
+    parser.parse_header_row(HEADER_ROW)
+    data_list = parser.parse_data(DATA_START_ROW)
+    return time.perf_counter() - start_time, len(data_list)
+
+
+def run():
+    worksheet_type_info = make_worksheet_type_info()
+    time_per_row = {}
+
+    with tempfile.TemporaryDirectory() as temp_dir:
+        for row_count in ROW_COUNTS:
+            file_path = os.path.join(temp_dir, "benchmark_{0}.xlsx".format(row_count))
+            write_workbook(file_path, row_count)
+
+            seconds, parsed_row_count = parse_workbook(file_path, worksheet_type_info)
+            if parsed_row_count != row_count:
+                unreal.log_error("PMXlsxParser benchmark: parsed {0} rows, expect {1}".format(parsed_row_count,
+                                                                                              row_count))
+                return False
+
+            time_per_row[row_count] = seconds / row_count
+            unreal.log("PMXlsxParser benchmark: {0} rows in {1:.3f}s, {2:.2f}us per row".
+                       format(row_count, seconds, time_per_row[row_count] * 1000000))
+
+    ratio = time_per_row[ROW_COUNTS[-1]] / time_per_row[ROW_COUNTS[0]]
+    if ratio > MAX_TIME_PER_ROW_RATIO:
+        unreal.log_error("PMXlsxParser benchmark failed: time per row grew {0:.2f}x from {1} to {2} rows, "
+                         "expect at most {3:.2f}x".format(ratio, ROW_COUNTS[0], ROW_COUNTS[-1],
+                                                          MAX_TIME_PER_ROW_RATIO))
+        return False
+
+    unreal.log("PMXlsxParser benchmark passed: time per row grew {0:.2f}x from {1} to {2} rows".
+               format(ratio, ROW_COUNTS[0], ROW_COUNTS[-1]))
+    return True
+
+
+if __name__ == "__main__":
+    run()
@@ -54,6 +54,8 @@ public class PMXlsxImporter : ModuleRules
 				"UMGEditor",
 				"SourceControl",
 				"Json",
+				"AssetRegistry",
+				"GameplayTags",
 				// ... add private dependencies that you statically link with here ...	
 			}
             );
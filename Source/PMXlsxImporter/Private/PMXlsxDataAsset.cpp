@@ -6,71 +6,310 @@
 #include "Misc/DefaultValueHelper.h"
 #include "PMXlsxImporterLog.h"
 #include "Engine/AssetManager.h"
-#include "EditorAssetLibrary.h"
+#include "PMXlsxImporterRunContext.h"
 #include "PMXlsxImporterSettings.h"
 #include "PMXlsxMetadata.h"
-#include "Exporters/Exporter.h"
-#include "UnrealExporter.h"
+#include "Serialization/MemoryWriter.h"
 
 static const TCHAR* const TRUE_TEXT = TEXT("TRUE");
 static const TCHAR* const FALSE_TEXT = TEXT("FALSE");
 
 #ifdef WITH_EDITOR
+// One snapshot per thread is reused for every imported asset so that its buffer doesn't have to be reallocated
+static FPMXlsxDataAssetSnapshot& GetScratchSnapshot()
+{
+	static thread_local FPMXlsxDataAssetSnapshot Snapshot;
+	return Snapshot;
+}
+
+FPMXlsxDataAssetSnapshot::~FPMXlsxDataAssetSnapshot()
+{
+	Reset();
+}
+
+void FPMXlsxDataAssetSnapshot::Take(const UPMXlsxDataAsset& InAsset)
+{
+	Reset();
+	Asset = &InAsset;
+
+	const UClass* Class = InAsset.GetClass();
+	if (Class != LayoutClass)
+	{
+		LayoutClass = Class;
+		Copies.Reset();
+		BufferSize = 0;
+		for (TFieldIterator<FProperty> PropertyIterator(Class, EFieldIteratorFlags::IncludeSuper); PropertyIterator; ++PropertyIterator)
+		{
+			const FProperty* Property = *PropertyIterator;
+			if (!Property->HasMetaData(FPMXlsxMetadata::IMPORT_FROM_XLSX_METADATA_TAG) &&
+				Property->GetFName() != GET_MEMBER_NAME_CHECKED(UPMXlsxDataAsset, XlsxRowHash))
+			{
+				continue;
+			}
+
+			BufferSize = Align(BufferSize, FMath::Min(Property->GetMinAlignment(), 16));
+			Copies.Add({ Property, BufferSize });
+			BufferSize += Property->GetSize();
+		}
+	}
+
+	// Size the buffer before copying anything into it, since values must not be moved once they are constructed
+	if (Buffer.Num() < BufferSize)
+	{
+		Buffer.SetNumUninitialized(BufferSize);
+	}
+
+	for (const FPropertyCopy& Copy : Copies)
+	{
+		uint8* Dest = Buffer.GetData() + Copy.Offset;
+		Copy.Property->InitializeValue(Dest);
+		Copy.Property->CopyCompleteValue(Dest, Copy.Property->ContainerPtrToValuePtr<void>(&InAsset));
+	}
+	bHasCopies = true;
+
+	// Saving only reads the asset
+	FMemoryWriter ExtraStateWriter(ExtraState);
+	const_cast<UPMXlsxDataAsset&>(InAsset).SerializeExtraImportState(ExtraStateWriter);
+}
+
+void FPMXlsxDataAssetSnapshot::Reset()
+{
+	if (bHasCopies)
+	{
+		for (const FPropertyCopy& Copy : Copies)
+		{
+			Copy.Property->DestroyValue(Buffer.GetData() + Copy.Offset);
+		}
+		bHasCopies = false;
+	}
+	ExtraState.Reset();
+	Asset = nullptr;
+}
+
+const FProperty* FPMXlsxDataAssetSnapshot::FindModifiedProperty(const UPMXlsxDataAsset& InAsset) const
+{
+	check(bHasCopies && InAsset.GetClass() == LayoutClass);
+
+	for (const FPropertyCopy& Copy : Copies)
+	{
+		const FProperty* Property = Copy.Property;
+		for (int32 ArrayIndex = 0; ArrayIndex < Property->ArrayDim; ++ArrayIndex)
+		{
+			const void* Original = Buffer.GetData() + Copy.Offset + ArrayIndex * Property->ElementSize;
+			if (!Property->Identical(Original, Property->ContainerPtrToValuePtr<void>(&InAsset, ArrayIndex), PPF_None))
+			{
+				return Property;
+			}
+		}
+	}
+	return nullptr;
+}
+
+bool FPMXlsxDataAssetSnapshot::WasExtraStateModified(const UPMXlsxDataAsset& InAsset) const
+{
+	check(bHasCopies);
+
+	ComparedExtraState.Reset();
+	FMemoryWriter ExtraStateWriter(ComparedExtraState);
+	const_cast<UPMXlsxDataAsset&>(InAsset).SerializeExtraImportState(ExtraStateWriter);
+	return ComparedExtraState != ExtraState;
+}
+
+FPMXlsxDataAssetStagedRow::~FPMXlsxDataAssetStagedRow()
+{
+	Reset();
+}
+
+void FPMXlsxDataAssetStagedRow::Read(UPMXlsxDataAsset& Asset, const FPMXlsxWorksheetData& WorksheetData, int32 RowIndex, const FPMXlsxColumnBindings& ColumnBindings)
+{
+	Reset();
+
+	// The buffer is laid out like an instance of the class, so that the importer can use the class's property offsets
+	Class = Asset.GetClass();
+	Buffer.SetNumUninitialized(Class->GetPropertiesSize());
+	Class->InitializeStruct(Buffer.GetData());
+
+	bWasRead = FPMXlsxDataAssetImporterJSON(Asset, WorksheetData, RowIndex, ColumnBindings, Problems).ReadAssetInto(Buffer.GetData(), ReadProperties);
+}
+
+void FPMXlsxDataAssetStagedRow::Reset()
+{
+	if (Class)
+	{
+		Class->DestroyStruct(Buffer.GetData());
+		Class = nullptr;
+	}
+	ReadProperties.Reset();
+	Problems.Reset();
+	bWasRead = false;
+}
+
+bool FPMXlsxDataAssetStagedRow::CopyTo(UPMXlsxDataAsset& Asset) const
+{
+	check(Asset.GetClass() == Class || Class == nullptr);
+
+	for (const FProperty* Property : ReadProperties)
+	{
+		Property->CopyCompleteValue_InContainer(&Asset, Buffer.GetData());
+	}
+	return bWasRead;
+}
+
+namespace
+{
+	bool CanReadPropertyInParallel(const FProperty* Property, TSet<const UStruct*>& VisitedStructs);
+
+	bool CanReadStructInParallel(const UStruct* Struct, TSet<const UStruct*>& VisitedStructs)
+	{
+		bool bAlreadyVisited = false;
+		VisitedStructs.Add(Struct, &bAlreadyVisited);
+		if (bAlreadyVisited)
+		{
+			return true;
+		}
+
+		for (TFieldIterator<FProperty> PropertyIterator(Struct, EFieldIteratorFlags::IncludeSuper); PropertyIterator; ++PropertyIterator)
+		{
+			if (!CanReadPropertyInParallel(*PropertyIterator, VisitedStructs))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool CanReadPropertyInParallel(const FProperty* Property, TSet<const UStruct*>& VisitedStructs)
+	{
+		// Importing a hard reference finds or loads the referenced object, which only works on the game thread. Soft references are just paths.
+		if ((Property->IsA<FObjectPropertyBase>() && !Property->IsA<FSoftObjectProperty>()) || Property->IsA<FInterfaceProperty>())
+		{
+			return false;
+		}
+		if (const FStructProperty* StructProperty = CastField<FStructProperty>(Property))
+		{
+			return CanReadStructInParallel(StructProperty->Struct, VisitedStructs);
+		}
+		if (const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(Property))
+		{
+			return CanReadPropertyInParallel(ArrayProperty->Inner, VisitedStructs);
+		}
+		if (const FSetProperty* SetProperty = CastField<FSetProperty>(Property))
+		{
+			return CanReadPropertyInParallel(SetProperty->ElementProp, VisitedStructs);
+		}
+		if (const FMapProperty* MapProperty = CastField<FMapProperty>(Property))
+		{
+			return CanReadPropertyInParallel(MapProperty->KeyProp, VisitedStructs) && CanReadPropertyInParallel(MapProperty->ValueProp, VisitedStructs);
+		}
+		return true;
+	}
+}
+
+bool FPMXlsxDataAssetStagedRow::CanReadInParallel(const UClass& Class)
+{
+	// The answer only depends on the class, so cache it for the session
+	static TMap<TWeakObjectPtr<const UClass>, bool> CachedResults;
+	if (const bool* CachedResult = CachedResults.Find(&Class))
+	{
+		return *CachedResult;
+	}
+
+	TSet<const UStruct*> VisitedStructs;
+	const bool bResult = CanReadStructInParallel(&Class, VisitedStructs);
+	CachedResults.Add(&Class, bResult);
+	return bResult;
+}
+
 UPMXlsxDataAsset::UPMXlsxDataAsset()
 {
 	bIgnoreExtraFields = false;
 	bIgnoreMissingFields = false;
 }
 
-void UPMXlsxDataAsset::ImportFromXLSX(const TSharedRef<FJsonObject>& JsonData, FPMXlsxImporterContextLogger& InOutErrors)
+void UPMXlsxDataAsset::ImportFromXLSX(const TSharedRef<FJsonObject>& JsonData, FPMXlsxImporterContextLogger& InOutErrors, const FString& RowHash)
 {
-	auto ScopedErrorContext = InOutErrors.PushContext(FString::Printf(TEXT(": %s %s"), *GetClass()->GetName(), *GetName()));
+	auto ScopedErrorContext = InOutErrors.PushObjectContext(*this);
+	PendingXlsxRowHash = RowHash;
 	ImportFromXLSXImpl(JsonData, InOutErrors);
+	PendingXlsxRowHash.Reset();
 }
 
 void UPMXlsxDataAsset::ImportFromXLSXImpl(const TSharedRef<FJsonObject>& JsonData, FPMXlsxImporterContextLogger& InOutErrors)
 {
 	UE_LOG(LogPMXlsxImporter, VeryVerbose, TEXT("Importing data from python to %s %s"), *GetClass()->GetName(), *GetName());
 
-	// Keep a copy around to see if anything actually gets changed.
+	// Keep a copy of the imported properties around to see if anything actually gets changed.
 	// It would be more accurate to pull Original from what's currently checked into source control,
 	// but that would be very slow.
-	UPMXlsxDataAsset* Original = DuplicateObject(this, nullptr, GetFName());
+	FPMXlsxDataAssetSnapshot& Original = GetScratchSnapshot();
+	Original.Take(*this);
+
+	// Importing marks the package dirty. If it already was, e.g. because a failed import run modified this without saving, it still needs a save.
+	const bool bWasDirty = GetOutermost()->IsDirty();
 
 	TArray<FString> OutProblems;
 	FPMXlsxDataAssetImporterJSON(*this, JsonData, OutProblems).ReadAsset();
 
-	for (FString Problem : OutProblems)
+	FinishImport(Original, bWasDirty, OutProblems, InOutErrors);
+}
+
+void UPMXlsxDataAsset::ImportFromStagedRow(const FPMXlsxDataAssetStagedRow& Row, FPMXlsxImporterContextLogger& InOutErrors, const FString& RowHash)
+{
+	auto ScopedErrorContext = InOutErrors.PushObjectContext(*this);
+	UE_LOG(LogPMXlsxImporter, VeryVerbose, TEXT("Importing staged data to %s %s"), *GetClass()->GetName(), *GetName());
+
+	FPMXlsxDataAssetSnapshot& Original = GetScratchSnapshot();
+	Original.Take(*this);
+
+	const bool bWasDirty = GetOutermost()->IsDirty();
+
+	if (Row.CopyTo(*this))
+	{
+		Modify(true);
+	}
+
+	PendingXlsxRowHash = RowHash;
+	FinishImport(Original, bWasDirty, Row.GetProblems(), InOutErrors);
+	PendingXlsxRowHash.Reset();
+}
+
+bool UPMXlsxDataAsset::SupportsParallelImport() const
+{
+	return false;
+}
+
+bool UPMXlsxDataAsset::CanImportInParallel() const
+{
+	return SupportsParallelImport() && FPMXlsxDataAssetStagedRow::CanReadInParallel(*GetClass());
+}
+
+void UPMXlsxDataAsset::FinishImport(FPMXlsxDataAssetSnapshot& Original, bool bWasDirty, const TArray<FString>& Problems, FPMXlsxImporterContextLogger& InOutErrors)
+{
+	for (const FString& Problem : Problems)
 	{
 		InOutErrors.Logf(TEXT("%s"), *Problem);
 	}
 
+	// Set before WasModified so that a new hash gets saved even if the row's changes don't change any property
+	if (Problems.Num() == 0 && !PendingXlsxRowHash.IsEmpty())
+	{
+		XlsxRowHash = PendingXlsxRowHash;
+	}
+
 	// Telling Unreal to save a file guarantees the file becomes modified even if there aren't meaningful changes to
 	// that file's data. We only want to check out and save modified assets.
-	if (WasModified(Original))
+	const bool bWasModified = WasModified(Original);
+	Original.Reset();
+	if (bWasModified || bWasDirty)
 	{
-		const UPMXlsxImporterSettings* SettingsCDO = GetDefault<UPMXlsxImporterSettings>();
-		if (SettingsCDO->bCheckoutGeneratedAssets && !UEditorAssetLibrary::CheckoutLoadedAsset(this))
-		{
-			// CheckoutLoadedAsset will print its own errors, but we want to add one here so that we can
-			// properly track if the run as a whole succeeded or not.
-			InOutErrors.Logf(TEXT("Unable to checkout asset %s"), *GetName());
-			return;
-		}
-		// No reason to mark the package as dirty. We know we need to save right now.
-		if (!UEditorAssetLibrary::SaveLoadedAsset(this, /*bOnlyIfIsDirty:*/ false))
-		{
-			// SaveLoadedAsset will print its own errors, but we want to add one here so that we can
-			// properly track if the run as a whole succeeded or not.
-			InOutErrors.Logf(TEXT("Unable to save asset %s"), *GetName());
-			return;
-		}
+		// Saved at the end of the import run, together with all other modified assets
+		FPMXlsxImporterRunContext::SaveModifiedAsset(this, InOutErrors);
 	}
 }
 
 void UPMXlsxDataAsset::Validate(const UPMXlsxDataAsset* Previous, FPMXlsxImporterContextLogger& InOutErrors) const
 {
-	auto ScopedErrorContext = InOutErrors.PushContext(FString::Printf(TEXT(": %s %s"), *GetClass()->GetName(), *GetName()));
+	auto ScopedErrorContext = InOutErrors.PushObjectContext(*this);
 
 	ValidateImpl(InOutErrors);
 	ValidateAgainstPreviousImpl(Previous, InOutErrors);
@@ -81,25 +320,23 @@ void UPMXlsxDataAsset::ValidateImpl(FPMXlsxImporterContextLogger& InOutErrors) c
 	UE_LOG(LogPMXlsxImporter, VeryVerbose, TEXT("Validating properties of %s %s"), *GetClass()->GetName(), *GetName());
 	for (TFieldIterator<FProperty> PropertyIterator(GetClass(), EFieldIteratorFlags::IncludeSuper); PropertyIterator; ++PropertyIterator)
 	{
-		FString CPPName = PropertyIterator->GetNameCPP();
-		FString CPPType = PropertyIterator->GetCPPType();
-		auto ScopedErrorContext = InOutErrors.PushContext(FString::Printf(TEXT(".%s %s"), *CPPName, *CPPType));
-
 		bool bHasImportMetadata = PropertyIterator->HasMetaData(FPMXlsxMetadata::IMPORT_FROM_XLSX_METADATA_TAG);
 		if (!bHasImportMetadata)
 		{
 			continue;
 		}
 
+		auto ScopedErrorContext = InOutErrors.PushPropertyContext(**PropertyIterator);
+
 		const void* Value = PropertyIterator->ContainerPtrToValuePtr<void>(this);
 
-		if (PropertyIterator->IsA<FStructProperty>())
+		if (const FStructProperty* StructProperty = CastField<FStructProperty>(*PropertyIterator))
 		{
-			if (CPPType == TEXT("FPrimaryAssetType"))
+			if (StructProperty->Struct == TBaseStructure<FPrimaryAssetType>::Get())
 			{
 				ValidatePrimaryAssetType(*(const FPrimaryAssetType*)Value, InOutErrors);
 			}
-			else if (CPPType == TEXT("FPrimaryAssetId"))
+			else if (StructProperty->Struct == TBaseStructure<FPrimaryAssetId>::Get())
 			{
 				ValidatePrimaryAssetId(*(const FPrimaryAssetId*)Value, InOutErrors);
 			}
@@ -107,35 +344,34 @@ void UPMXlsxDataAsset::ValidateImpl(FPMXlsxImporterContextLogger& InOutErrors) c
 	}
 }
 
-bool UPMXlsxDataAsset::WasModified(UPMXlsxDataAsset* Original)
+bool UPMXlsxDataAsset::WasModified(const FPMXlsxDataAssetSnapshot& Original)
 {
-	// Export this and Original as text, then compare the text
-	// See UAssetToolsImpl::DumpAssetToTempFile
-	const FExportObjectInnerContext Context;
-	const uint32 FLAGS = PPF_ExportsNotFullyQualified | PPF_Copy | PPF_Delimited;
-
-	FStringOutputDevice OriginalArchive;
-	UExporter::ExportToOutputDevice(&Context, Original, nullptr, OriginalArchive, TEXT("copy"), 0, FLAGS, false, Original->GetOuter());
-
-	FStringOutputDevice UpdatedArchive;
-	UExporter::ExportToOutputDevice(&Context, this, nullptr, UpdatedArchive, TEXT("copy"), 0, FLAGS, false, GetOuter());
-
-	bool bWasModified = !OriginalArchive.Equals(UpdatedArchive, ESearchCase::CaseSensitive);
+	PMXLSX_IMPORT_STAGE_SCOPE(WasModified);
+	// Compare each snapshotted property in binary, no need to duplicate this or export anything to text
+	const FProperty* ModifiedProperty = Original.FindModifiedProperty(*this);
+	const bool bWasModified = ModifiedProperty != nullptr || Original.WasExtraStateModified(*this);
 	UE_LOG(LogPMXlsxImporter, Verbose, TEXT("%s %s modified"), *GetName(), bWasModified ? TEXT("WAS") : TEXT("was NOT"));
 
-	if (bWasModified)
+	if (ModifiedProperty)
 	{
-		UE_LOG(LogPMXlsxImporter, VeryVerbose, TEXT("Orignal: %s"), *OriginalArchive);
-		UE_LOG(LogPMXlsxImporter, VeryVerbose, TEXT("Updated: %s"), *UpdatedArchive);
+		UE_LOG(LogPMXlsxImporter, VeryVerbose, TEXT("First modified property: %s"), *ModifiedProperty->GetNameCPP());
 	}
-	else
+	else if (bWasModified)
 	{
-		UE_LOG(LogPMXlsxImporter, VeryVerbose, TEXT("%s"), *OriginalArchive);
+		UE_LOG(LogPMXlsxImporter, VeryVerbose, TEXT("Modified by SerializeExtraImportState"));
 	}
 
 	return bWasModified;
 }
 
+bool UPMXlsxDataAsset::WasModified(UPMXlsxDataAsset* Original)
+{
+	check(Original && Original->GetClass() == GetClass());
+	FPMXlsxDataAssetSnapshot OriginalSnapshot;
+	OriginalSnapshot.Take(*Original);
+	return WasModified(OriginalSnapshot);
+}
+
 bool UPMXlsxDataAsset::ParseValue(FProperty& Property, const FString& Value, void* Result, FPMXlsxImporterContextLogger& InOutErrors)
 {
 	if (Property.IsA<FBoolProperty>())
@@ -317,7 +553,7 @@ bool UPMXlsxDataAsset::ParseArray(const FArrayProperty& Property, const FString&
 	bool bAllParsed = true;
 	for (int32 Index = 0; Index < ArrayLength; ++Index)
 	{
-		auto ScopedErrorContext = InOutErrors.PushContext(FString::Printf(TEXT("[%i]"), Index));
+		auto ScopedErrorContext = InOutErrors.PushIndexContext(Index);
 
 		const FString TrimmedValue = Values[Index].TrimStartAndEnd();
 		bAllParsed &= ParseValue(*Property.Inner, TrimmedValue, ArrayHelper.GetRawPtr(Index), InOutErrors);
@@ -3,8 +3,11 @@
 
 #include "PMXlsxDataAssetImporterJSON.h"
 
+#include "PMXlsxImporterRunContext.h"
 #include "PMXlsxImporterSettingsEntry.h"
 #include "PMXlsxMetadata.h"
+#include "PMXlsxWorksheetData.h"
+#include "Engine/DataTable.h"
 #include "Serialization/JsonReader.h"
 #include "Serialization/JsonSerializer.h"
 
@@ -34,10 +37,366 @@ namespace
 	}
 }
 
+// A value to read into a property: a value of a json object, or a value of a worksheet row.
+// Arrays and objects are visited element by element, so that every kind of value is read the same way.
+class FPMXlsxImportValue
+{
+public:
+	virtual ~FPMXlsxImportValue() = default;
+
+	virtual EJson GetType() const = 0;
+
+	// Convert like FJsonValue. Strings are returned without being copied where possible, other values are converted into Scratch.
+	virtual const FString* TryGetString(FString& Scratch) const = 0;
+	virtual bool TryGetNumber(double& OutNumber) const = 0;
+	virtual bool TryGetNumber(int64& OutNumber) const = 0;
+	virtual bool TryGetBool(bool& OutBool) const = 0;
+
+	// Visits the elements of an array until Visit returns false. Returns false if this is not an array or a visit returned false.
+	virtual bool VisitElements(TFunctionRef<bool(const FPMXlsxImportValue& Element)> Visit) const = 0;
+
+	// Visits the fields of an object until Visit returns false. Returns false if this is not an object or a visit returned false.
+	virtual bool VisitFields(TFunctionRef<bool(const FString& Key, const FPMXlsxImportValue& Value)> Visit) const = 0;
+};
+
+namespace
+{
+	// A value of a json DOM, such as the row passed to UPMXlsxDataAsset::ImportFromXLSXImpl
+	class FJsonImportValue final : public FPMXlsxImportValue
+	{
+	public:
+		explicit FJsonImportValue(const FJsonValue& InValue)
+			: Value(InValue)
+		{
+		}
+
+		virtual EJson GetType() const override { return Value.Type; }
+		virtual const FString* TryGetString(FString& Scratch) const override { return Value.TryGetString(Scratch) ? &Scratch : nullptr; }
+		virtual bool TryGetNumber(double& OutNumber) const override { return Value.TryGetNumber(OutNumber); }
+		virtual bool TryGetNumber(int64& OutNumber) const override { return Value.TryGetNumber(OutNumber); }
+		virtual bool TryGetBool(bool& OutBool) const override { return Value.TryGetBool(OutBool); }
+
+		virtual bool VisitElements(TFunctionRef<bool(const FPMXlsxImportValue& Element)> Visit) const override
+		{
+			const TArray<TSharedPtr<FJsonValue>>* Elements = nullptr;
+			if (!Value.TryGetArray(Elements))
+			{
+				return false;
+			}
+
+			for (const TSharedPtr<FJsonValue>& Element : *Elements)
+			{
+				if (!Visit(FJsonImportValue(*Element)))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		virtual bool VisitFields(TFunctionRef<bool(const FString& Key, const FPMXlsxImportValue& Value)> Visit) const override
+		{
+			const TSharedPtr<FJsonObject>* Object = nullptr;
+			return Value.TryGetObject(Object) && VisitObjectFields(**Object, Visit);
+		}
+
+		static bool VisitObjectFields(const FJsonObject& Object, TFunctionRef<bool(const FString& Key, const FPMXlsxImportValue& Value)> Visit)
+		{
+			for (const TPair<FString, TSharedPtr<FJsonValue>>& Field : Object.Values)
+			{
+				if (!Visit(Field.Key, FJsonImportValue(*Field.Value)))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		const FJsonValue& Value;
+	};
+
+	// A json object, such as the row passed to UPMXlsxDataAsset::ImportFromXLSXImpl
+	class FJsonObjectImportValue final : public FPMXlsxImportValue
+	{
+	public:
+		explicit FJsonObjectImportValue(const FJsonObject& InObject)
+			: Object(InObject)
+		{
+		}
+
+		virtual EJson GetType() const override { return EJson::Object; }
+		virtual const FString* TryGetString(FString& Scratch) const override { return nullptr; }
+		virtual bool TryGetNumber(double& OutNumber) const override { return false; }
+		virtual bool TryGetNumber(int64& OutNumber) const override { return false; }
+		virtual bool TryGetBool(bool& OutBool) const override { return false; }
+		virtual bool VisitElements(TFunctionRef<bool(const FPMXlsxImportValue& Element)> Visit) const override { return false; }
+
+		virtual bool VisitFields(TFunctionRef<bool(const FString& Key, const FPMXlsxImportValue& Value)> Visit) const override
+		{
+			return FJsonImportValue::VisitObjectFields(Object, Visit);
+		}
+
+	private:
+		const FJsonObject& Object;
+	};
+
+	// A string, number, bool or null of a worksheet row, read without making it a json value
+	class FCellImportValue final : public FPMXlsxImportValue
+	{
+	public:
+		explicit FCellImportValue(const FPMXlsxCellValue& InCell)
+			: Cell(InCell)
+		{
+		}
+
+		virtual EJson GetType() const override { return Cell.Type; }
+		virtual const FString* TryGetString(FString& Scratch) const override { return Cell.TryGetString(Scratch); }
+		virtual bool TryGetNumber(double& OutNumber) const override { return Cell.TryGetNumber(OutNumber); }
+		virtual bool TryGetNumber(int64& OutNumber) const override { return Cell.TryGetNumber(OutNumber); }
+		virtual bool TryGetBool(bool& OutBool) const override { return Cell.TryGetBool(OutBool); }
+		virtual bool VisitElements(TFunctionRef<bool(const FPMXlsxImportValue& Element)> Visit) const override { return false; }
+		virtual bool VisitFields(TFunctionRef<bool(const FString& Key, const FPMXlsxImportValue& Value)> Visit) const override { return false; }
+
+	private:
+		const FPMXlsxCellValue& Cell;
+	};
+
+	// Reads the json text of an array or object cell token by token
+	class FJsonTokenWalk
+	{
+	public:
+		explicit FJsonTokenWalk(const FString& Json)
+			: Reader(*Json, Json.Len())
+		{
+		}
+
+		bool ReadNext(EJsonNotation& OutNotation)
+		{
+			if (bError || !Reader.ReadNext(OutNotation) || OutNotation == EJsonNotation::Error)
+			{
+				bError = true;
+				return false;
+			}
+
+			if (OutNotation == EJsonNotation::ArrayStart || OutNotation == EJsonNotation::ObjectStart)
+			{
+				++Depth;
+			}
+			else if (OutNotation == EJsonNotation::ArrayEnd || OutNotation == EJsonNotation::ObjectEnd)
+			{
+				--Depth;
+			}
+			return true;
+		}
+
+		// Skips what is left of the arrays and objects deeper than InDepth
+		bool SkipTo(int32 InDepth)
+		{
+			EJsonNotation Notation;
+			while (Depth > InDepth)
+			{
+				if (!ReadNext(Notation))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		FPMXlsxJsonStringViewReader Reader;
+		// Number of arrays and objects the reader is in
+		int32 Depth = 0;
+		// Set once the text turned out not to be valid json
+		bool bError = false;
+	};
+
+	// The value whose token a FJsonTokenWalk just read. Strings and keys are only valid until the walk reads on, and the elements or
+	// fields of an array or object can only be visited once, since they're read as they're visited.
+	class FJsonTokenImportValue final : public FPMXlsxImportValue
+	{
+	public:
+		FJsonTokenImportValue(FJsonTokenWalk& InWalk, EJsonNotation Notation)
+			: Walk(InWalk)
+			, Depth(InWalk.Depth)
+		{
+			switch (Notation)
+			{
+			case EJsonNotation::ArrayStart:
+				Cell.Type = EJson::Array;
+				break;
+			case EJsonNotation::ObjectStart:
+				Cell.Type = EJson::Object;
+				break;
+			case EJsonNotation::String:
+				Cell.Type = EJson::String;
+				Cell.String = &Walk.Reader.GetValueAsString();
+				break;
+			case EJsonNotation::Number:
+				Cell.Type = EJson::Number;
+				Cell.Number = Walk.Reader.GetValueAsNumber();
+				break;
+			case EJsonNotation::Boolean:
+				Cell.Type = EJson::Boolean;
+				Cell.bBool = Walk.Reader.GetValueAsBoolean();
+				break;
+			default:
+				Cell.Type = EJson::Null;
+				break;
+			}
+		}
+
+		virtual EJson GetType() const override { return Cell.Type; }
+		virtual const FString* TryGetString(FString& Scratch) const override { return Cell.TryGetString(Scratch); }
+		virtual bool TryGetNumber(double& OutNumber) const override { return Cell.TryGetNumber(OutNumber); }
+		virtual bool TryGetNumber(int64& OutNumber) const override { return Cell.TryGetNumber(OutNumber); }
+		virtual bool TryGetBool(bool& OutBool) const override { return Cell.TryGetBool(OutBool); }
+
+		virtual bool VisitElements(TFunctionRef<bool(const FPMXlsxImportValue& Element)> Visit) const override
+		{
+			return Cell.Type == EJson::Array && VisitChildren(Visit);
+		}
+
+		virtual bool VisitFields(TFunctionRef<bool(const FString& Key, const FPMXlsxImportValue& Value)> Visit) const override
+		{
+			return Cell.Type == EJson::Object && VisitChildren([this, &Visit](const FPMXlsxImportValue& Value) { return Visit(Walk.Reader.GetIdentifier(), Value); });
+		}
+
+	private:
+		bool VisitChildren(TFunctionRef<bool(const FPMXlsxImportValue& Child)> Visit) const
+		{
+			EJsonNotation Notation;
+			while (Walk.ReadNext(Notation))
+			{
+				if (Notation == EJsonNotation::ArrayEnd || Notation == EJsonNotation::ObjectEnd)
+				{
+					return true;
+				}
+
+				// Whatever of a child array or object the visit didn't read is skipped, so that the walk is back at this level
+				if (!Visit(FJsonTokenImportValue(Walk, Notation)) || !Walk.SkipTo(Depth))
+				{
+					return false;
+				}
+			}
+			return false;
+		}
+
+		FJsonTokenWalk& Walk;
+		// Depth of the walk inside this value, if it's an array or object
+		int32 Depth;
+		FPMXlsxCellValue Cell;
+	};
+}
+
+FPMXlsxStructBindings::FPMXlsxStructBindings(const UStruct* Struct)
+{
+	for (TFieldIterator<FProperty> It(Struct); It; ++It)
+	{
+		FProperty* Property = *It;
+		check(Property);
+
+		const int32 PropertyIndex = Properties.Num();
+		FPMXlsxPropertyBinding& Binding = Properties.AddDefaulted_GetRef();
+		Binding.Property = Property;
+		Binding.ColumnName = DataTableUtils::GetPropertyExportName(Property);
+		DataTableUtils::GetPropertyImportNames(Property, Binding.ImportNames);
+#if WITH_EDITOR
+		// If the structure has specified the property as optional for import (gameplay code likely doing a custom fix-up or parse of that property),
+		// then avoid warning about it
+		static const FName DataTableImportOptionalMetadataKey(TEXT("DataTableImportOptional"));
+		Binding.bImportOptional = Property->HasMetaData(DataTableImportOptionalMetadataKey);
+#endif // WITH_EDITOR
+		Binding.bImportFromXlsx = Property->HasMetaData(FPMXlsxMetadata::IMPORT_FROM_XLSX_METADATA_TAG);
+
+		PropertyNames.Add(Property->GetFName());
+		for (int32 ImportNameIndex = 0; ImportNameIndex < Binding.ImportNames.Num(); ++ImportNameIndex)
+		{
+			// A key that is an import name of several properties is read into the first one
+			if (!Keys.Contains(Binding.ImportNames[ImportNameIndex]))
+			{
+				Keys.Add(Binding.ImportNames[ImportNameIndex], { PropertyIndex, ImportNameIndex });
+			}
+		}
+	}
+
+	for (const FName& PropertyName : PropertyNames)
+	{
+		const FString PropertyNameString = PropertyName.ToString();
+		if (!Keys.Contains(PropertyNameString))
+		{
+			Keys.Add(PropertyNameString, FPMXlsxKeyBinding());
+		}
+	}
+}
+
+FPMXlsxColumnBindings::FPMXlsxColumnBindings(const FPMXlsxStructBindings& StructBindings, const FPMXlsxWorksheetData& WorksheetData, const FString& RowKey)
+{
+	PropertyColumns.SetNum(StructBindings.Properties.Num());
+	for (int32 ColumnIndex = 0; ColumnIndex < WorksheetData.NumColumns(); ++ColumnIndex)
+	{
+		const FString& ColumnName = WorksheetData.GetColumnName(ColumnIndex);
+		if (ColumnName == RowKey && RowKeyColumn == INDEX_NONE)
+		{
+			RowKeyColumn = ColumnIndex;
+		}
+
+		if (const FPMXlsxKeyBinding* KeyBinding = StructBindings.Keys.Find(ColumnName))
+		{
+			if (KeyBinding->PropertyIndex != INDEX_NONE)
+			{
+				PropertyColumns[KeyBinding->PropertyIndex].Add(ColumnIndex);
+			}
+			continue;
+		}
+
+		if (ColumnName == RowKey)
+		{
+			// The row name doesn't match a property
+			continue;
+		}
+
+		const FName PropertyName = DataTableUtils::MakeValidName(ColumnName);
+		if (!StructBindings.PropertyNames.Contains(PropertyName))
+		{
+			UnknownColumnNames.Add(PropertyName);
+		}
+	}
+
+	// Read columns in the order of the import names they match, like json keys
+	for (TArray<int32, TInlineAllocator<1>>& Columns : PropertyColumns)
+	{
+		Columns.StableSort([&StructBindings, &WorksheetData](int32 A, int32 B)
+		{
+			return StructBindings.Keys.FindChecked(WorksheetData.GetColumnName(A)).ImportNameIndex < StructBindings.Keys.FindChecked(WorksheetData.GetColumnName(B)).ImportNameIndex;
+		});
+	}
+}
+
 FPMXlsxDataAssetImporterJSON::FPMXlsxDataAssetImporterJSON(UPMXlsxDataAsset& InDataAsset, const TSharedRef<FJsonObject>& InJSONData, TArray<FString>& OutProblems)
 	: DataAsset(&InDataAsset)
+	, ImportProblems(OutProblems)
 	, JSONData(InJSONData)
+{
+}
+
+FPMXlsxDataAssetImporterJSON::FPMXlsxDataAssetImporterJSON(UPMXlsxDataAsset& InDataAsset, const FPMXlsxWorksheetData& InWorksheetData, int32 InRowIndex,
+	const FPMXlsxColumnBindings& InColumnBindings, TArray<FString>& OutProblems)
+	: DataAsset(&InDataAsset)
+	, ImportProblems(OutProblems)
+	, WorksheetData(&InWorksheetData)
+	, RowIndex(InRowIndex)
+	, ColumnBindings(&InColumnBindings)
+{
+}
+
+FPMXlsxDataAssetImporterJSON::FPMXlsxDataAssetImporterJSON(const UDataTable& InDataTable, const FPMXlsxWorksheetData& InWorksheetData, int32 InRowIndex,
+	const FPMXlsxColumnBindings& InColumnBindings, TArray<FString>& OutProblems)
+	: DataTable(&InDataTable)
 	, ImportProblems(OutProblems)
+	, WorksheetData(&InWorksheetData)
+	, RowIndex(InRowIndex)
+	, ColumnBindings(&InColumnBindings)
 {
 }
 
@@ -46,6 +405,77 @@ FPMXlsxDataAssetImporterJSON::~FPMXlsxDataAssetImporterJSON()
 }
 
 bool FPMXlsxDataAssetImporterJSON::ReadAsset()
+{
+	PrepareStructBindings(DataAsset->GetClass());
+	if (ReadAssetProperties(DataAsset))
+	{
+		DataAsset->Modify(true);
+		return true;
+	}
+
+	return false;
+}
+
+bool FPMXlsxDataAssetImporterJSON::ReadAssetInto(void* OutAssetData, TArray<const FProperty*>& OutReadProperties)
+{
+	StagingData = OutAssetData;
+	StagedProperties = &OutReadProperties;
+	const bool bSuccess = ReadAssetProperties(OutAssetData);
+	StagingData = nullptr;
+	StagedProperties = nullptr;
+	return bSuccess;
+}
+
+void FPMXlsxDataAssetImporterJSON::PrepareStructBindings(const UStruct* Struct)
+{
+	if (FPMXlsxImporterRunContext* RunContext = FPMXlsxImporterRunContext::Get())
+	{
+		RunContext->AddStructBindings(Struct);
+	}
+}
+
+TSharedRef<const FPMXlsxColumnBindings> FPMXlsxDataAssetImporterJSON::PrepareColumnBindings(const UStruct* Struct, const FPMXlsxWorksheetData& WorksheetData, const FString& RowKey)
+{
+	PrepareStructBindings(Struct);
+	if (FPMXlsxImporterRunContext* RunContext = FPMXlsxImporterRunContext::Get())
+	{
+		return RunContext->AddColumnBindings(Struct, WorksheetData, RowKey);
+	}
+	return MakeShared<FPMXlsxColumnBindings>(FPMXlsxStructBindings(Struct), WorksheetData, RowKey);
+}
+
+bool FPMXlsxDataAssetImporterJSON::ReadTableRow(const UDataTable& InDataTable, const FPMXlsxWorksheetData& InWorksheetData, int32 InRowIndex,
+	const FPMXlsxColumnBindings& InColumnBindings, void* OutRowData, TArray<FString>& OutProblems)
+{
+	return FPMXlsxDataAssetImporterJSON(InDataTable, InWorksheetData, InRowIndex, InColumnBindings, OutProblems).ReadAssetProperties(OutRowData);
+}
+
+const UStruct* FPMXlsxDataAssetImporterJSON::GetRowStruct() const
+{
+	if (DataTable)
+	{
+		return DataTable->GetRowStruct();
+	}
+	return DataAsset->GetClass();
+}
+
+bool FPMXlsxDataAssetImporterJSON::IgnoresExtraFields() const
+{
+	return DataTable ? DataTable->bIgnoreExtraFields : DataAsset->bIgnoreExtraFields;
+}
+
+bool FPMXlsxDataAssetImporterJSON::IgnoresMissingFields() const
+{
+	return DataTable ? DataTable->bIgnoreMissingFields : DataAsset->bIgnoreMissingFields;
+}
+
+bool FPMXlsxDataAssetImporterJSON::ReadAssetProperties(void* AssetData)
+{
+	PMXLSX_IMPORT_STAGE_SCOPE(ReadAsset);
+	return WorksheetData ? ReadWorksheetRow(AssetData) : ReadJsonRow(AssetData);
+}
+
+bool FPMXlsxDataAssetImporterJSON::ReadJsonRow(void* AssetData)
 {
 	if (JSONData->Values.IsEmpty())
 	{
@@ -60,7 +490,7 @@ bool FPMXlsxDataAssetImporterJSON::ReadAsset()
 	// Detect any extra fields within the data for this row
 	if (!DataAsset->bIgnoreExtraFields)
 	{
-		TArray<FString> TempPropertyImportNames;
+		const FPMXlsxStructBindings& Bindings = GetStructBindings(DataAsset->GetClass());
 		for (const TPair<FString, TSharedPtr<FJsonValue>>& ParsedPropertyKeyValuePair : JSONData->Values)
 		{
 			if (ParsedPropertyKeyValuePair.Key == RowKey)
@@ -69,128 +499,257 @@ bool FPMXlsxDataAssetImporterJSON::ReadAsset()
 				continue;
 			}
 
-			FName PropName = DataTableUtils::MakeValidName(ParsedPropertyKeyValuePair.Key);
-			FProperty* ColumnProp = FindFProperty<FProperty>(DataAsset->GetClass(), PropName);
-			for (TFieldIterator<FProperty> It(DataAsset->GetClass()); It && !ColumnProp; ++It)
+			if (Bindings.Keys.Contains(ParsedPropertyKeyValuePair.Key))
 			{
-				DataTableUtils::GetPropertyImportNames(*It, TempPropertyImportNames);
-				ColumnProp = TempPropertyImportNames.Contains(ParsedPropertyKeyValuePair.Key) ? *It : nullptr;
+				continue;
 			}
 
-			if (!ColumnProp)
+			FName PropName = DataTableUtils::MakeValidName(ParsedPropertyKeyValuePair.Key);
+			if (!Bindings.PropertyNames.Contains(PropName))
 			{
 				ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' cannot be found in class '%s'."), *PropName.ToString(), *RowName.ToString(), *DataAsset->GetClass()->GetName()));
 			}
 		}
 	}
 
-	if (ReadStruct(JSONData, DataAsset->GetClass(), RowName, DataAsset))
+	return ReadStruct(FJsonObjectImportValue(*JSONData), DataAsset->GetClass(), RowName, AssetData);
+}
+
+bool FPMXlsxDataAssetImporterJSON::ReadWorksheetRow(void* AssetData)
+{
+	const FPMXlsxStructBindings& Bindings = GetStructBindings(GetRowStruct());
+	check(ColumnBindings->PropertyColumns.Num() == Bindings.Properties.Num());
+
+	FString RowError;
+	if (!WorksheetData->IsRowValid(RowIndex, RowError))
 	{
-		DataAsset->Modify(true);
-		return true;
+		ImportProblems.Add(RowError);
+		return false;
 	}
 
-	return false;
-}
+	FString RowNameString;
+	WorksheetData->TryGetRowString(RowIndex, ColumnBindings->RowKeyColumn, RowNameString);
+	const FName RowName = DataTableUtils::MakeValidName(RowNameString);
 
-bool FPMXlsxDataAssetImporterJSON::ReadStruct(const TSharedRef<FJsonObject>& InParsedObject, UStruct* InStruct, const FName InRowName, void* InStructData)
-{
-	// Now read in each property
-	TArray<FString> TempPropertyImportNames;
-	for (TFieldIterator<FProperty> It(InStruct); It; ++It)
+	if (!IgnoresExtraFields())
 	{
-		FProperty* BaseProp = *It;
-		check(BaseProp);
+		for (const FName& ColumnName : ColumnBindings->UnknownColumnNames)
+		{
+			ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' cannot be found in %s '%s'."), *ColumnName.ToString(), *RowName.ToString(),
+				DataTable ? TEXT("struct") : TEXT("class"), *GetRowStruct()->GetName()));
+		}
+	}
 
-		const FString ColumnName = DataTableUtils::GetPropertyExportName(BaseProp);
+	for (int32 PropertyIndex = 0; PropertyIndex < Bindings.Properties.Num(); ++PropertyIndex)
+	{
+		const FPMXlsxPropertyBinding& Binding = Bindings.Properties[PropertyIndex];
 
-		TSharedPtr<FJsonValue> ParsedPropertyValue;
-		DataTableUtils::GetPropertyImportNames(BaseProp, TempPropertyImportNames);
-		for (const FString& PropertyName : TempPropertyImportNames)
+		FPMXlsxCellValue Cell;
+		int32 CellColumn = INDEX_NONE;
+		for (const int32 ColumnIndex : ColumnBindings->PropertyColumns[PropertyIndex])
 		{
-			ParsedPropertyValue = InParsedObject->TryGetField(PropertyName);
-			if (ParsedPropertyValue.IsValid())
+			Cell = WorksheetData->GetValue(RowIndex, ColumnIndex);
+			if (Cell.Type != EJson::None)
 			{
+				CellColumn = ColumnIndex;
 				break;
 			}
 		}
 
-		if (!ParsedPropertyValue.IsValid())
+		if (CellColumn == INDEX_NONE)
 		{
-#if WITH_EDITOR
-			// If the structure has specified the property as optional for import (gameplay code likely doing a custom fix-up or parse of that property),
-			// then avoid warning about it
-			static const FName DataTableImportOptionalMetadataKey(TEXT("DataTableImportOptional"));
-			if (BaseProp->HasMetaData(DataTableImportOptionalMetadataKey))
+			ReportMissingProperty(Binding, RowName);
+			continue;
+		}
+
+		PrepareStagedProperty(Binding.Property, AssetData);
+		if (Cell.Type != EJson::Array && Cell.Type != EJson::Object)
+		{
+			if (!ReadProperty(Binding, FCellImportValue(Cell), RowName, AssetData))
 			{
-				continue;
+				return false;
 			}
-#endif // WITH_EDITOR
+			continue;
+		}
 
-			if (!DataAsset->bIgnoreMissingFields && BaseProp->HasMetaData(FPMXlsxMetadata::IMPORT_FROM_XLSX_METADATA_TAG))
+		// Arrays and objects are read from their json text as they're walked, without making a json DOM
+		FJsonTokenWalk Walk(*Cell.String);
+		EJsonNotation Notation;
+		bool bReadAll = true;
+		if (Walk.ReadNext(Notation))
+		{
+			bReadAll = ReadProperty(Binding, FJsonTokenImportValue(Walk, Notation), RowName, AssetData);
+			Walk.SkipTo(0);
+		}
+
+		if (Walk.bError)
+		{
+			ImportProblems.Add(FString::Printf(TEXT("Row '%s' has invalid JSON in column %s."), *RowName.ToString(), *WorksheetData->GetColumnName(CellColumn)));
+			if (StagedProperties && AssetData == StagingData)
 			{
-				ImportProblems.Add(FString::Printf(TEXT("Row '%s' is missing an entry for '%s'."), *InRowName.ToString(), *ColumnName));
+				// Leave the property as it is, rather than with what was read before the invalid json
+				Binding.Property->CopyCompleteValue_InContainer(AssetData, DataAsset);
 			}
-
 			continue;
 		}
+		if (!bReadAll)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool FPMXlsxDataAssetImporterJSON::ReadStruct(const FPMXlsxImportValue& InObject, const UStruct* InStruct, const FName InRowName, void* InStructData)
+{
+	const FPMXlsxStructBindings& Bindings = GetStructBindings(InStruct);
+
+	// Import name each property was read from, INDEX_NONE if it wasn't read
+	TArray<int32, TInlineAllocator<32>> ReadImportNames;
+	ReadImportNames.Init(INDEX_NONE, Bindings.Properties.Num());
+
+	bool bSuccess = true;
+	InObject.VisitFields([this, &Bindings, &ReadImportNames, &bSuccess, InRowName, InStructData](const FString& Key, const FPMXlsxImportValue& Value)
+	{
+		const FPMXlsxKeyBinding* KeyBinding = Bindings.Keys.Find(Key);
+		if (KeyBinding == nullptr || KeyBinding->PropertyIndex == INDEX_NONE)
+		{
+			return true;
+		}
 
-		if (BaseProp->ArrayDim == 1)
+		// The first import name of a property that an object has wins, wherever it is in the object
+		int32& ReadImportName = ReadImportNames[KeyBinding->PropertyIndex];
+		if (ReadImportName != INDEX_NONE && ReadImportName < KeyBinding->ImportNameIndex)
 		{
-			void* Data = BaseProp->ContainerPtrToValuePtr<void>(InStructData, 0);
-			ReadStructEntry(ParsedPropertyValue.ToSharedRef(), InRowName, ColumnName, InStructData, BaseProp, Data);
+			return true;
 		}
-		else
+
+		const FPMXlsxPropertyBinding& Binding = Bindings.Properties[KeyBinding->PropertyIndex];
+		if (ReadImportName == INDEX_NONE)
 		{
-			const TCHAR* const ParsedPropertyType = JSONTypeToString(ParsedPropertyValue->Type);
+			PrepareStagedProperty(Binding.Property, InStructData);
+		}
+		ReadImportName = KeyBinding->ImportNameIndex;
+		bSuccess = ReadProperty(Binding, Value, InRowName, InStructData);
+		return bSuccess;
+	});
 
-			const TArray< TSharedPtr<FJsonValue> >* PropertyValuesPtr;
-			if (!ParsedPropertyValue->TryGetArray(PropertyValuesPtr))
-			{
-				ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' is the incorrect type. Expected Array, got %s."), *ColumnName, *InRowName.ToString(), ParsedPropertyType));
-				return false;
-			}
+	if (!bSuccess)
+	{
+		return false;
+	}
 
-			if (BaseProp->ArrayDim != PropertyValuesPtr->Num())
-			{
-				ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' is a static sized array with %d elements, but we have %d values to import"), *ColumnName, *InRowName.ToString(), BaseProp->ArrayDim, PropertyValuesPtr->Num()));
-			}
+	for (int32 PropertyIndex = 0; PropertyIndex < Bindings.Properties.Num(); ++PropertyIndex)
+	{
+		if (ReadImportNames[PropertyIndex] == INDEX_NONE)
+		{
+			ReportMissingProperty(Bindings.Properties[PropertyIndex], InRowName);
+		}
+	}
 
-			for (int32 ArrayEntryIndex = 0; ArrayEntryIndex < BaseProp->ArrayDim; ++ArrayEntryIndex)
-			{
-				if (PropertyValuesPtr->IsValidIndex(ArrayEntryIndex))
-				{
-					void* Data = BaseProp->ContainerPtrToValuePtr<void>(InStructData, ArrayEntryIndex);
-					const TSharedPtr<FJsonValue>& PropertyValueEntry = (*PropertyValuesPtr)[ArrayEntryIndex];
-					ReadContainerEntry(PropertyValueEntry.ToSharedRef(), InRowName, ColumnName, ArrayEntryIndex, BaseProp, Data);
-				}
-			}
+	return true;
+}
+
+bool FPMXlsxDataAssetImporterJSON::ReadProperty(const FPMXlsxPropertyBinding& Binding, const FPMXlsxImportValue& InValue, const FName InRowName, void* InStructData)
+{
+	FProperty* BaseProp = Binding.Property;
+	const FString& ColumnName = Binding.ColumnName;
+
+	if (BaseProp->ArrayDim == 1)
+	{
+		void* Data = BaseProp->ContainerPtrToValuePtr<void>(InStructData, 0);
+		ReadStructEntry(InValue, InRowName, ColumnName, InStructData, BaseProp, Data);
+		return true;
+	}
+
+	if (InValue.GetType() != EJson::Array)
+	{
+		ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' is the incorrect type. Expected Array, got %s."), *ColumnName, *InRowName.ToString(), JSONTypeToString(InValue.GetType())));
+		return false;
+	}
+
+	int32 NumValues = 0;
+	InValue.VisitElements([this, BaseProp, &ColumnName, &NumValues, InRowName, InStructData](const FPMXlsxImportValue& PropertyValueEntry)
+	{
+		if (NumValues < BaseProp->ArrayDim)
+		{
+			void* Data = BaseProp->ContainerPtrToValuePtr<void>(InStructData, NumValues);
+			ReadContainerEntry(PropertyValueEntry, InRowName, ColumnName, NumValues, BaseProp, Data);
 		}
+		++NumValues;
+		return true;
+	});
+
+	if (BaseProp->ArrayDim != NumValues)
+	{
+		ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' is a static sized array with %d elements, but we have %d values to import"), *ColumnName, *InRowName.ToString(), BaseProp->ArrayDim, NumValues));
 	}
 
 	return true;
 }
 
-bool FPMXlsxDataAssetImporterJSON::ReadStructEntry(const TSharedRef<FJsonValue>& InParsedPropertyValue, const FName InRowName, const FString& InColumnName, const void* InRowData, FProperty* InProperty, void* InPropertyData)
+void FPMXlsxDataAssetImporterJSON::ReportMissingProperty(const FPMXlsxPropertyBinding& Binding, const FName InRowName)
+{
+	if (Binding.bImportOptional)
+	{
+		return;
+	}
+
+	if (!IgnoresMissingFields() && (Binding.bImportFromXlsx || DataTable))
+	{
+		ImportProblems.Add(FString::Printf(TEXT("Row '%s' is missing an entry for '%s'."), *InRowName.ToString(), *Binding.ColumnName));
+	}
+}
+
+void FPMXlsxDataAssetImporterJSON::PrepareStagedProperty(const FProperty* Property, void* InStructData)
 {
-	const TCHAR* const ParsedPropertyType = JSONTypeToString(InParsedPropertyValue->Type);
+	if (StagedProperties && InStructData == StagingData)
+	{
+		// Start from the asset's current value, the same as reading straight into the asset
+		Property->CopyCompleteValue_InContainer(InStructData, DataAsset);
+		StagedProperties->Add(Property);
+	}
+}
+
+const FPMXlsxStructBindings& FPMXlsxDataAssetImporterJSON::GetStructBindings(const UStruct* Struct)
+{
+	if (const FPMXlsxImporterRunContext* RunContext = FPMXlsxImporterRunContext::Get())
+	{
+		if (const FPMXlsxStructBindings* Bindings = RunContext->FindStructBindings(Struct))
+		{
+			return *Bindings;
+		}
+	}
+
+	TUniquePtr<const FPMXlsxStructBindings>& Bindings = LocalStructBindings.FindOrAdd(Struct);
+	if (!Bindings.IsValid())
+	{
+		Bindings = MakeUnique<FPMXlsxStructBindings>(Struct);
+	}
+	return *Bindings;
+}
+
+bool FPMXlsxDataAssetImporterJSON::ReadStructEntry(const FPMXlsxImportValue& InParsedPropertyValue, const FName InRowName, const FString& InColumnName, const void* InRowData, FProperty* InProperty, void* InPropertyData)
+{
+	const TCHAR* const ParsedPropertyType = JSONTypeToString(InParsedPropertyValue.GetType());
 
 	if (FEnumProperty* EnumProp = CastField<FEnumProperty>(InProperty))
 	{
-		FString EnumValue;
-		if (InParsedPropertyValue->TryGetString(EnumValue))
+		FString Scratch;
+		if (const FString* EnumValue = InParsedPropertyValue.TryGetString(Scratch))
 		{
-			FString Error = DataTableUtils::AssignStringToProperty(EnumValue, InProperty, (uint8*)InRowData);
+			FString Error = DataTableUtils::AssignStringToProperty(*EnumValue, InProperty, (uint8*)InRowData);
 			if (!Error.IsEmpty())
 			{
-				ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' has invalid enum value: %s."), *InColumnName, *InRowName.ToString(), *EnumValue));
+				ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' has invalid enum value: %s."), *InColumnName, *InRowName.ToString(), **EnumValue));
 				return false;
 			}
 		}
 		else
 		{
 			int64 PropertyValue = 0;
-			if (!InParsedPropertyValue->TryGetNumber(PropertyValue))
+			if (!InParsedPropertyValue.TryGetNumber(PropertyValue))
 			{
 				ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' is the incorrect type. Expected Integer, got %s."), *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 				return false;
@@ -201,20 +760,21 @@ bool FPMXlsxDataAssetImporterJSON::ReadStructEntry(const TSharedRef<FJsonValue>&
 	}
 	else if (FNumericProperty *NumProp = CastField<FNumericProperty>(InProperty))
 	{
-		FString EnumValue;
-		if (NumProp->IsEnum() && InParsedPropertyValue->TryGetString(EnumValue))
+		FString Scratch;
+		const FString* EnumValue = NumProp->IsEnum() ? InParsedPropertyValue.TryGetString(Scratch) : nullptr;
+		if (EnumValue)
 		{
-			FString Error = DataTableUtils::AssignStringToProperty(EnumValue, InProperty, (uint8*)InRowData);
+			FString Error = DataTableUtils::AssignStringToProperty(*EnumValue, InProperty, (uint8*)InRowData);
 			if (!Error.IsEmpty())
 			{
-				ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' has invalid enum value: %s."), *InColumnName, *InRowName.ToString(), *EnumValue));
+				ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' has invalid enum value: %s."), *InColumnName, *InRowName.ToString(), **EnumValue));
 				return false;
 			}
 		}
 		else if (NumProp->IsInteger())
 		{
 			int64 PropertyValue = 0;
-			if (!InParsedPropertyValue->TryGetNumber(PropertyValue))
+			if (!InParsedPropertyValue.TryGetNumber(PropertyValue))
 			{
 				ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' is the incorrect type. Expected Integer, got %s."), *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 				return false;
@@ -225,7 +785,7 @@ bool FPMXlsxDataAssetImporterJSON::ReadStructEntry(const TSharedRef<FJsonValue>&
 		else
 		{
 			double PropertyValue = 0.0;
-			if (!InParsedPropertyValue->TryGetNumber(PropertyValue))
+			if (!InParsedPropertyValue.TryGetNumber(PropertyValue))
 			{
 				ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' is the incorrect type. Expected Double, got %s."), *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 				return false;
@@ -237,7 +797,7 @@ bool FPMXlsxDataAssetImporterJSON::ReadStructEntry(const TSharedRef<FJsonValue>&
 	else if (FBoolProperty* BoolProp = CastField<FBoolProperty>(InProperty))
 	{
 		bool PropertyValue = false;
-		if (!InParsedPropertyValue->TryGetBool(PropertyValue))
+		if (!InParsedPropertyValue.TryGetBool(PropertyValue))
 		{
 			ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' is the incorrect type. Expected Boolean, got %s."), *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 			return false;
@@ -247,8 +807,7 @@ bool FPMXlsxDataAssetImporterJSON::ReadStructEntry(const TSharedRef<FJsonValue>&
 	}
 	else if (FArrayProperty* ArrayProp = CastField<FArrayProperty>(InProperty))
 	{
-		const TArray< TSharedPtr<FJsonValue> >* PropertyValuesPtr;
-		if (!InParsedPropertyValue->TryGetArray(PropertyValuesPtr))
+		if (InParsedPropertyValue.GetType() != EJson::Array)
 		{
 			ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' is the incorrect type. Expected Array, got %s."), *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 			return false;
@@ -256,17 +815,17 @@ bool FPMXlsxDataAssetImporterJSON::ReadStructEntry(const TSharedRef<FJsonValue>&
 
 		FScriptArrayHelper ArrayHelper(ArrayProp, InPropertyData);
 		ArrayHelper.EmptyValues();
-		for (const TSharedPtr<FJsonValue>& PropertyValueEntry : *PropertyValuesPtr)
+		InParsedPropertyValue.VisitElements([this, &ArrayHelper, ArrayProp, InRowName, &InColumnName](const FPMXlsxImportValue& PropertyValueEntry)
 		{
 			const int32 NewEntryIndex = ArrayHelper.AddValue();
 			uint8* ArrayEntryData = ArrayHelper.GetRawPtr(NewEntryIndex);
-			ReadContainerEntry(PropertyValueEntry.ToSharedRef(), InRowName, InColumnName, NewEntryIndex, ArrayProp->Inner, ArrayEntryData);
-		}
+			ReadContainerEntry(PropertyValueEntry, InRowName, InColumnName, NewEntryIndex, ArrayProp->Inner, ArrayEntryData);
+			return true;
+		});
 	}
 	else if (FSetProperty* SetProp = CastField<FSetProperty>(InProperty))
 	{
-		const TArray< TSharedPtr<FJsonValue> >* PropertyValuesPtr;
-		if (!InParsedPropertyValue->TryGetArray(PropertyValuesPtr))
+		if (InParsedPropertyValue.GetType() != EJson::Array)
 		{
 			ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' is the incorrect type. Expected Array, got %s."), *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 			return false;
@@ -274,18 +833,18 @@ bool FPMXlsxDataAssetImporterJSON::ReadStructEntry(const TSharedRef<FJsonValue>&
 
 		FScriptSetHelper SetHelper(SetProp, InPropertyData);
 		SetHelper.EmptyElements();
-		for (const TSharedPtr<FJsonValue>& PropertyValueEntry : *PropertyValuesPtr)
+		InParsedPropertyValue.VisitElements([this, &SetHelper, InRowName, &InColumnName](const FPMXlsxImportValue& PropertyValueEntry)
 		{
 			const int32 NewEntryIndex = SetHelper.AddDefaultValue_Invalid_NeedsRehash();
 			uint8* SetEntryData = SetHelper.GetElementPtr(NewEntryIndex);
-			ReadContainerEntry(PropertyValueEntry.ToSharedRef(), InRowName, InColumnName, NewEntryIndex, SetHelper.GetElementProperty(), SetEntryData);
-		}
+			ReadContainerEntry(PropertyValueEntry, InRowName, InColumnName, NewEntryIndex, SetHelper.GetElementProperty(), SetEntryData);
+			return true;
+		});
 		SetHelper.Rehash();
 	}
 	else if (FMapProperty* MapProp = CastField<FMapProperty>(InProperty))
 	{
-		const TSharedPtr<FJsonObject>* PropertyValue;
-		if (!InParsedPropertyValue->TryGetObject(PropertyValue))
+		if (InParsedPropertyValue.GetType() != EJson::Object)
 		{
 			ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' is the incorrect type. Expected Object, got %s."), *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 			return false;
@@ -293,50 +852,55 @@ bool FPMXlsxDataAssetImporterJSON::ReadStructEntry(const TSharedRef<FJsonValue>&
 
 		FScriptMapHelper MapHelper(MapProp, InPropertyData);
 		MapHelper.EmptyValues();
-		for (const auto& PropertyValuePair : (*PropertyValue)->Values)
+		const bool bReadAll = InParsedPropertyValue.VisitFields([this, &MapHelper, InRowName, &InColumnName](const FString& Key, const FPMXlsxImportValue& Value)
 		{
 			const int32 NewEntryIndex = MapHelper.AddDefaultValue_Invalid_NeedsRehash();
 			uint8* MapKeyData = MapHelper.GetKeyPtr(NewEntryIndex);
 			uint8* MapValueData = MapHelper.GetValuePtr(NewEntryIndex);
 
 			// JSON object keys are always strings
-			const FString KeyError = DataTableUtils::AssignStringToPropertyDirect(PropertyValuePair.Key, MapHelper.GetKeyProperty(), MapKeyData);
+			const FString KeyError = DataTableUtils::AssignStringToPropertyDirect(Key, MapHelper.GetKeyProperty(), MapKeyData);
 			if (KeyError.Len() > 0)
 			{
 				MapHelper.RemoveAt(NewEntryIndex);
-				ImportProblems.Add(FString::Printf(TEXT("Problem assigning key '%s' to property '%s' on row '%s' : %s"), *PropertyValuePair.Key, *InColumnName, *InRowName.ToString(), *KeyError));
+				ImportProblems.Add(FString::Printf(TEXT("Problem assigning key '%s' to property '%s' on row '%s' : %s"), *Key, *InColumnName, *InRowName.ToString(), *KeyError));
 				return false;
 			}
 
-			if (!ReadContainerEntry(PropertyValuePair.Value.ToSharedRef(), InRowName, InColumnName, NewEntryIndex, MapHelper.GetValueProperty(), MapValueData))
+			if (!ReadContainerEntry(Value, InRowName, InColumnName, NewEntryIndex, MapHelper.GetValueProperty(), MapValueData))
 			{
 				MapHelper.RemoveAt(NewEntryIndex);
 				return false;
 			}
-		}
+			return true;
+		});
 		MapHelper.Rehash();
+		if (!bReadAll)
+		{
+			return false;
+		}
 	}
 	else if (FStructProperty* StructProp = CastField<FStructProperty>(InProperty))
 	{
-		const TSharedPtr<FJsonObject>* PropertyValue = nullptr;
-		if (InParsedPropertyValue->TryGetObject(PropertyValue))
+		if (InParsedPropertyValue.GetType() == EJson::Object)
 		{
-			return ReadStruct(PropertyValue->ToSharedRef(), StructProp->Struct, InRowName, InPropertyData);
+			return ReadStruct(InParsedPropertyValue, StructProp->Struct, InRowName, InPropertyData);
 		}
 		else
 		{
 			// If the JSON does not contain a JSON object for this struct, we try to use the backwards-compatible string deserialization, same as the "else" block below
-			FString PropertyValueString;
-			if (!InParsedPropertyValue->TryGetString(PropertyValueString))
+			FString Scratch;
+			const FString* PropertyValueString = InParsedPropertyValue.TryGetString(Scratch);
+			if (!PropertyValueString)
 			{
 				ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' is the incorrect type. Expected String, got %s."), *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 				return false;
 			}
 
-			const FString Error = DataTableUtils::AssignStringToProperty(PropertyValueString, InProperty, (uint8*)InRowData);
+			const FString Error = DataTableUtils::AssignStringToProperty(*PropertyValueString, InProperty, (uint8*)InRowData);
 			if (Error.Len() > 0)
 			{
-				ImportProblems.Add(FString::Printf(TEXT("Problem assigning string '%s' to property '%s' on row '%s' : %s"), *PropertyValueString, *InColumnName, *InRowName.ToString(), *Error));
+				ImportProblems.Add(FString::Printf(TEXT("Problem assigning string '%s' to property '%s' on row '%s' : %s"), **PropertyValueString, *InColumnName, *InRowName.ToString(), *Error));
 				return false;
 			}
 
@@ -345,17 +909,18 @@ bool FPMXlsxDataAssetImporterJSON::ReadStructEntry(const TSharedRef<FJsonValue>&
 	}
 	else
 	{
-		FString PropertyValue;
-		if (!InParsedPropertyValue->TryGetString(PropertyValue))
+		FString Scratch;
+		const FString* PropertyValue = InParsedPropertyValue.TryGetString(Scratch);
+		if (!PropertyValue)
 		{
 			ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' is the incorrect type. Expected String, got %s."), *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 			return false;
 		}
 
-		const FString Error = DataTableUtils::AssignStringToProperty(PropertyValue, InProperty, (uint8*)InRowData);
+		const FString Error = DataTableUtils::AssignStringToProperty(*PropertyValue, InProperty, (uint8*)InRowData);
 		if(Error.Len() > 0)
 		{
-			ImportProblems.Add(FString::Printf(TEXT("Problem assigning string '%s' to property '%s' on row '%s' : %s"), *PropertyValue, *InColumnName, *InRowName.ToString(), *Error));
+			ImportProblems.Add(FString::Printf(TEXT("Problem assigning string '%s' to property '%s' on row '%s' : %s"), **PropertyValue, *InColumnName, *InRowName.ToString(), *Error));
 			return false;
 		}
 	}
@@ -363,26 +928,26 @@ bool FPMXlsxDataAssetImporterJSON::ReadStructEntry(const TSharedRef<FJsonValue>&
 	return true;
 }
 
-bool FPMXlsxDataAssetImporterJSON::ReadContainerEntry(const TSharedRef<FJsonValue>& InParsedPropertyValue, const FName InRowName, const FString& InColumnName, const int32 InArrayEntryIndex, FProperty* InProperty, void* InPropertyData)
+bool FPMXlsxDataAssetImporterJSON::ReadContainerEntry(const FPMXlsxImportValue& InParsedPropertyValue, const FName InRowName, const FString& InColumnName, const int32 InArrayEntryIndex, FProperty* InProperty, void* InPropertyData)
 {
-	const TCHAR* const ParsedPropertyType = JSONTypeToString(InParsedPropertyValue->Type);
+	const TCHAR* const ParsedPropertyType = JSONTypeToString(InParsedPropertyValue.GetType());
 
 	if (FEnumProperty* EnumProp = CastField<FEnumProperty>(InProperty))
 	{
-		FString EnumValue;
-		if (InParsedPropertyValue->TryGetString(EnumValue))
+		FString Scratch;
+		if (const FString* EnumValue = InParsedPropertyValue.TryGetString(Scratch))
 		{
-			FString Error = DataTableUtils::AssignStringToPropertyDirect(EnumValue, InProperty, (uint8*)InPropertyData);
+			FString Error = DataTableUtils::AssignStringToPropertyDirect(*EnumValue, InProperty, (uint8*)InPropertyData);
 			if (!Error.IsEmpty())
 			{
-				ImportProblems.Add(FString::Printf(TEXT("Entry %d on property '%s' on row '%s' has invalid enum value: %s."), InArrayEntryIndex, *InColumnName, *InRowName.ToString(), *EnumValue));
+				ImportProblems.Add(FString::Printf(TEXT("Entry %d on property '%s' on row '%s' has invalid enum value: %s."), InArrayEntryIndex, *InColumnName, *InRowName.ToString(), **EnumValue));
 				return false;
 			}
 		}
 		else
 		{
 			int64 PropertyValue = 0;
-			if (!InParsedPropertyValue->TryGetNumber(PropertyValue))
+			if (!InParsedPropertyValue.TryGetNumber(PropertyValue))
 			{
 				ImportProblems.Add(FString::Printf(TEXT("Entry %d on property '%s' on row '%s' is the incorrect type. Expected Integer, got %s."), InArrayEntryIndex, *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 				return false;
@@ -393,20 +958,21 @@ bool FPMXlsxDataAssetImporterJSON::ReadContainerEntry(const TSharedRef<FJsonValu
 	}
 	else if (FNumericProperty *NumProp = CastField<FNumericProperty>(InProperty))
 	{
-		FString EnumValue;
-		if (NumProp->IsEnum() && InParsedPropertyValue->TryGetString(EnumValue))
+		FString Scratch;
+		const FString* EnumValue = NumProp->IsEnum() ? InParsedPropertyValue.TryGetString(Scratch) : nullptr;
+		if (EnumValue)
 		{
-			FString Error = DataTableUtils::AssignStringToPropertyDirect(EnumValue, InProperty, (uint8*)InPropertyData);
+			FString Error = DataTableUtils::AssignStringToPropertyDirect(*EnumValue, InProperty, (uint8*)InPropertyData);
 			if (!Error.IsEmpty())
 			{
-				ImportProblems.Add(FString::Printf(TEXT("Entry %d on property '%s' on row '%s' has invalid enum value: %s."), InArrayEntryIndex, *InColumnName, *InRowName.ToString(), *EnumValue));
+				ImportProblems.Add(FString::Printf(TEXT("Entry %d on property '%s' on row '%s' has invalid enum value: %s."), InArrayEntryIndex, *InColumnName, *InRowName.ToString(), **EnumValue));
 				return false;
 			}
 		}
 		else if(NumProp->IsInteger())
 		{
 			int64 PropertyValue = 0;
-			if (!InParsedPropertyValue->TryGetNumber(PropertyValue))
+			if (!InParsedPropertyValue.TryGetNumber(PropertyValue))
 			{
 				ImportProblems.Add(FString::Printf(TEXT("Entry %d on property '%s' on row '%s' is the incorrect type. Expected Integer, got %s."), InArrayEntryIndex, *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 				return false;
@@ -417,7 +983,7 @@ bool FPMXlsxDataAssetImporterJSON::ReadContainerEntry(const TSharedRef<FJsonValu
 		else
 		{
 			double PropertyValue = 0.0;
-			if (!InParsedPropertyValue->TryGetNumber(PropertyValue))
+			if (!InParsedPropertyValue.TryGetNumber(PropertyValue))
 			{
 				ImportProblems.Add(FString::Printf(TEXT("Entry %d on property '%s' on row '%s' is the incorrect type. Expected Double, got %s."), InArrayEntryIndex, *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 				return false;
@@ -429,7 +995,7 @@ bool FPMXlsxDataAssetImporterJSON::ReadContainerEntry(const TSharedRef<FJsonValu
 	else if (FBoolProperty* BoolProp = CastField<FBoolProperty>(InProperty))
 	{
 		bool PropertyValue = false;
-		if (!InParsedPropertyValue->TryGetBool(PropertyValue))
+		if (!InParsedPropertyValue.TryGetBool(PropertyValue))
 		{
 			ImportProblems.Add(FString::Printf(TEXT("Entry %d on property '%s' on row '%s' is the incorrect type. Expected Boolean, got %s."), InArrayEntryIndex, *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 			return false;
@@ -454,25 +1020,25 @@ bool FPMXlsxDataAssetImporterJSON::ReadContainerEntry(const TSharedRef<FJsonValu
 	}
 	else if (FStructProperty* StructProp = CastField<FStructProperty>(InProperty))
 	{
-		const TSharedPtr<FJsonObject>* PropertyValue = nullptr;
-		if (InParsedPropertyValue->TryGetObject(PropertyValue))
+		if (InParsedPropertyValue.GetType() == EJson::Object)
 		{
-			return ReadStruct(PropertyValue->ToSharedRef(), StructProp->Struct, InRowName, InPropertyData);
+			return ReadStruct(InParsedPropertyValue, StructProp->Struct, InRowName, InPropertyData);
 		}
 		else
 		{
 			// If the JSON does not contain a JSON object for this struct, we try to use the backwards-compatible string deserialization, same as the "else" block below
-			FString PropertyValueString;
-			if (!InParsedPropertyValue->TryGetString(PropertyValueString))
+			FString Scratch;
+			const FString* PropertyValueString = InParsedPropertyValue.TryGetString(Scratch);
+			if (!PropertyValueString)
 			{
 				ImportProblems.Add(FString::Printf(TEXT("Property '%s' on row '%s' is the incorrect type. Expected String, got %s."), *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 				return false;
 			}
 
-			const FString Error = DataTableUtils::AssignStringToPropertyDirect(PropertyValueString, InProperty, (uint8*)InPropertyData);
+			const FString Error = DataTableUtils::AssignStringToPropertyDirect(*PropertyValueString, InProperty, (uint8*)InPropertyData);
 			if (Error.Len() > 0)
 			{
-				ImportProblems.Add(FString::Printf(TEXT("Problem assigning string '%s' to entry %d on property '%s' on row '%s' : %s"), InArrayEntryIndex, *PropertyValueString, *InColumnName, *InRowName.ToString(), *Error));
+				ImportProblems.Add(FString::Printf(TEXT("Problem assigning string '%s' to entry %d on property '%s' on row '%s' : %s"), InArrayEntryIndex, **PropertyValueString, *InColumnName, *InRowName.ToString(), *Error));
 				return false;
 			}
 
@@ -481,17 +1047,18 @@ bool FPMXlsxDataAssetImporterJSON::ReadContainerEntry(const TSharedRef<FJsonValu
 	}
 	else
 	{
-		FString PropertyValue;
-		if (!InParsedPropertyValue->TryGetString(PropertyValue))
+		FString Scratch;
+		const FString* PropertyValue = InParsedPropertyValue.TryGetString(Scratch);
+		if (!PropertyValue)
 		{
 			ImportProblems.Add(FString::Printf(TEXT("Entry %d on property '%s' on row '%s' is the incorrect type. Expected String, got %s."), InArrayEntryIndex, *InColumnName, *InRowName.ToString(), ParsedPropertyType));
 			return false;
 		}
 
-		const FString Error = DataTableUtils::AssignStringToPropertyDirect(PropertyValue, InProperty, (uint8*)InPropertyData);
+		const FString Error = DataTableUtils::AssignStringToPropertyDirect(*PropertyValue, InProperty, (uint8*)InPropertyData);
 		if(Error.Len() > 0)
 		{
-			ImportProblems.Add(FString::Printf(TEXT("Problem assigning string '%s' to entry %d on property '%s' on row '%s' : %s"), InArrayEntryIndex, *PropertyValue, *InColumnName, *InRowName.ToString(), *Error));
+			ImportProblems.Add(FString::Printf(TEXT("Problem assigning string '%s' to entry %d on property '%s' on row '%s' : %s"), InArrayEntryIndex, **PropertyValue, *InColumnName, *InRowName.ToString(), *Error));
 			return false;
 		}
 	}
@@ -3,76 +3,275 @@
 
 #include "PMXlsxDataTableImportUtils.h"
 
-#include "EditorAssetLibrary.h"
+#include "PMXlsxDataAssetImporterJSON.h"
 #include "PMXlsxImporterContextLogger.h"
-#include "PMXlsxImporterSettings.h"
-#include "Engine/Private/DataTableJSON.h"
-#include "Kismet/DataTableFunctionLibrary.h"
+#include "PMXlsxImporterRunContext.h"
+#include "PMXlsxWorksheetData.h"
+#include "DataTableEditorUtils.h"
+#include "DataTableUtils.h"
+#include "Engine/DataTable.h"
 #include "PMXlsxImporterLog.h"
 
 
-void FPMXlsxDataTableImportUtils::ImportDataTableFromXlsx(UDataTable* DataTable, const FString JsonString,
-                                                          FPMXlsxImporterContextLogger& InOutErrors)
+namespace
 {
-	// Keep a copy around to see if anything actually gets changed.
-	// It would be more accurate to pull Original from what's currently checked into source control,
-	// but that would be very slow.
-	UDataTable* DuplicatedDataTable = DuplicateObject(DataTable, nullptr, DataTable->GetFName());
-	// Array used to store problems about table creation
-	TArray<FString> OutProblems = DuplicatedDataTable->CreateTableFromJSONString(JsonString);
+	// Rows read from a worksheet, in its order, each an instance of the row struct allocated like the rows of a UDataTable
+	struct FStagedRows
+	{
+		explicit FStagedRows(const UScriptStruct& InRowStruct)
+			: RowStruct(InRowStruct)
+		{
+		}
 
-	for (FString Problem : OutProblems)
+		~FStagedRows()
+		{
+			for (const TPair<FName, uint8*>& Row : Rows)
+			{
+				RowStruct.DestroyStruct(Row.Value);
+				FMemory::Free(Row.Value);
+			}
+		}
+
+		FStagedRows(const FStagedRows&) = delete;
+		FStagedRows& operator=(const FStagedRows&) = delete;
+
+		uint8* Add(const FName RowName)
+		{
+			uint8* RowData = static_cast<uint8*>(FMemory::Malloc(RowStruct.GetStructureSize(), RowStruct.GetMinAlignment()));
+			RowStruct.InitializeStruct(RowData);
+			Rows.Add(RowName, RowData);
+			return RowData;
+		}
+
+		const UScriptStruct& RowStruct;
+		TMap<FName, uint8*> Rows;
+	};
+
+	// How the rows of an updated table differ from the rows of the original table
+	struct FRowDiff
 	{
-		InOutErrors.Logf(TEXT("%s"), *Problem);
+		// In the order of the updated table
+		TArray<FName> Added;
+		// In the order of the original table
+		TArray<FName> Removed;
+		// In the order of the updated table
+		TArray<FName> Changed;
+		int32 Unchanged = 0;
+		// True if patching the original table (remove, then append added rows) would not give the order of the updated table, so the
+		// patched rows must be moved into place
+		bool bOrderChanged = false;
+
+		bool IsEmpty() const { return Added.Num() == 0 && Removed.Num() == 0 && Changed.Num() == 0 && !bOrderChanged; }
+	};
+
+	FRowDiff DiffRows(const TMap<FName, uint8*>& UpdatedRows, const UDataTable* Original)
+	{
+		FRowDiff Diff;
+		const UScriptStruct* RowStruct = Original->GetRowStruct();
+
+		// Rows of Original that remain, in their current order
+		TArray<FName> KeptRows;
+		KeptRows.Reserve(Original->GetRowMap().Num());
+		for (const TPair<FName, uint8*>& OriginalRow : Original->GetRowMap())
+		{
+			if (UpdatedRows.Contains(OriginalRow.Key))
+			{
+				KeptRows.Add(OriginalRow.Key);
+			}
+			else
+			{
+				Diff.Removed.Add(OriginalRow.Key);
+			}
+		}
+
+		int32 KeptIndex = 0;
+		for (const TPair<FName, uint8*>& UpdatedRow : UpdatedRows)
+		{
+			const uint8* OriginalRowData = Original->FindRowUnchecked(UpdatedRow.Key);
+			if (OriginalRowData == nullptr)
+			{
+				Diff.Added.Add(UpdatedRow.Key);
+				continue;
+			}
+
+			// Kept rows must keep their relative order and come before all added rows
+			if (Diff.Added.Num() > 0 || KeptRows[KeptIndex] != UpdatedRow.Key)
+			{
+				Diff.bOrderChanged = true;
+			}
+			++KeptIndex;
+
+			if (RowStruct->CompareScriptStruct(UpdatedRow.Value, OriginalRowData, PPF_None))
+			{
+				++Diff.Unchanged;
+			}
+			else
+			{
+				Diff.Changed.Add(UpdatedRow.Key);
+			}
+		}
+		return Diff;
 	}
 
-	// Telling Unreal to save a file guarantees the file becomes modified even if there aren't meaningful changes to
-	// that file's data. We only want to check out and save modified assets.
-	if (OutProblems.IsEmpty() && WasDataTableModified(DuplicatedDataTable, DataTable))
+	// UDataTable::RowMap is protected. Reordering rows only moves the pointers in it, the rows themselves are left where they are.
+	struct FDataTableRowMapAccess : UDataTable
 	{
-		// Do the actual import here
-		UDataTableFunctionLibrary::FillDataTableFromJSONString(DataTable, JsonString);
-		
-		const UPMXlsxImporterSettings* SettingsCDO = GetDefault<UPMXlsxImporterSettings>();
-		if (SettingsCDO->bCheckoutGeneratedAssets && !UEditorAssetLibrary::CheckoutLoadedAsset(DataTable))
+		static TMap<FName, uint8*>& Get(UDataTable* DataTable)
 		{
-			// CheckoutLoadedAsset will print its own errors, but we want to add one here so that we can
-			// properly track if the run as a whole succeeded or not.
-			InOutErrors.Logf(TEXT("Unable to checkout asset %s"), *DataTable->GetName());
-			return;
+			return DataTable->*(&FDataTableRowMapAccess::RowMap);
 		}
-		// No reason to mark the package as dirty. We know we need to save right now.
-		if (!UEditorAssetLibrary::SaveLoadedAsset(DataTable, /*bOnlyIfIsDirty:*/ false))
+	};
+
+	// Patches DataTable to match StagedRows: removes, copies and adds rows as listed in Diff, then moves the rows into the order of
+	// StagedRows if that changed. Rows that didn't change are never copied or rebuilt.
+	void ApplyStagedRows(UDataTable* DataTable, const TMap<FName, uint8*>& StagedRows, const FRowDiff& Diff)
+	{
+		const UScriptStruct* RowStruct = DataTable->GetRowStruct();
+
+		FDataTableEditorUtils::BroadcastPreChange(DataTable, FDataTableEditorUtils::EDataTableChangeInfo::RowList);
+		DataTable->Modify();
+
+		for (const FName& RowName : Diff.Removed)
 		{
-			// SaveLoadedAsset will print its own errors, but we want to add one here so that we can
-			// properly track if the run as a whole succeeded or not.
-			InOutErrors.Logf(TEXT("Unable to save asset %s"), *DataTable->GetName());
-			return;
+			DataTable->RemoveRow(RowName);
 		}
+		for (const FName& RowName : Diff.Changed)
+		{
+			RowStruct->CopyScriptStruct(DataTable->FindRowUnchecked(RowName), StagedRows.FindChecked(RowName));
+		}
+		for (const FName& RowName : Diff.Added)
+		{
+			DataTable->AddRow(RowName, *reinterpret_cast<const FTableRowBase*>(StagedRows.FindChecked(RowName)));
+		}
+
+		if (Diff.bOrderChanged)
+		{
+			TMap<FName, uint8*>& RowMap = FDataTableRowMapAccess::Get(DataTable);
+			TMap<FName, uint8*> OrderedRowMap;
+			OrderedRowMap.Reserve(RowMap.Num());
+			for (const TPair<FName, uint8*>& StagedRow : StagedRows)
+			{
+				OrderedRowMap.Add(StagedRow.Key, RowMap.FindChecked(StagedRow.Key));
+			}
+			RowMap = MoveTemp(OrderedRowMap);
+		}
+
+		FDataTableEditorUtils::BroadcastPostChange(DataTable, FDataTableEditorUtils::EDataTableChangeInfo::RowList);
+	}
+
+	void LogRowDiff(const UDataTable* DataTable, const FRowDiff& Diff)
+	{
+		UE_LOG(LogPMXlsxImporter, Log, TEXT("%s: %i rows added, %i removed, %i changed, %i unchanged%s"), *DataTable->GetName(), Diff.Added.Num(),
+			Diff.Removed.Num(), Diff.Changed.Num(), Diff.Unchanged, Diff.bOrderChanged ? TEXT(", reordered") : TEXT(""));
+
+		const auto LogRowNames = [](const TCHAR* Category, const TArray<FName>& RowNames)
+		{
+			for (const FName& RowName : RowNames)
+			{
+				UE_LOG(LogPMXlsxImporter, VeryVerbose, TEXT("  %s: %s"), Category, *RowName.ToString());
+			}
+		};
+		LogRowNames(TEXT("Added"), Diff.Added);
+		LogRowNames(TEXT("Removed"), Diff.Removed);
+		LogRowNames(TEXT("Changed"), Diff.Changed);
 	}
 }
 
-bool FPMXlsxDataTableImportUtils::WasDataTableModified(UDataTable* Updated, UDataTable* Original)
+void FPMXlsxDataTableImportUtils::ImportDataTableFromXlsx(UDataTable* DataTable, const FPMXlsxWorksheetData& WorksheetData,
+                                                          FPMXlsxImporterContextLogger& InOutErrors)
 {
-	// Export this and Original as text, then compare the text
+	const UScriptStruct* RowStruct = DataTable->GetRowStruct();
+	if (RowStruct == nullptr)
+	{
+		InOutErrors.Logf(TEXT("DataTable %s has no row struct"), *DataTable->GetName());
+		return;
+	}
+
+	// Read the rows straight from the worksheet data, by column index, into staged rows, then compare them with DataTable row by row.
+	// It would be more accurate to compare with what's currently checked into source control,
+	// but that would be very slow.
+	const FString RowKey = DataTable->ImportKeyField.IsEmpty() ? TEXT("Name") : DataTable->ImportKeyField;
+	const TSharedRef<const FPMXlsxColumnBindings> ColumnBindings = FPMXlsxDataAssetImporterJSON::PrepareColumnBindings(RowStruct, WorksheetData, RowKey);
+	FStagedRows StagedRows(*RowStruct);
+	StagedRows.Rows.Reserve(WorksheetData.Num());
+
+	// Array used to store problems about table creation
+	TArray<FString> OutProblems;
+	for (int32 RowIndex = 0; RowIndex < WorksheetData.Num(); ++RowIndex)
+	{
+		FString RowError;
+		if (!WorksheetData.IsRowValid(RowIndex, RowError))
+		{
+			OutProblems.Add(RowError);
+			continue;
+		}
+
+		FString RowNameString;
+		WorksheetData.TryGetRowString(RowIndex, ColumnBindings->RowKeyColumn, RowNameString);
+		const FName RowName = DataTableUtils::MakeValidName(RowNameString);
+		if (RowName.IsNone())
+		{
+			OutProblems.Add(FString::Printf(TEXT("Row '%d' missing key field '%s'."), RowIndex, *RowKey));
+			continue;
+		}
+
+		if (StagedRows.Rows.Contains(RowName))
+		{
+			OutProblems.Add(FString::Printf(TEXT("Duplicate row name '%s'."), *RowName.ToString()));
+			continue;
+		}
+
+		FPMXlsxDataAssetImporterJSON::ReadTableRow(*DataTable, WorksheetData, RowIndex, *ColumnBindings, StagedRows.Add(RowName), OutProblems);
+	}
 
-	const FString OriginalArchive = Original->GetTableAsString();
+	// Rows are told they were imported, as UDataTable::CreateTableFromJSONString does
+	if (RowStruct->IsChildOf(FTableRowBase::StaticStruct()))
+	{
+		for (const TPair<FName, uint8*>& StagedRow : StagedRows.Rows)
+		{
+			reinterpret_cast<FTableRowBase*>(StagedRow.Value)->OnPostDataImport(DataTable, StagedRow.Key, OutProblems);
+		}
+	}
 
-	const FString UpdatedArchive = Updated->GetTableAsString();
+	for (FString Problem : OutProblems)
+	{
+		InOutErrors.Logf(TEXT("%s"), *Problem);
+	}
 
-	const bool bWasModified = OriginalArchive != UpdatedArchive;
-	UE_LOG(LogPMXlsxImporter, Verbose, TEXT("%s %s modified"), *Updated->GetName(), bWasModified ? TEXT("WAS") : TEXT("was NOT"));
+	if (!OutProblems.IsEmpty())
+	{
+		return;
+	}
 
-	if (bWasModified)
+	// Telling Unreal to save a file guarantees the file becomes modified even if there aren't meaningful changes to
+	// that file's data. We only want to check out and save modified assets.
+	FRowDiff Diff;
 	{
-		UE_LOG(LogPMXlsxImporter, VeryVerbose, TEXT("Orignal: %s"), *OriginalArchive);
-		UE_LOG(LogPMXlsxImporter, VeryVerbose, TEXT("Updated: %s"), *UpdatedArchive);
+		PMXLSX_IMPORT_STAGE_SCOPE(WasModified);
+		Diff = DiffRows(StagedRows.Rows, DataTable);
 	}
-	else
+	UE_LOG(LogPMXlsxImporter, Verbose, TEXT("%s %s modified"), *DataTable->GetName(), Diff.IsEmpty() ? TEXT("was NOT") : TEXT("WAS"));
+	if (!Diff.IsEmpty())
 	{
-		UE_LOG(LogPMXlsxImporter, VeryVerbose, TEXT("%s"), *OriginalArchive);
+		LogRowDiff(DataTable, Diff);
+
+		// Do the actual import here, only touching the rows that changed
+		ApplyStagedRows(DataTable, StagedRows.Rows, Diff);
 	}
 
-	return bWasModified;
+	// A dirty table may hold changes of an import run that failed before it could save them
+	if (!Diff.IsEmpty() || DataTable->GetOutermost()->IsDirty())
+	{
+		// Saved at the end of the import run, together with all other modified assets
+		FPMXlsxImporterRunContext::SaveModifiedAsset(DataTable, InOutErrors);
+	}
 }
 
+bool FPMXlsxDataTableImportUtils::WasDataTableModified(UDataTable* Updated, UDataTable* Original)
+{
+	PMXLSX_IMPORT_STAGE_SCOPE(WasModified);
+	// Compare row names, then each row's struct in binary
+	const bool bWasModified = Updated->GetRowStruct() != Original->GetRowStruct() || !DiffRows(Updated->GetRowMap(), Original).IsEmpty();
+	UE_LOG(LogPMXlsxImporter, Verbose, TEXT("%s %s modified"), *Original->GetName(), bWasModified ? TEXT("WAS") : TEXT("was NOT"));
+	return bWasModified;
+}
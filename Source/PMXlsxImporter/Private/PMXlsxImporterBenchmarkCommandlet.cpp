@@ -0,0 +1,370 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+
+#include "PMXlsxImporterBenchmarkCommandlet.h"
+
+#include "PMXlsxImporterBenchmarkTypes.h"
+#include "PMXlsxImporterContextLogger.h"
+#include "PMXlsxImporterLog.h"
+#include "PMXlsxImporterRunStats.h"
+#include "PMXlsxImporterSettings.h"
+#include "PMXlsxWorkbookWriter.h"
+#include "Dom/JsonObject.h"
+#include "Engine/AssetManager.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "ProfilingDebugging/MiscTrace.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace
+{
+	const TCHAR* const BENCHMARK_DIR = TEXT("PMXlsxImporterBenchmark");
+	const TCHAR* const DATA_ASSET_WORKSHEET = TEXT("DataAssets");
+	const TCHAR* const DATA_TABLE_WORKSHEET = TEXT("DataTable");
+	constexpr int32 NUM_DISTINCT_TAGS = 16;
+
+	struct FBenchmarkShape
+	{
+		int32 NumRows = 1000;
+		int32 NumColumns = 0;
+		int32 NumSplitStructs = 2;
+		int32 CellArrayLength = 4;
+		int32 SplitArrayLength = 4;
+		int32 NumTags = 2;
+		bool bDataAssets = true;
+		bool bDataTable = true;
+
+		void Parse(const FString& Params)
+		{
+			FParse::Value(*Params, TEXT("Rows="), NumRows);
+			FParse::Value(*Params, TEXT("Columns="), NumColumns);
+			FParse::Value(*Params, TEXT("SplitStructs="), NumSplitStructs);
+			FParse::Value(*Params, TEXT("CellArray="), CellArrayLength);
+			FParse::Value(*Params, TEXT("SplitArray="), SplitArrayLength);
+			FParse::Value(*Params, TEXT("Tags="), NumTags);
+
+			NumRows = FMath::Max(NumRows, 0);
+			NumSplitStructs = FMath::Max(NumSplitStructs, 0);
+			CellArrayLength = FMath::Max(CellArrayLength, 0);
+			// Without a SplitArray[0] column the readers would take the next column for an array in one cell
+			SplitArrayLength = FMath::Max(SplitArrayLength, 1);
+			NumTags = FMath::Max(NumTags, 0);
+
+			FString ImportType;
+			if (FParse::Value(*Params, TEXT("ImportType="), ImportType))
+			{
+				bDataAssets = !ImportType.Equals(TEXT("DataTable"));
+				bDataTable = !ImportType.Equals(TEXT("DataAsset"));
+			}
+		}
+
+		TSharedRef<FJsonObject> ToJson() const
+		{
+			TSharedRef<FJsonObject> Object = MakeShared<FJsonObject>();
+			Object->SetNumberField(TEXT("Rows"), NumRows);
+			Object->SetNumberField(TEXT("Columns"), NumColumns);
+			Object->SetNumberField(TEXT("SplitStructs"), NumSplitStructs);
+			Object->SetNumberField(TEXT("CellArray"), CellArrayLength);
+			Object->SetNumberField(TEXT("SplitArray"), SplitArrayLength);
+			Object->SetNumberField(TEXT("Tags"), NumTags);
+			Object->SetStringField(TEXT("ImportType"), bDataAssets && bDataTable ? TEXT("Both") : bDataAssets ? TEXT("DataAsset") : TEXT("DataTable"));
+			return Object;
+		}
+	};
+
+	void AddString(FPMXlsxRow& OutRow, const FString& Value)
+	{
+		FPMXlsxCell& Cell = OutRow.AddDefaulted_GetRef();
+		Cell.Type = EPMXlsxCellType::String;
+		Cell.Value = Value;
+	}
+
+	void AddNumber(FPMXlsxRow& OutRow, const FString& Value)
+	{
+		FPMXlsxCell& Cell = OutRow.AddDefaulted_GetRef();
+		Cell.Type = EPMXlsxCellType::Number;
+		Cell.Value = Value;
+	}
+
+	// Column names of UPMXlsxBenchmarkDataAsset and FPMXlsxBenchmarkTableRow, in the layouts the field parsers expect
+	void MakeHeaderRow(const FBenchmarkShape& Shape, FPMXlsxRow& OutRow)
+	{
+		AddString(OutRow, TEXT("Name"));
+		AddString(OutRow, TEXT("IntValue"));
+		AddString(OutRow, TEXT("FloatValue"));
+		AddString(OutRow, TEXT("BoolValue"));
+		AddString(OutRow, TEXT("StringValue"));
+		AddString(OutRow, TEXT("SplitStruct.Count"));
+		AddString(OutRow, TEXT("SplitStruct.Weight"));
+		AddString(OutRow, TEXT("SplitStruct.Label"));
+		for (int32 Index = 0; Index < Shape.NumSplitStructs; ++Index)
+		{
+			AddString(OutRow, FString::Printf(TEXT("StructArray[%i].Count"), Index));
+			AddString(OutRow, FString::Printf(TEXT("StructArray[%i].Weight"), Index));
+			AddString(OutRow, FString::Printf(TEXT("StructArray[%i].Label"), Index));
+		}
+		AddString(OutRow, TEXT("CellArray"));
+		for (int32 Index = 0; Index < Shape.SplitArrayLength; ++Index)
+		{
+			AddString(OutRow, FString::Printf(TEXT("SplitArray[%i]"), Index));
+		}
+		AddString(OutRow, TEXT("Tags"));
+
+		// Columns after the last field are not imported, they only make the worksheet wider
+		for (int32 NoteIndex = 0; OutRow.Num() < Shape.NumColumns; ++NoteIndex)
+		{
+			AddString(OutRow, FString::Printf(TEXT("Note%i"), NoteIndex));
+		}
+	}
+
+	void MakeDataRow(const FBenchmarkShape& Shape, int32 DataRowIndex, FPMXlsxRow& OutRow)
+	{
+		AddString(OutRow, FString::Printf(TEXT("Row%i"), DataRowIndex));
+		AddNumber(OutRow, FString::FromInt(DataRowIndex));
+		AddNumber(OutRow, FString::SanitizeFloat(DataRowIndex * 0.25));
+		FPMXlsxCell& BoolCell = OutRow.AddDefaulted_GetRef();
+		BoolCell.Type = EPMXlsxCellType::Bool;
+		BoolCell.Value = DataRowIndex % 2 ? TEXT("1") : TEXT("0");
+		AddString(OutRow, FString::Printf(TEXT("Value of row %i"), DataRowIndex));
+
+		AddNumber(OutRow, FString::FromInt(DataRowIndex));
+		AddNumber(OutRow, TEXT("0.5"));
+		AddString(OutRow, TEXT("Split struct"));
+		for (int32 Index = 0; Index < Shape.NumSplitStructs; ++Index)
+		{
+			AddNumber(OutRow, FString::FromInt(DataRowIndex + Index));
+			AddNumber(OutRow, FString::SanitizeFloat(Index * 1.5));
+			AddString(OutRow, FString::Printf(TEXT("Element %i"), Index));
+		}
+
+		TArray<FString> CellArray;
+		for (int32 Index = 0; Index < Shape.CellArrayLength; ++Index)
+		{
+			CellArray.Add(FString::FromInt(DataRowIndex + Index));
+		}
+		AddString(OutRow, CellArray.Num() > 0 ? FString::Join(CellArray, TEXT(", ")) : TEXT("[]"));
+
+		for (int32 Index = 0; Index < Shape.SplitArrayLength; ++Index)
+		{
+			AddNumber(OutRow, FString::SanitizeFloat(DataRowIndex + Index * 0.5));
+		}
+
+		// Tags are written without the "PMXlsxBenchmark." of the GameplayTagFilter, which the readers add back
+		TArray<FString> Tags;
+		for (int32 Index = 0; Index < Shape.NumTags; ++Index)
+		{
+			Tags.Add(FString::Printf(TEXT("Tag%i"), (DataRowIndex + Index) % NUM_DISTINCT_TAGS));
+		}
+		AddString(OutRow, FString::Join(Tags, TEXT(", ")));
+
+		while (OutRow.Num() < Shape.NumColumns)
+		{
+			AddString(OutRow, TEXT("Note"));
+		}
+	}
+
+	// Sets "StageSeconds" to the wall-clock stages and "StageCpuSeconds" to the stages summed over all threads
+	void SetStageFields(FJsonObject& OutObject, TFunctionRef<double(EPMXlsxImportStage)> GetStageSeconds)
+	{
+		TSharedRef<FJsonObject> StageObject = MakeShared<FJsonObject>();
+		TSharedRef<FJsonObject> CpuStageObject = MakeShared<FJsonObject>();
+		for (int32 Stage = 0; Stage < static_cast<int32>(EPMXlsxImportStage::Num); ++Stage)
+		{
+			const EPMXlsxImportStage ImportStage = static_cast<EPMXlsxImportStage>(Stage);
+			FJsonObject& Object = FPMXlsxImporterRunStats::IsSummedOverThreads(ImportStage) ? *CpuStageObject : *StageObject;
+			Object.SetNumberField(FPMXlsxImporterRunStats::GetStageName(ImportStage), GetStageSeconds(ImportStage));
+		}
+		OutObject.SetObjectField(TEXT("StageSeconds"), StageObject);
+		OutObject.SetObjectField(TEXT("StageCpuSeconds"), CpuStageObject);
+	}
+
+	TSharedRef<FJsonObject> MakeEntryObject(const FPMXlsxImporterRunStats::FEntry& Entry)
+	{
+		TSharedRef<FJsonObject> EntryObject = MakeShared<FJsonObject>();
+		EntryObject->SetStringField(TEXT("Name"), Entry.Name);
+		EntryObject->SetNumberField(TEXT("Rows"), Entry.NumRows);
+		EntryObject->SetNumberField(TEXT("Bytes"), Entry.NumBytes);
+		SetStageFields(*EntryObject, [&Entry](EPMXlsxImportStage Stage) { return Entry.StageSeconds[static_cast<int32>(Stage)]; });
+		return EntryObject;
+	}
+}
+
+int32 UPMXlsxImporterBenchmarkCommandlet::Main(const FString& Params)
+{
+	const TCHAR* KEEP_ASSETS_SWITCH = TEXT("KeepAssets");
+	const TCHAR* PARALLEL_PARSE_DATA_SWITCH = TEXT("ParallelParseData");
+	const TCHAR* JSON_INTERCHANGE_SWITCH = TEXT("JsonInterchange");
+
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	ParseCommandLine(*Params, Tokens, Switches);
+
+	// From PythonScriptCommandlet.cpp: tick once to ensure that any start-up scripts have been run
+	FTSTicker::GetCoreTicker().Tick(0.0f);
+
+	FBenchmarkShape Shape;
+	Shape.Parse(Params);
+
+	// Paths relative to the project dir, like the ones of the project settings
+	const FString XlsxFilePath = FString::Printf(TEXT("Intermediate/%s/Benchmark.xlsx"), BENCHMARK_DIR);
+	const FString OutputDirPath = FString::Printf(TEXT("Content/%s"), BENCHMARK_DIR);
+	const FString XlsxAbsolutePath = FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), XlsxFilePath);
+	const FString OutputDirAbsolutePath = FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), OutputDirPath);
+
+	const double GenerateStartTime = FPlatformTime::Seconds();
+	{
+		FPMXlsxWorkbookWriter Workbook;
+		const auto MakeRow = [&Shape](int32 RowIndex, FPMXlsxRow& OutRow)
+		{
+			if (RowIndex == 0)
+			{
+				MakeHeaderRow(Shape, OutRow);
+			}
+			else
+			{
+				MakeDataRow(Shape, RowIndex - 1, OutRow);
+			}
+		};
+		if (Shape.bDataAssets)
+		{
+			Workbook.AddWorksheet(DATA_ASSET_WORKSHEET, Shape.NumRows + 1, MakeRow);
+		}
+		if (Shape.bDataTable)
+		{
+			Workbook.AddWorksheet(DATA_TABLE_WORKSHEET, Shape.NumRows + 1, MakeRow);
+		}
+
+		FString Error;
+		if (!Workbook.Save(XlsxAbsolutePath, Error))
+		{
+			UE_LOG(LogPMXlsxImporter, Error, TEXT("Could not generate the benchmark workbook: %s"), *Error);
+			return 1;
+		}
+	}
+	const double GenerateSeconds = FPlatformTime::Seconds() - GenerateStartTime;
+
+	// Let the AssetManager know the benchmark asset type, the project doesn't have to list it
+	const FPrimaryAssetType DataAssetType = UPMXlsxBenchmarkDataAsset::StaticClass()->GetFName();
+	if (Shape.bDataAssets)
+	{
+		if (!UAssetManager::IsValid())
+		{
+			UE_LOG(LogPMXlsxImporter, Error, TEXT("Could not register %s: there is no AssetManager"), *DataAssetType.ToString());
+			return 1;
+		}
+		UAssetManager::Get().ScanPathForPrimaryAssets(DataAssetType, FString::Printf(TEXT("/Game/%s"), BENCHMARK_DIR), UPMXlsxBenchmarkDataAsset::StaticClass(),
+			/*bHasBlueprintClasses:*/ false, /*bIsEditorOnly:*/ true, /*bForceSynchronousScan:*/ true);
+	}
+
+	// Import only the benchmark entries. The settings object is never saved, so the project's config is left alone
+	UPMXlsxImporterSettings* SettingsCDO = GetMutableDefault<UPMXlsxImporterSettings>();
+	SettingsCDO->AssetImportSettings.Reset();
+	if (Shape.bDataAssets)
+	{
+		FPMXlsxImporterSettingsEntry& Entry = SettingsCDO->AssetImportSettings.AddDefaulted_GetRef();
+		Entry.ImportType = EPMXlsxImportType::DataAsset;
+		Entry.DataAssetType = DataAssetType;
+		Entry.XlsxFile.FilePath = XlsxFilePath;
+		Entry.WorksheetName = DATA_ASSET_WORKSHEET;
+		Entry.OutputDir.Path = OutputDirPath / DATA_ASSET_WORKSHEET;
+	}
+	if (Shape.bDataTable)
+	{
+		FPMXlsxImporterSettingsEntry& Entry = SettingsCDO->AssetImportSettings.AddDefaulted_GetRef();
+		Entry.ImportType = EPMXlsxImportType::DataTable;
+		Entry.DataTableRowType = FPMXlsxBenchmarkTableRow::StaticStruct();
+		Entry.XlsxFile.FilePath = XlsxFilePath;
+		Entry.WorksheetName = DATA_TABLE_WORKSHEET;
+		Entry.OutputDir.Path = OutputDirPath / DATA_TABLE_WORKSHEET;
+	}
+
+	FString ReaderName;
+	if (FParse::Value(*Params, TEXT("Reader="), ReaderName))
+	{
+		SettingsCDO->ReaderBackend = ReaderName.Equals(TEXT("Python")) ? EPMXlsxReaderBackend::Python : EPMXlsxReaderBackend::Native;
+	}
+	FParse::Value(*Params, TEXT("PipelineDepth="), SettingsCDO->PipelineDepth);
+	SettingsCDO->bParallelParseData |= Switches.Contains(PARALLEL_PARSE_DATA_SWITCH);
+	SettingsCDO->bUseJsonInterchange |= Switches.Contains(JSON_INTERCHANGE_SWITCH);
+	SettingsCDO->JsonDebugDump = EPMXlsxJsonDumpMode::Off;
+	SettingsCDO->XlsxHeaderRow = 1;
+	SettingsCDO->XlsxDataStartRow = 2;
+	SettingsCDO->bCheckoutGeneratedAssets = false;
+
+	const FPlatformMemoryStats MemoryBefore = FPlatformMemory::GetStats();
+
+	FPMXlsxImporterContextLogger Errors;
+	FPMXlsxImporterRunStats Stats;
+	// With -trace=default,memalloc, Memory Insights shows the allocations made between these bookmarks, by callstack and LLM tag
+	TRACE_BOOKMARK(TEXT("PMXlsxImporterBenchmark import started"));
+	// Forced so that every run reads the workbook, even when the manifest still has the hashes of a previous run
+	SettingsCDO->ImportAll(Errors, /*bForce:*/ true, &Stats);
+	TRACE_BOOKMARK(TEXT("PMXlsxImporterBenchmark import finished"));
+
+	const FPlatformMemoryStats MemoryAfter = FPlatformMemory::GetStats();
+
+	UE_LOG(LogPMXlsxImporter, Log, TEXT("Benchmark import run completed with %i errors"), Errors.Num());
+	Stats.LogSummary();
+	Errors.Flush();
+
+	TSharedRef<FJsonObject> SettingsObject = MakeShared<FJsonObject>();
+	SettingsObject->SetStringField(TEXT("Reader"), SettingsCDO->ReaderBackend == EPMXlsxReaderBackend::Python ? TEXT("Python") : TEXT("Native"));
+	SettingsObject->SetNumberField(TEXT("PipelineDepth"), SettingsCDO->PipelineDepth);
+	SettingsObject->SetBoolField(TEXT("ParallelParseData"), SettingsCDO->bParallelParseData);
+	SettingsObject->SetBoolField(TEXT("JsonInterchange"), SettingsCDO->bUseJsonInterchange);
+
+	TArray<TSharedPtr<FJsonValue>> EntryValues;
+	EntryValues.Add(MakeShared<FJsonValueObject>(MakeEntryObject(Stats.GetRun())));
+	for (const FPMXlsxImporterRunStats::FEntry& Entry : Stats.GetEntries())
+	{
+		EntryValues.Add(MakeShared<FJsonValueObject>(MakeEntryObject(Entry)));
+	}
+
+	const double TotalSeconds = Stats.GetTotalSeconds();
+	TSharedRef<FJsonObject> ResultObject = MakeShared<FJsonObject>();
+	ResultObject->SetObjectField(TEXT("Shape"), Shape.ToJson());
+	ResultObject->SetObjectField(TEXT("Settings"), SettingsObject);
+	ResultObject->SetNumberField(TEXT("Errors"), Errors.Num());
+	ResultObject->SetNumberField(TEXT("XlsxFileBytes"), IFileManager::Get().FileSize(*XlsxAbsolutePath));
+	ResultObject->SetNumberField(TEXT("GenerateSeconds"), GenerateSeconds);
+	ResultObject->SetNumberField(TEXT("TotalSeconds"), TotalSeconds);
+	ResultObject->SetNumberField(TEXT("Rows"), Stats.GetNumRows());
+	ResultObject->SetNumberField(TEXT("RowsPerSecond"), TotalSeconds > 0.0 ? Stats.GetNumRows() / TotalSeconds : 0.0);
+	ResultObject->SetNumberField(TEXT("Bytes"), Stats.GetNumBytes());
+	ResultObject->SetNumberField(TEXT("SavedAssets"), Stats.GetNumSavedAssets());
+	ResultObject->SetNumberField(TEXT("UsedPhysicalBytesBefore"), MemoryBefore.UsedPhysical);
+	ResultObject->SetNumberField(TEXT("UsedPhysicalBytesAfter"), MemoryAfter.UsedPhysical);
+	// Peak of the whole process, which includes the editor's startup
+	ResultObject->SetNumberField(TEXT("PeakUsedPhysicalBytes"), MemoryAfter.PeakUsedPhysical);
+	SetStageFields(*ResultObject, [&Stats](EPMXlsxImportStage Stage) { return Stats.GetStageSeconds(Stage); });
+	ResultObject->SetArrayField(TEXT("Entries"), EntryValues);
+
+	FString ResultString;
+	const TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> JsonWriter = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&ResultString);
+	FJsonSerializer::Serialize(ResultObject, JsonWriter);
+	UE_LOG(LogPMXlsxImporter, Log, TEXT("Benchmark results:\n%s"), *ResultString);
+
+	FString ResultPath = FPaths::ProjectSavedDir() / BENCHMARK_DIR / TEXT("Results.json");
+	FParse::Value(*Params, TEXT("Output="), ResultPath);
+	int32 Result = Errors.Num();
+	if (!FFileHelper::SaveStringToFile(ResultString, *ResultPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		UE_LOG(LogPMXlsxImporter, Error, TEXT("Could not write benchmark results to %s"), *ResultPath);
+		Result = FMath::Max(Result, 1);
+	}
+
+	if (!Switches.Contains(KEEP_ASSETS_SWITCH))
+	{
+		IFileManager& FileManager = IFileManager::Get();
+		FileManager.Delete(*XlsxAbsolutePath);
+		FileManager.DeleteDirectory(*OutputDirAbsolutePath, /*RequireExists:*/ false, /*Tree:*/ true);
+	}
+
+	return Result;
+}
@@ -0,0 +1,105 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataTable.h"
+#include "GameplayTagContainer.h"
+#include "PMXlsxDataAsset.h"
+#include "PMXlsxImporterBenchmarkTypes.generated.h"
+
+// Element of the split structs imported by UPMXlsxImporterBenchmarkCommandlet
+USTRUCT()
+struct FPMXlsxBenchmarkStruct
+{
+	GENERATED_BODY()
+
+	UPROPERTY(meta = (ImportFromXLSX))
+	int32 Count = 0;
+
+	UPROPERTY(meta = (ImportFromXLSX))
+	float Weight = 0.0f;
+
+	UPROPERTY(meta = (ImportFromXLSX))
+	FString Label;
+};
+
+// Data asset imported by UPMXlsxImporterBenchmarkCommandlet. Its fields cover each column layout of the readers,
+// the row struct FPMXlsxBenchmarkTableRow has the same ones.
+UCLASS()
+class UPMXlsxBenchmarkDataAsset : public UPMXlsxDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(meta = (ImportFromXLSX))
+	int32 IntValue = 0;
+
+	UPROPERTY(meta = (ImportFromXLSX))
+	float FloatValue = 0.0f;
+
+	UPROPERTY(meta = (ImportFromXLSX))
+	bool BoolValue = false;
+
+	UPROPERTY(meta = (ImportFromXLSX))
+	FString StringValue;
+
+	// Columns "SplitStruct.Count", "SplitStruct.Weight" and "SplitStruct.Label"
+	UPROPERTY(meta = (ImportFromXLSX, SplitStructInXLSX))
+	FPMXlsxBenchmarkStruct SplitStruct;
+
+	// Columns "StructArray[<i>].Count", "StructArray[<i>].Weight" and "StructArray[<i>].Label" for each element
+	UPROPERTY(meta = (ImportFromXLSX, SplitStructInXLSX))
+	TArray<FPMXlsxBenchmarkStruct> StructArray;
+
+	// All elements in one cell, e.g. "1, 2, 3"
+	UPROPERTY(meta = (ImportFromXLSX))
+	TArray<int32> CellArray;
+
+	// Columns "SplitArray[<i>]" for each element
+	UPROPERTY(meta = (ImportFromXLSX))
+	TArray<float> SplitArray;
+
+	// Tags in one cell without their "PMXlsxBenchmark." prefix, e.g. "Tag0, Tag1"
+	UPROPERTY(meta = (ImportFromXLSX, GameplayTagFilter = "PMXlsxBenchmark"))
+	FGameplayTagContainer Tags;
+
+#ifdef WITH_EDITOR
+	// Only uses the default conversion, so -ParallelParseData can stage its rows
+	virtual bool SupportsParallelImport() const override { return true; }
+#endif
+};
+
+// DataTable row imported by UPMXlsxImporterBenchmarkCommandlet, see UPMXlsxBenchmarkDataAsset
+USTRUCT()
+struct FPMXlsxBenchmarkTableRow : public FTableRowBase
+{
+	GENERATED_BODY()
+
+	UPROPERTY(meta = (ImportFromXLSX))
+	int32 IntValue = 0;
+
+	UPROPERTY(meta = (ImportFromXLSX))
+	float FloatValue = 0.0f;
+
+	UPROPERTY(meta = (ImportFromXLSX))
+	bool BoolValue = false;
+
+	UPROPERTY(meta = (ImportFromXLSX))
+	FString StringValue;
+
+	UPROPERTY(meta = (ImportFromXLSX, SplitStructInXLSX))
+	FPMXlsxBenchmarkStruct SplitStruct;
+
+	UPROPERTY(meta = (ImportFromXLSX, SplitStructInXLSX))
+	TArray<FPMXlsxBenchmarkStruct> StructArray;
+
+	UPROPERTY(meta = (ImportFromXLSX))
+	TArray<int32> CellArray;
+
+	UPROPERTY(meta = (ImportFromXLSX))
+	TArray<float> SplitArray;
+
+	UPROPERTY(meta = (ImportFromXLSX, GameplayTagFilter = "PMXlsxBenchmark"))
+	FGameplayTagContainer Tags;
+};
@@ -8,6 +8,7 @@
 int32 UPMXlsxImporterCommandlet::Main(const FString& Params)
 {
 	const TCHAR* CHECKED_OUT_SWTICH = TEXT("c");
+	const TCHAR* FORCE_SWITCH = TEXT("Force");
 
 	TArray<FString> Tokens;
 	TArray<FString> Switches;
@@ -18,16 +19,19 @@ int32 UPMXlsxImporterCommandlet::Main(const FString& Params)
 
 	const UPMXlsxImporterSettings* SettingsCDO = GetDefault<UPMXlsxImporterSettings>();
 	FPMXlsxImporterContextLogger Errors;
+	FPMXlsxImporterRunStats Stats;
+	const bool bForce = Switches.Contains(FORCE_SWITCH);
 	if (Switches.Contains(CHECKED_OUT_SWTICH))
 	{
-		SettingsCDO->ImportCheckedOut(Errors);
+		SettingsCDO->ImportCheckedOut(Errors, bForce, &Stats);
 	}
 	else
 	{
-		SettingsCDO->ImportAll(Errors);
+		SettingsCDO->ImportAll(Errors, bForce, &Stats);
 	}
 
 	UE_LOG(LogPMXlsxImporter, Log, TEXT("Import run completed with %i errors"), Errors.Num());
+	Stats.LogSummary();
 	Errors.Flush();
 
 	return Errors.Num();
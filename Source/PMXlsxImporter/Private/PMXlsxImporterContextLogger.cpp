@@ -2,39 +2,175 @@
 
 #include "PMXlsxImporterContextLogger.h"
 #include "PMXlsxImporterLog.h"
+#include "HAL/PlatformTLS.h"
+#include "Misc/ScopeLock.h"
+#include "UObject/UnrealType.h"
 
 FPMXlsxImporterContextLogger::FPMXlsxImporterContextLogger()
+	: OwnerThreadId(FPlatformTLS::GetCurrentThreadId())
 {
 }
 
 void FPMXlsxImporterContextLogger::Serialize(const TCHAR* V, ELogVerbosity::Type Verbosity, const FName& Category)
 {
-	FString Context = FString::Join(ContextStack, TEXT(""));
-	Errors.Add(FString::Printf(TEXT("%s: %s"), *Context, V));
+	FThreadState& State = GetThreadState();
+
+	FError Error;
+	FString Context;
+	for (const FContextFrame& Frame : State.ContextStack)
+	{
+		if (Frame.Kind == FContextFrame::EKind::Order)
+		{
+			Error.Orders.Add(Frame.Index);
+		}
+		else
+		{
+			AppendFrame(State, Frame, Context);
+		}
+	}
+	Error.Message = FString::Printf(TEXT("%s: %s"), *Context, V);
+	Error.Sequence = NumErrors.fetch_add(1);
+
+	State.Errors.Add(MoveTemp(Error));
 }
 
 void FPMXlsxImporterContextLogger::Flush()
 {
-	for (const FString& Err : Errors)
+	TArray<const FError*> AllErrors;
+	AllErrors.Reserve(Num());
+	for (const FError& Error : OwnerState.Errors)
+	{
+		AllErrors.Add(&Error);
+	}
+	{
+		FScopeLock Lock(&ThreadStatesCriticalSection);
+		for (const TPair<uint32, TUniquePtr<FThreadState>>& ThreadState : ThreadStates)
+		{
+			for (const FError& Error : ThreadState.Value->Errors)
+			{
+				AllErrors.Add(&Error);
+			}
+		}
+	}
+
+	AllErrors.Sort([](const FError& A, const FError& B)
+	{
+		for (int32 Index = 0; Index < A.Orders.Num() && Index < B.Orders.Num(); ++Index)
+		{
+			if (A.Orders[Index] != B.Orders[Index])
+			{
+				return A.Orders[Index] < B.Orders[Index];
+			}
+		}
+		if (A.Orders.Num() != B.Orders.Num())
+		{
+			return A.Orders.Num() < B.Orders.Num();
+		}
+		return A.Sequence < B.Sequence;
+	});
+
+	for (const FError* Err : AllErrors)
 	{
-		UE_LOG(LogPMXlsxImporter, Error, TEXT("%s"), *Err);
+		UE_LOG(LogPMXlsxImporter, Error, TEXT("%s"), *Err->Message);
 	}
 }
 
 FPMXlsxImporterContextLoggerScopedContext FPMXlsxImporterContextLogger::PushContext(const FString& Context)
 {
-	ContextStack.Add(Context);
+	FContextFrame Frame;
+	Frame.Kind = FContextFrame::EKind::String;
+	Frame.Index = GetThreadState().ContextStrings.Add(Context);
+	return PushFrame(Frame);
+}
+
+FPMXlsxImporterContextLoggerScopedContext FPMXlsxImporterContextLogger::PushObjectContext(const UObject& Object)
+{
+	FContextFrame Frame;
+	Frame.Kind = FContextFrame::EKind::Object;
+	Frame.Object = &Object;
+	return PushFrame(Frame);
+}
+
+FPMXlsxImporterContextLoggerScopedContext FPMXlsxImporterContextLogger::PushPropertyContext(const FProperty& Property)
+{
+	FContextFrame Frame;
+	Frame.Kind = FContextFrame::EKind::Property;
+	Frame.Property = &Property;
+	return PushFrame(Frame);
+}
+
+FPMXlsxImporterContextLoggerScopedContext FPMXlsxImporterContextLogger::PushIndexContext(int32 Index)
+{
+	FContextFrame Frame;
+	Frame.Kind = FContextFrame::EKind::Index;
+	Frame.Index = Index;
+	return PushFrame(Frame);
+}
+
+FPMXlsxImporterContextLoggerScopedContext FPMXlsxImporterContextLogger::PushOrder(int32 Order)
+{
+	FContextFrame Frame;
+	Frame.Kind = FContextFrame::EKind::Order;
+	Frame.Index = Order;
+	return PushFrame(Frame);
+}
+
+FPMXlsxImporterContextLoggerScopedContext FPMXlsxImporterContextLogger::PushFrame(const FContextFrame& Frame)
+{
+	GetThreadState().ContextStack.Add(Frame);
 	return FPMXlsxImporterContextLoggerScopedContext(*this);
 }
 
 void FPMXlsxImporterContextLogger::PopContext()
 {
-	ContextStack.Pop();
+	FThreadState& State = GetThreadState();
+	if (State.ContextStack.Pop().Kind == FContextFrame::EKind::String)
+	{
+		State.ContextStrings.Pop();
+	}
+}
+
+FPMXlsxImporterContextLogger::FThreadState& FPMXlsxImporterContextLogger::GetThreadState()
+{
+	const uint32 ThreadId = FPlatformTLS::GetCurrentThreadId();
+	if (ThreadId == OwnerThreadId)
+	{
+		return OwnerState;
+	}
+
+	FScopeLock Lock(&ThreadStatesCriticalSection);
+	TUniquePtr<FThreadState>& State = ThreadStates.FindOrAdd(ThreadId);
+	if (!State.IsValid())
+	{
+		State = MakeUnique<FThreadState>();
+	}
+	return *State;
+}
+
+void FPMXlsxImporterContextLogger::AppendFrame(const FThreadState& State, const FContextFrame& Frame, FString& OutContext) const
+{
+	switch (Frame.Kind)
+	{
+	case FContextFrame::EKind::String:
+		OutContext += State.ContextStrings[Frame.Index];
+		break;
+	case FContextFrame::EKind::Object:
+		OutContext += FString::Printf(TEXT(": %s %s"), *Frame.Object->GetClass()->GetName(), *Frame.Object->GetName());
+		break;
+	case FContextFrame::EKind::Property:
+		OutContext += FString::Printf(TEXT(".%s %s"), *Frame.Property->GetNameCPP(), *Frame.Property->GetCPPType());
+		break;
+	case FContextFrame::EKind::Index:
+		OutContext += FString::Printf(TEXT("[%i]"), Frame.Index);
+		break;
+	case FContextFrame::EKind::Order:
+		break;
+	}
 }
 
 int32 FPMXlsxImporterContextLogger::Num() const
 {
-	return Errors.Num();
+	return NumErrors.load();
 }
 
 FPMXlsxImporterContextLoggerScopedContext::FPMXlsxImporterContextLoggerScopedContext(FPMXlsxImporterContextLogger& Owner)
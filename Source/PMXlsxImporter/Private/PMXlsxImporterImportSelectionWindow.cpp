@@ -89,19 +89,20 @@ void UPMXlsxImporterImportSelectionWindow::OnImportButtonClicked()
 {
 	const UPMXlsxImporterSettings* SettingsCDO = GetDefault<UPMXlsxImporterSettings>();
 	FPMXlsxImporterContextLogger Errors;
+	FPMXlsxImporterRunStats Stats;
 
 	if (CheckedOutOption->IsChecked())
 	{
-		SettingsCDO->ImportCheckedOut(Errors);
+		SettingsCDO->ImportCheckedOut(Errors, /*bForce:*/ false, &Stats);
 	}
 	else if (AllFilesOption->IsChecked())
 	{
-		SettingsCDO->ImportAll(Errors);
+		SettingsCDO->ImportAll(Errors, /*bForce:*/ false, &Stats);
 	}
 	else if (OneWorksheetOption->IsChecked())
 	{
 		int SelectedIndex = WorksheetSelector->GetSelectedIndex();
-		SettingsCDO->ImportEntry(SelectedIndex, Errors);
+		SettingsCDO->ImportEntry(SelectedIndex, Errors, &Stats);
 	}
 	else
 	{
@@ -134,5 +135,6 @@ void UPMXlsxImporterImportSelectionWindow::OnImportButtonClicked()
 			Notification->SetCompletionState(SNotificationItem::CS_Success);
 		}
 	}
+	Stats.LogSummary();
 	Errors.Flush();
 }
@@ -0,0 +1,133 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+
+#include "PMXlsxImporterManifest.h"
+
+#include "PMXlsxImporterLog.h"
+#include "PMXlsxImporterSettings.h"
+#include "PMXlsxImporterSettingsEntry.h"
+#include "Dom/JsonObject.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace
+{
+	// Bump to invalidate all manifests, e.g. when the importer starts to produce different assets from the same input
+	const int32 ManifestVersion = 1;
+}
+
+void FPMXlsxImporterManifest::Load()
+{
+	Hashes.Reset();
+
+	FString ManifestString;
+	if (!FFileHelper::LoadFileToString(ManifestString, *GetManifestPath()))
+	{
+		return;
+	}
+
+	TSharedPtr<FJsonObject> ManifestObject;
+	const TSharedRef<TJsonReader<TCHAR>> JsonReader = TJsonReaderFactory<TCHAR>::Create(ManifestString);
+	if (!FJsonSerializer::Deserialize(JsonReader, ManifestObject) || !ManifestObject.IsValid())
+	{
+		UE_LOG(LogPMXlsxImporter, Warning, TEXT("Ignoring invalid import manifest %s"), *GetManifestPath());
+		return;
+	}
+
+	int32 Version = 0;
+	const TSharedPtr<FJsonObject>* EntriesObject = nullptr;
+	if (!ManifestObject->TryGetNumberField(TEXT("Version"), Version) || Version != ManifestVersion ||
+		!ManifestObject->TryGetObjectField(TEXT("Entries"), EntriesObject))
+	{
+		return;
+	}
+
+	for (const TPair<FString, TSharedPtr<FJsonValue>>& Entry : (*EntriesObject)->Values)
+	{
+		FString Hash;
+		if (Entry.Value.IsValid() && Entry.Value->TryGetString(Hash))
+		{
+			Hashes.Add(Entry.Key, Hash);
+		}
+	}
+}
+
+bool FPMXlsxImporterManifest::Save() const
+{
+	const TSharedRef<FJsonObject> EntriesObject = MakeShared<FJsonObject>();
+	for (const TPair<FString, FString>& Entry : Hashes)
+	{
+		EntriesObject->SetStringField(Entry.Key, Entry.Value);
+	}
+
+	const TSharedRef<FJsonObject> ManifestObject = MakeShared<FJsonObject>();
+	ManifestObject->SetNumberField(TEXT("Version"), ManifestVersion);
+	ManifestObject->SetObjectField(TEXT("Entries"), EntriesObject);
+
+	FString ManifestString;
+	const TSharedRef<TJsonWriter<TCHAR>> JsonWriter = TJsonWriterFactory<TCHAR>::Create(&ManifestString);
+	if (!FJsonSerializer::Serialize(ManifestObject, JsonWriter) || !FFileHelper::SaveStringToFile(ManifestString, *GetManifestPath()))
+	{
+		UE_LOG(LogPMXlsxImporter, Warning, TEXT("Could not write import manifest %s"), *GetManifestPath());
+		return false;
+	}
+	return true;
+}
+
+bool FPMXlsxImporterManifest::ComputeHash(const FPMXlsxImporterSettingsEntry& Entry, FString& OutHash)
+{
+	FString XlsxAbsolutePath;
+	FPMXlsxImporterPythonBridgeWorksheetRequest Request;
+	if (!Entry.MakeWorksheetRequest(XlsxAbsolutePath, Request) || Request.WorksheetTypeInfo.Struct == nullptr)
+	{
+		return false;
+	}
+
+	const FMD5Hash* FileHash = FileHashes.Find(XlsxAbsolutePath);
+	if (FileHash == nullptr)
+	{
+		FileHash = &FileHashes.Add(XlsxAbsolutePath, FMD5Hash::HashFile(*XlsxAbsolutePath));
+	}
+	if (!FileHash->IsValid())
+	{
+		return false;
+	}
+
+	const UPMXlsxImporterSettings* SettingsCDO = GetDefault<UPMXlsxImporterSettings>();
+
+	// Everything that changes what gets imported from the file
+	const FString HashInput = FString::Printf(TEXT("%i|%s|%s|%i|%i|%i|%s|%s|%s"), ManifestVersion, *LexToString(*FileHash), *Request.WorksheetName,
+		Request.HeaderRow, Request.DataStartRow, static_cast<int32>(Entry.ImportType), *Entry.OutputDir.Path, *SettingsCDO->DataTableAssetPrefix,
+		*Request.WorksheetTypeInfo.MakeSchemaFingerprint());
+
+	const FTCHARToUTF8 Utf8HashInput(*HashInput);
+	FSHAHash Hash;
+	FSHA1::HashBuffer(Utf8HashInput.Get(), Utf8HashInput.Length(), Hash.Hash);
+	OutHash = Hash.ToString();
+	return true;
+}
+
+bool FPMXlsxImporterManifest::IsUpToDate(const FPMXlsxImporterSettingsEntry& Entry, const FString& Hash) const
+{
+	const FString* StoredHash = Hashes.Find(MakeEntryKey(Entry));
+	return StoredHash != nullptr && StoredHash->Equals(Hash, ESearchCase::CaseSensitive);
+}
+
+void FPMXlsxImporterManifest::Update(const FPMXlsxImporterSettingsEntry& Entry, const FString& Hash)
+{
+	Hashes.Add(MakeEntryKey(Entry), Hash);
+}
+
+FString FPMXlsxImporterManifest::GetManifestPath()
+{
+	return FPaths::ProjectIntermediateDir() / TEXT("PMXlsxImporter") / TEXT("ImportManifest.json");
+}
+
+FString FPMXlsxImporterManifest::MakeEntryKey(const FPMXlsxImporterSettingsEntry& Entry)
+{
+	return FString::Printf(TEXT("%s:%s:%s"), *Entry.XlsxFile.FilePath, *Entry.WorksheetName, *Entry.OutputDir.Path);
+}
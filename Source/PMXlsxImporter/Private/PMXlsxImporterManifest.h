@@ -0,0 +1,41 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/SecureHash.h"
+
+struct FPMXlsxImporterSettingsEntry;
+
+/**
+ * Remembers what each FPMXlsxImporterSettingsEntry was last imported from, so that import runs can skip entries whose inputs did not change.
+ * An entry's hash covers the bytes of its xlsx file, its worksheet and import settings, and the fields of its reflected struct.
+ * Stored in Intermediate/PMXlsxImporter/ImportManifest.json.
+ */
+class FPMXlsxImporterManifest
+{
+public:
+	// Reads the manifest file. A missing or outdated file gives an empty manifest.
+	void Load();
+
+	bool Save() const;
+
+	// Returns false if the entry is not set up well enough to be hashed. SyncAssets and ParseData report why.
+	// Each xlsx file is only hashed once per manifest, however many entries read it.
+	bool ComputeHash(const FPMXlsxImporterSettingsEntry& Entry, FString& OutHash);
+
+	// True if Entry was last imported successfully from inputs with this Hash
+	bool IsUpToDate(const FPMXlsxImporterSettingsEntry& Entry, const FString& Hash) const;
+
+	void Update(const FPMXlsxImporterSettingsEntry& Entry, const FString& Hash);
+
+private:
+	static FString GetManifestPath();
+	static FString MakeEntryKey(const FPMXlsxImporterSettingsEntry& Entry);
+
+	// Hash of each entry, keyed by MakeEntryKey
+	TMap<FString, FString> Hashes;
+
+	// Hash of the bytes of each xlsx file hashed so far, keyed by absolute path
+	TMap<FString, FMD5Hash> FileHashes;
+};
@@ -5,6 +5,67 @@
 
 #include "PMXlsxMetadata.h"
 
+namespace
+{
+	// Bump whenever the same cells start to be imported as different values, e.g. when the readers or the conversion of a field type
+	// change. Invalidates the row hashes saved in the assets and the manifest, so that every row is imported again.
+	const int32 ImporterVersion = 1;
+
+	// Appends what the value of Property is converted to that the field list doesn't describe: the names and values of enums,
+	// and the layout of structs imported from a single cell. Each enum or struct is only appended once.
+	void AppendValueLayout(const FProperty* Property, FString& OutFingerprint, TSet<const UField*>& InOutVisited)
+	{
+		const UEnum* Enum = nullptr;
+		if (const FEnumProperty* EnumProp = CastField<FEnumProperty>(Property))
+		{
+			Enum = EnumProp->GetEnum();
+		}
+		else if (const FByteProperty* ByteProp = CastField<FByteProperty>(Property))
+		{
+			Enum = ByteProp->Enum;
+		}
+
+		if (Enum != nullptr)
+		{
+			if (!InOutVisited.Contains(Enum))
+			{
+				InOutVisited.Add(Enum);
+				OutFingerprint += TEXT("|") + Enum->GetPathName();
+				for (int32 Index = 0; Index < Enum->NumEnums(); ++Index)
+				{
+					OutFingerprint += FString::Printf(TEXT(":%s=%lld"), *Enum->GetNameStringByIndex(Index), Enum->GetValueByIndex(Index));
+				}
+			}
+		}
+		else if (const FStructProperty* StructProp = CastField<FStructProperty>(Property))
+		{
+			if (!InOutVisited.Contains(StructProp->Struct))
+			{
+				InOutVisited.Add(StructProp->Struct);
+				OutFingerprint += TEXT("|") + StructProp->Struct->GetPathName();
+				for (TFieldIterator<FProperty> It(StructProp->Struct, EFieldIteratorFlags::IncludeSuper); It; ++It)
+				{
+					OutFingerprint += FString::Printf(TEXT(":%s:%s"), *It->GetName(), *It->GetCPPType());
+					AppendValueLayout(*It, OutFingerprint, InOutVisited);
+				}
+			}
+		}
+		else if (const FArrayProperty* ArrayProp = CastField<FArrayProperty>(Property))
+		{
+			AppendValueLayout(ArrayProp->Inner, OutFingerprint, InOutVisited);
+		}
+		else if (const FSetProperty* SetProp = CastField<FSetProperty>(Property))
+		{
+			AppendValueLayout(SetProp->ElementProp, OutFingerprint, InOutVisited);
+		}
+		else if (const FMapProperty* MapProp = CastField<FMapProperty>(Property))
+		{
+			AppendValueLayout(MapProp->KeyProp, OutFingerprint, InOutVisited);
+			AppendValueLayout(MapProp->ValueProp, OutFingerprint, InOutVisited);
+		}
+	}
+}
+
 
 void FPMXlsxWorksheetTypeInfo::ReadStruct(const UStruct* InStruct)
 {
@@ -133,3 +194,29 @@ void FPMXlsxWorksheetTypeInfo::InternalReadStruct(const UStruct* InStruct, TArra
 		}
 	}
 }
+
+FString FPMXlsxWorksheetTypeInfo::MakeSchemaFingerprint() const
+{
+	FString Fingerprint = FString::Printf(TEXT("%i|%s"), ImporterVersion, Struct ? *Struct->GetPathName() : TEXT(""));
+	for (const int32 TopField : TopFields)
+	{
+		Fingerprint += FString::Printf(TEXT("|%i"), TopField);
+	}
+	for (const FPMXlsxFieldTypeInfo& Field : AllFields)
+	{
+		Fingerprint += FString::Printf(TEXT("|%s:%i:%s:%i:%s:%s:%i:%i"), *Field.NameCPP, static_cast<int32>(Field.Type), *Field.CPPType,
+			static_cast<int32>(Field.Element_Type), *Field.Element_CPPType, *Field.GameplayTagFilter, Field.bSplitStruct ? 1 : 0, Field.ParentIndex);
+	}
+	if (Struct)
+	{
+		TSet<const UField*> Visited;
+		for (TFieldIterator<FProperty> It(Struct, EFieldIteratorFlags::IncludeSuper); It; ++It)
+		{
+			if (It->HasMetaData(FPMXlsxMetadata::IMPORT_FROM_XLSX_METADATA_TAG))
+			{
+				AppendValueLayout(*It, Fingerprint, Visited);
+			}
+		}
+	}
+	return Fingerprint;
+}
@@ -0,0 +1,83 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+
+#include "PMXlsxImporterReader.h"
+
+#include "PMXlsxImporterSettings.h"
+#include "PMXlsxNativeReader.h"
+
+namespace
+{
+	// Forwards every call to the Python implementation of UPMXlsxImporterPythonBridge
+	class FPMXlsxPythonBridgeReader : public IPMXlsxImporterReader
+	{
+	public:
+		virtual void BeginImportRun() override
+		{
+			Bridge->BeginImportRun();
+		}
+
+		virtual void EndImportRun() override
+		{
+			Bridge->EndImportRun();
+		}
+
+		virtual TArray<FString> ReadWorksheetNames(const FString& AbsoluteFilePath) override
+		{
+			return Bridge->ReadWorksheetNames(AbsoluteFilePath);
+		}
+
+		virtual FPMXlsxImporterPythonBridgeAssetNames ReadWorksheetAssetNames(const FString& AbsoluteFilePath, const FString& WorksheetName, int32 HeaderRow, int32 DataStartRow) override
+		{
+			return Bridge->ReadWorksheetAssetNames(AbsoluteFilePath, WorksheetName, HeaderRow, DataStartRow);
+		}
+
+		virtual FPMXlsxImporterPythonBridgeJsonString ReadWorksheetAsJson(const FString& AbsoluteFilePath, const FString& WorksheetName, int32 HeaderRow, int32 DataStartRow, const FPMXlsxWorksheetTypeInfo& WorksheetTypeInfo) override
+		{
+			return Bridge->ReadWorksheetAsJson(AbsoluteFilePath, WorksheetName, HeaderRow, DataStartRow, WorksheetTypeInfo);
+		}
+
+		// One round trip to Python for all worksheets instead of two per worksheet
+		virtual TArray<FPMXlsxImporterPythonBridgeWorksheetResult> ReadWorksheets(const FString& AbsoluteFilePath, const TArray<FPMXlsxImporterPythonBridgeWorksheetRequest>& Requests) override
+		{
+			return Bridge->ReadWorksheets(AbsoluteFilePath, Requests);
+		}
+
+		// Set by IPMXlsxImporterReader::Get() every time because the Python class is replaced when scripts are reloaded
+		UPMXlsxImporterPythonBridge* Bridge = nullptr;
+	};
+}
+
+IPMXlsxImporterReader* IPMXlsxImporterReader::Get(FPMXlsxImporterContextLogger* InOutErrors)
+{
+	const UPMXlsxImporterSettings* SettingsCDO = GetDefault<UPMXlsxImporterSettings>();
+	if (SettingsCDO->ReaderBackend == EPMXlsxReaderBackend::Native)
+	{
+		static FPMXlsxNativeReader NativeReader;
+		return &NativeReader;
+	}
+
+	UPMXlsxImporterPythonBridge* PythonBridge = UPMXlsxImporterPythonBridge::Get(InOutErrors);
+	if (PythonBridge == nullptr)
+	{
+		return nullptr; // UPMXlsxImporterPythonBridge::Get() logs an error when it returns null
+	}
+
+	static FPMXlsxPythonBridgeReader PythonReader;
+	PythonReader.Bridge = PythonBridge;
+	return &PythonReader;
+}
+
+TArray<FPMXlsxImporterPythonBridgeWorksheetResult> IPMXlsxImporterReader::ReadWorksheets(const FString& AbsoluteFilePath, const TArray<FPMXlsxImporterPythonBridgeWorksheetRequest>& Requests)
+{
+	TArray<FPMXlsxImporterPythonBridgeWorksheetResult> Results;
+	Results.Reserve(Requests.Num());
+	for (const FPMXlsxImporterPythonBridgeWorksheetRequest& Request : Requests)
+	{
+		FPMXlsxImporterPythonBridgeWorksheetResult& Result = Results.AddDefaulted_GetRef();
+		Result.WorksheetName = Request.WorksheetName;
+		Result.AssetNames = ReadWorksheetAssetNames(AbsoluteFilePath, Request.WorksheetName, Request.HeaderRow, Request.DataStartRow);
+		Result.JsonString = ReadWorksheetAsJson(AbsoluteFilePath, Request.WorksheetName, Request.HeaderRow, Request.DataStartRow, Request.WorksheetTypeInfo);
+	}
+	return Results;
+}
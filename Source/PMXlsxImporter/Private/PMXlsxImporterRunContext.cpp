@@ -0,0 +1,818 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+
+#include "PMXlsxImporterRunContext.h"
+
+#include "EditorAssetLibrary.h"
+#include "FileHelpers.h"
+#include "ISourceControlModule.h"
+#include "ISourceControlProvider.h"
+#include "SourceControlHelpers.h"
+#include "SourceControlOperations.h"
+#include "UObject/SavePackage.h"
+#include "PMXlsxDataAssetImporterJSON.h"
+#include "PMXlsxImporterContextLogger.h"
+#include "PMXlsxImporterLog.h"
+#include "PMXlsxImporterReader.h"
+#include "PMXlsxImporterSettings.h"
+#include "PMXlsxImporterSettingsEntry.h"
+#include "PMXlsxWorksheetData.h"
+#include "Async/Async.h"
+#include "Engine/AssetManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+FPMXlsxImporterRunContext* FPMXlsxImporterRunContext::Current = nullptr;
+
+FPMXlsxImporterRunContext::FPMXlsxImporterRunContext(FPMXlsxImporterRunStats* OutStats)
+	: Stats(OutStats ? OutStats : &OwnStats)
+{
+	if (Current != nullptr)
+	{
+		return;
+	}
+
+	Current = this;
+
+	Reader = IPMXlsxImporterReader::Get();
+	if (Reader)
+	{
+		Reader->BeginImportRun();
+	}
+}
+
+FPMXlsxImporterRunContext::~FPMXlsxImporterRunContext()
+{
+	if (Current != this)
+	{
+		return;
+	}
+
+	// Workers may still be reading files or decoding worksheets of entries that were not imported, e.g. after MaxErrors
+	for (const FPrefetchedFile& File : PrefetchedFiles)
+	{
+		if (File.PendingResults.IsValid())
+		{
+			File.PendingResults.Wait();
+		}
+	}
+	for (const TPair<FString, FPrefetchedWorksheet>& PrefetchedWorksheet : PrefetchedWorksheets)
+	{
+		if (PrefetchedWorksheet.Value.PendingDecode.IsValid())
+		{
+			PrefetchedWorksheet.Value.PendingDecode.Wait();
+		}
+	}
+
+	if (Reader)
+	{
+		Reader->EndImportRun();
+	}
+
+	for (const TFuture<void>& PendingJsonDebugDump : PendingJsonDebugDumps)
+	{
+		PendingJsonDebugDump.Wait();
+	}
+
+	Stats->Finish();
+	Current = nullptr;
+}
+
+FPMXlsxImporterRunContext* FPMXlsxImporterRunContext::Get()
+{
+	return Current;
+}
+
+void FPMXlsxImporterRunContext::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (TPair<const FPMXlsxImporterSettingsEntry*, TArray<UObject*>>& EntryAssets : ModifiedAssets)
+	{
+		Collector.AddReferencedObjects(EntryAssets.Value);
+	}
+	Collector.AddReferencedObjects(CreatedAssets);
+}
+
+FString FPMXlsxImporterRunContext::GetReferencerName() const
+{
+	return TEXT("FPMXlsxImporterRunContext");
+}
+
+void FPMXlsxImporterRunContext::SetCurrentEntry(const FPMXlsxImporterSettingsEntry* Entry)
+{
+	CurrentEntry = Entry;
+	if (Entry == nullptr)
+	{
+		Stats->SetCurrentEntry(INDEX_NONE);
+		return;
+	}
+
+	const int32* EntryIndex = StatsEntryIndices.Find(Entry);
+	if (EntryIndex == nullptr)
+	{
+		EntryIndex = &StatsEntryIndices.Add(Entry, Stats->AddEntry(FString::Printf(TEXT("%s:%s"), *Entry->XlsxFile.FilePath, *Entry->WorksheetName)));
+	}
+	Stats->SetCurrentEntry(*EntryIndex);
+}
+
+void FPMXlsxImporterRunContext::PrefetchWorksheets(const TArray<const FPMXlsxImporterSettingsEntry*>& Entries)
+{
+	if (Reader == nullptr)
+	{
+		return;
+	}
+
+	PipelineDepth = FMath::Max(GetDefault<UPMXlsxImporterSettings>()->PipelineDepth, 0);
+	bReadOnWorkerThreads = PipelineDepth > 0 && Reader->CanReadOnAnyThread();
+
+	TMap<FString, int32> FileIndices;
+	for (const FPMXlsxImporterSettingsEntry* Entry : Entries)
+	{
+		FString XlsxAbsolutePath;
+		FPMXlsxImporterPythonBridgeWorksheetRequest Request;
+		if (!Entry->MakeWorksheetRequest(XlsxAbsolutePath, Request))
+		{
+			continue;
+		}
+
+		// Entries reading the same worksheet share a request. If they use different structs, the later ones read their data themselves.
+		const FString WorksheetKey = MakeWorksheetKey(XlsxAbsolutePath, Request.WorksheetName);
+		if (PrefetchedWorksheets.Contains(WorksheetKey))
+		{
+			continue;
+		}
+
+		int32* FileIndex = FileIndices.Find(XlsxAbsolutePath);
+		if (FileIndex == nullptr)
+		{
+			FileIndex = &FileIndices.Add(XlsxAbsolutePath, PrefetchedFiles.Num());
+			PrefetchedFiles.AddDefaulted_GetRef().AbsoluteFilePath = XlsxAbsolutePath;
+		}
+
+		FPrefetchedWorksheet& PrefetchedWorksheet = PrefetchedWorksheets.Add(WorksheetKey);
+		PrefetchedWorksheet.Struct = Request.WorksheetTypeInfo.Struct;
+		PrefetchedWorksheet.WorksheetName = Request.WorksheetName;
+		PrefetchedWorksheet.FileIndex = *FileIndex;
+		PrefetchedWorksheet.Order = PrefetchedWorksheetOrder.Add(WorksheetKey);
+		PrefetchedFiles[*FileIndex].Requests.Add(MoveTemp(Request));
+	}
+
+	if (bReadOnWorkerThreads)
+	{
+		if (PrefetchedFiles.Num() > 0)
+		{
+			WaitForPrefetchedFile(0);
+		}
+		return;
+	}
+
+	for (FPrefetchedFile& File : PrefetchedFiles)
+	{
+		PMXLSX_IMPORT_STAGE_SCOPE(Read);
+		StorePrefetchedResults(File, Reader->ReadWorksheets(File.AbsoluteFilePath, File.Requests));
+		File.bRead = true;
+	}
+}
+
+const FPMXlsxImporterPythonBridgeAssetNames* FPMXlsxImporterRunContext::FindPrefetchedAssetNames(const FString& AbsoluteFilePath, const FString& WorksheetName)
+{
+	const FPrefetchedWorksheet* PrefetchedWorksheet = PrefetchedWorksheets.Find(MakeWorksheetKey(AbsoluteFilePath, WorksheetName));
+	if (PrefetchedWorksheet == nullptr)
+	{
+		return nullptr;
+	}
+
+	WaitForPrefetchedFile(PrefetchedWorksheet->FileIndex);
+	return &PrefetchedWorksheet->AssetNames;
+}
+
+bool FPMXlsxImporterRunContext::TakeDecodedWorksheet(const FString& AbsoluteFilePath, const FString& WorksheetName, const UStruct* Struct, TSharedPtr<const FPMXlsxWorksheetData>& OutData, FString& OutError)
+{
+	FPrefetchedWorksheet* PrefetchedWorksheet = PrefetchedWorksheets.Find(MakeWorksheetKey(AbsoluteFilePath, WorksheetName));
+	if (PrefetchedWorksheet == nullptr || Struct != PrefetchedWorksheet->Struct)
+	{
+		return false;
+	}
+
+	// Decode the next worksheets while this one is imported
+	const int32 LastOrder = FMath::Min(PrefetchedWorksheet->Order + PipelineDepth, PrefetchedWorksheetOrder.Num() - 1);
+	for (int32 Order = PrefetchedWorksheet->Order + 1; Order <= LastOrder; ++Order)
+	{
+		FPrefetchedWorksheet& NextWorksheet = PrefetchedWorksheets[PrefetchedWorksheetOrder[Order]];
+		if (!NextWorksheet.bDecodeStarted)
+		{
+			WaitForPrefetchedFile(NextWorksheet.FileIndex);
+			StartDecoding(NextWorksheet);
+		}
+	}
+
+	FDecodedWorksheet DecodedWorksheet;
+	if (PrefetchedWorksheet->PendingDecode.IsValid())
+	{
+		{
+			PMXLSX_IMPORT_STAGE_SCOPE(Wait);
+			DecodedWorksheet = PrefetchedWorksheet->PendingDecode.Get();
+		}
+		PrefetchedWorksheet->PendingDecode = TFuture<FDecodedWorksheet>();
+	}
+	else if (!PrefetchedWorksheet->bDecodeStarted)
+	{
+		// Nothing decoded this one ahead, e.g. it's the first worksheet of the run or PipelineDepth is 0
+		TRACE_CPUPROFILER_EVENT_SCOPE(PMXlsxImporter_Decode);
+		WaitForPrefetchedFile(PrefetchedWorksheet->FileIndex);
+		PrefetchedWorksheet->bDecodeStarted = true;
+		const FPMXlsxImporterPythonBridgeJsonString Data = MoveTemp(PrefetchedWorksheet->Data);
+		DecodedWorksheet = DecodePrefetchedWorksheet(Data, MakeJsonDebugDumpFile(AbsoluteFilePath, WorksheetName), GetDefault<UPMXlsxImporterSettings>()->JsonDebugDump);
+	}
+	else
+	{
+		// Another entry of the same worksheet took the data already
+		return false;
+	}
+
+	Stats->AddTime(EPMXlsxImportStage::Decode, DecodedWorksheet.DecodeSeconds);
+	Stats->AddBytes(DecodedWorksheet.NumBytes);
+	OutData = MoveTemp(DecodedWorksheet.Data);
+	OutError = MoveTemp(DecodedWorksheet.Error);
+	return true;
+}
+
+bool FPMXlsxImporterRunContext::DecodeWorksheet(const FPMXlsxImporterPythonBridgeJsonString& Data, TSharedPtr<FPMXlsxWorksheetData>& OutData, FString& OutError)
+{
+	if (!Data.Error.IsEmpty())
+	{
+		OutError = Data.Error;
+		return false;
+	}
+	if (Data.JsonString.IsEmpty() && Data.BinaryData.IsEmpty())
+	{
+		OutError = TEXT("Could not parse data: worksheet data is empty.");
+		return false;
+	}
+
+	const TSharedRef<FPMXlsxWorksheetData> WorksheetData = MakeShared<FPMXlsxWorksheetData>();
+	FString ReadError;
+	if (!WorksheetData->Read(Data, ReadError) || WorksheetData->Num() == 0)
+	{
+		OutError = FString::Printf(TEXT("Failed to parse the worksheet data. Error: %s"), *ReadError);
+		return false;
+	}
+
+	OutData = WorksheetData;
+	return true;
+}
+
+void FPMXlsxImporterRunContext::WaitForPrefetchedFile(int32 FileIndex)
+{
+	if (!bReadOnWorkerThreads)
+	{
+		return;
+	}
+
+	// Reads at most PipelineDepth files past FileIndex, which bounds how many reads run at once and how far reading gets ahead of
+	// the entries. It doesn't bound the results held in memory: SyncAssets waits for every file before the first entry's ParseData, so
+	// the data of all worksheets is held until each one is decoded, and only their asset names are kept after that.
+	const int32 LastFileIndex = FMath::Min(FileIndex + PipelineDepth, PrefetchedFiles.Num() - 1);
+	for (int32 Index = FileIndex; Index <= LastFileIndex; ++Index)
+	{
+		FPrefetchedFile& File = PrefetchedFiles[Index];
+		if (File.bRead || File.PendingResults.IsValid())
+		{
+			continue;
+		}
+
+		IPMXlsxImporterReader* FileReader = Reader;
+		File.PendingResults = Async(EAsyncExecution::ThreadPool, [FileReader, AbsoluteFilePath = File.AbsoluteFilePath, Requests = File.Requests]()
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(PMXlsxImporter_Read);
+			const FPMXlsxImporterStageTimer StageTimer(EPMXlsxImportStage::Read, /*bForRun:*/ true);
+			return MakeShared<TArray<FPMXlsxImporterPythonBridgeWorksheetResult>>(FileReader->ReadWorksheets(AbsoluteFilePath, Requests));
+		});
+	}
+
+	FPrefetchedFile& File = PrefetchedFiles[FileIndex];
+	if (!File.bRead)
+	{
+		{
+			PMXLSX_IMPORT_STAGE_SCOPE(Wait);
+			File.PendingResults.Wait();
+		}
+		StorePrefetchedResults(File, MoveTemp(*File.PendingResults.Get()));
+		File.PendingResults = TFuture<TSharedPtr<TArray<FPMXlsxImporterPythonBridgeWorksheetResult>>>();
+		File.bRead = true;
+	}
+}
+
+void FPMXlsxImporterRunContext::StorePrefetchedResults(const FPrefetchedFile& File, TArray<FPMXlsxImporterPythonBridgeWorksheetResult>&& Results)
+{
+	for (int32 Index = 0; Index < File.Requests.Num() && Index < Results.Num(); ++Index)
+	{
+		FPrefetchedWorksheet& PrefetchedWorksheet = PrefetchedWorksheets[MakeWorksheetKey(File.AbsoluteFilePath, File.Requests[Index].WorksheetName)];
+		PrefetchedWorksheet.AssetNames = MoveTemp(Results[Index].AssetNames);
+		PrefetchedWorksheet.Data = MoveTemp(Results[Index].JsonString);
+	}
+}
+
+void FPMXlsxImporterRunContext::StartDecoding(FPrefetchedWorksheet& Worksheet)
+{
+	Worksheet.bDecodeStarted = true;
+	const FString JsonDebugDumpFile = MakeJsonDebugDumpFile(PrefetchedFiles[Worksheet.FileIndex].AbsoluteFilePath, Worksheet.WorksheetName);
+	const EPMXlsxJsonDumpMode DumpMode = GetDefault<UPMXlsxImporterSettings>()->JsonDebugDump;
+	Worksheet.PendingDecode = Async(EAsyncExecution::ThreadPool, [Data = MoveTemp(Worksheet.Data), JsonDebugDumpFile, DumpMode]() mutable
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(PMXlsxImporter_Decode);
+		// Moved out of the task, so that it's freed once decoded rather than when the task is
+		const FPMXlsxImporterPythonBridgeJsonString TaskData = MoveTemp(Data);
+		return DecodePrefetchedWorksheet(TaskData, JsonDebugDumpFile, DumpMode);
+	});
+}
+
+FPMXlsxImporterRunContext::FDecodedWorksheet FPMXlsxImporterRunContext::DecodePrefetchedWorksheet(const FPMXlsxImporterPythonBridgeJsonString& Data, const FString& JsonDebugDumpFile,
+	EPMXlsxJsonDumpMode DumpMode)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	FDecodedWorksheet DecodedWorksheet;
+	DecodedWorksheet.NumBytes = Data.JsonString.Len() + Data.BinaryData.Len();
+	TSharedPtr<FPMXlsxWorksheetData> WorksheetData;
+	if (DecodeWorksheet(Data, WorksheetData, DecodedWorksheet.Error))
+	{
+		DecodedWorksheet.Data = WorksheetData;
+	}
+	DecodedWorksheet.DecodeSeconds = FPlatformTime::Seconds() - StartTime;
+
+	if (WorksheetData.IsValid() && DumpMode != EPMXlsxJsonDumpMode::Off)
+	{
+		SaveJsonDebugDump(*WorksheetData, JsonDebugDumpFile, DumpMode);
+	}
+	return DecodedWorksheet;
+}
+
+void FPMXlsxImporterRunContext::AddStructBindings(const UStruct* Struct)
+{
+	check(IsInGameThread());
+	if (Struct == nullptr || StructBindings.Contains(Struct))
+	{
+		return;
+	}
+
+	const FPMXlsxStructBindings& Bindings = *StructBindings.Add(Struct, MakeUnique<FPMXlsxStructBindings>(Struct));
+	for (const FPMXlsxPropertyBinding& Binding : Bindings.Properties)
+	{
+		// The structs that FPMXlsxDataAssetImporterJSON::ReadStruct is called for, directly or as the elements of a container
+		const FProperty* Property = Binding.Property;
+		if (const FArrayProperty* ArrayProp = CastField<FArrayProperty>(Property))
+		{
+			Property = ArrayProp->Inner;
+		}
+		else if (const FSetProperty* SetProp = CastField<FSetProperty>(Property))
+		{
+			Property = SetProp->ElementProp;
+		}
+		else if (const FMapProperty* MapProp = CastField<FMapProperty>(Property))
+		{
+			if (const FStructProperty* KeyStructProp = CastField<FStructProperty>(MapProp->KeyProp))
+			{
+				AddStructBindings(KeyStructProp->Struct);
+			}
+			Property = MapProp->ValueProp;
+		}
+
+		if (const FStructProperty* StructProp = CastField<FStructProperty>(Property))
+		{
+			AddStructBindings(StructProp->Struct);
+		}
+	}
+}
+
+const FPMXlsxStructBindings* FPMXlsxImporterRunContext::FindStructBindings(const UStruct* Struct) const
+{
+	const TUniquePtr<const FPMXlsxStructBindings>* Bindings = StructBindings.Find(Struct);
+	return Bindings ? Bindings->Get() : nullptr;
+}
+
+TSharedRef<const FPMXlsxColumnBindings> FPMXlsxImporterRunContext::AddColumnBindings(const UStruct* Struct, const FPMXlsxWorksheetData& WorksheetData, const FString& RowKey)
+{
+	check(IsInGameThread());
+	FString Layout = RowKey;
+	for (int32 ColumnIndex = 0; ColumnIndex < WorksheetData.NumColumns(); ++ColumnIndex)
+	{
+		Layout += TEXT('\n');
+		Layout += WorksheetData.GetColumnName(ColumnIndex);
+	}
+
+	const TPair<const UStruct*, FString> Key(Struct, MoveTemp(Layout));
+	if (const TSharedRef<const FPMXlsxColumnBindings>* Bindings = ColumnBindings.Find(Key))
+	{
+		return *Bindings;
+	}
+
+	const FPMXlsxStructBindings* Bindings = FindStructBindings(Struct);
+	check(Bindings);
+	return ColumnBindings.Add(Key, MakeShared<FPMXlsxColumnBindings>(*Bindings, WorksheetData, RowKey));
+}
+
+void FPMXlsxImporterRunContext::WriteJsonDebugDump(const FString& AbsoluteFilePath, const FString& WorksheetName, const FPMXlsxImporterPythonBridgeJsonString& Data)
+{
+	const EPMXlsxJsonDumpMode DumpMode = GetDefault<UPMXlsxImporterSettings>()->JsonDebugDump;
+	if (DumpMode == EPMXlsxJsonDumpMode::Off)
+	{
+		return;
+	}
+
+	const FString OutputFile = MakeJsonDebugDumpFile(AbsoluteFilePath, WorksheetName);
+	PendingJsonDebugDumps.Add(Async(EAsyncExecution::ThreadPool, [OutputFile, Data, DumpMode]()
+	{
+		FPMXlsxWorksheetData WorksheetData;
+		FString Error;
+		if (!WorksheetData.Read(Data, Error))
+		{
+			UE_LOG(LogPMXlsxImporter, Warning, TEXT("Could not write %s: %s"), *OutputFile, *Error);
+			return;
+		}
+		SaveJsonDebugDump(WorksheetData, OutputFile, DumpMode);
+	}));
+}
+
+FString FPMXlsxImporterRunContext::MakeJsonDebugDumpFile(const FString& AbsoluteFilePath, const FString& WorksheetName)
+{
+	return FPaths::ConvertRelativePathToFull(FPaths::ProjectIntermediateDir()) / TEXT("XlsxJsonFiles") / FPaths::GetBaseFilename(AbsoluteFilePath) / WorksheetName + TEXT(".json");
+}
+
+void FPMXlsxImporterRunContext::SaveJsonDebugDump(const FPMXlsxWorksheetData& WorksheetData, const FString& JsonDebugDumpFile, EPMXlsxJsonDumpMode DumpMode)
+{
+	if (!FFileHelper::SaveStringToFile(WorksheetData.MakeJsonString(DumpMode == EPMXlsxJsonDumpMode::Pretty), *JsonDebugDumpFile, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		UE_LOG(LogPMXlsxImporter, Warning, TEXT("Could not write %s"), *JsonDebugDumpFile);
+	}
+}
+
+bool FPMXlsxImporterRunContext::SaveModifiedAsset(UObject* Asset, FPMXlsxImporterContextLogger& InOutErrors)
+{
+	if (Current == nullptr)
+	{
+		return SaveAssets({ Asset }, InOutErrors);
+	}
+
+	Current->ModifiedAssets.FindOrAdd(Current->CurrentEntry).Add(Asset);
+	return true;
+}
+
+bool FPMXlsxImporterRunContext::SaveAssets(const TArray<UObject*>& Assets, FPMXlsxImporterContextLogger& InOutErrors)
+{
+	if (Assets.Num() == 0)
+	{
+		return true;
+	}
+
+	bool bSuccess = true;
+	const UPMXlsxImporterSettings* SettingsCDO = GetDefault<UPMXlsxImporterSettings>();
+
+	TArray<UObject*> AssetsToSave = Assets;
+	if (SettingsCDO->bCheckoutGeneratedAssets)
+	{
+		AssetsToSave = CheckOutAssets(Assets, InOutErrors);
+		bSuccess = AssetsToSave.Num() == Assets.Num();
+	}
+
+	// No reason to mark the packages as dirty. We know we need to save right now.
+	// SaveLoadedAssets will print its own errors for each package it could not save.
+	PMXLSX_IMPORT_STAGE_SCOPE(Save);
+	if (!UEditorAssetLibrary::SaveLoadedAssets(AssetsToSave, /*bOnlyIfIsDirty:*/ false))
+	{
+		InOutErrors.Logf(TEXT("Unable to save some of %i modified assets"), AssetsToSave.Num());
+		bSuccess = false;
+	}
+	else if (Current)
+	{
+		Current->Stats->AddSavedAssets(AssetsToSave.Num());
+	}
+
+	UE_LOG(LogPMXlsxImporter, Log, TEXT("Saved %i modified assets"), AssetsToSave.Num());
+	return bSuccess;
+}
+
+void FPMXlsxImporterRunContext::SaveCreatedAsset(UObject* Asset, FPMXlsxImporterContextLogger& InOutErrors)
+{
+	if (Current == nullptr)
+	{
+		SavePackages({ Asset }, InOutErrors);
+		return;
+	}
+	Current->CreatedAssets.Add(Asset);
+	Current->EntriesWithQueuedChanges.Add(Current->CurrentEntry);
+}
+
+void FPMXlsxImporterRunContext::ScanPrimaryAssetPath(const FString& Path)
+{
+	if (Current == nullptr)
+	{
+		UAssetManager::Get().ScanPathsSynchronous({ Path });
+		return;
+	}
+	Current->PrimaryAssetPathsToScan.AddUnique(Path);
+}
+
+void FPMXlsxImporterRunContext::SaveCreatedAssets(FPMXlsxImporterContextLogger& InOutErrors)
+{
+	const TArray<UObject*> Assets = MoveTemp(CreatedAssets);
+	SavePackages(Assets, InOutErrors);
+}
+
+void FPMXlsxImporterRunContext::ScanPrimaryAssetPaths()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(PMXlsxImporter_ScanPrimaryAssetPaths);
+	if (PrimaryAssetPathsToScan.Num() > 0)
+	{
+		UAssetManager::Get().ScanPathsSynchronous(PrimaryAssetPathsToScan);
+		PrimaryAssetPathsToScan.Reset();
+	}
+}
+
+void FPMXlsxImporterRunContext::SavePackages(const TArray<UObject*>& Assets, FPMXlsxImporterContextLogger& InOutErrors)
+{
+	if (Assets.Num() == 0)
+	{
+		return;
+	}
+
+	PMXLSX_IMPORT_STAGE_SCOPE(Save);
+	int32 NumSavedAssets = 0;
+	for (UObject* Asset : Assets)
+	{
+		UPackage* Package = Asset->GetOutermost();
+		const FString PackageFileName = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
+
+		// Serialize each package here, but let the file writes of all of them run in the background
+#if ENGINE_MAJOR_VERSION == 4
+		if (!UPackage::SavePackage(Package, Asset, EObjectFlags::RF_NoFlags, *PackageFileName, GError, nullptr, false, true, SAVE_Async))
+#elif ENGINE_MAJOR_VERSION == 5
+		FSavePackageArgs SaveArgs;
+		SaveArgs.SaveFlags = SAVE_Async;
+		if (!UPackage::SavePackage(Package, Asset, *PackageFileName, SaveArgs))
+#else
+# error Unknown engine version
+#endif
+		{
+			InOutErrors.Logf(TEXT("Unable to save file %s"), *PackageFileName);
+			continue;
+		}
+		UE_LOG(LogPMXlsxImporter, Log, TEXT("Created new asset %s"), *Package->GetName());
+		++NumSavedAssets;
+	}
+
+	UPackage::WaitForAsyncFileWrites();
+	if (Current)
+	{
+		Current->Stats->AddSavedAssets(NumSavedAssets);
+	}
+}
+
+void FPMXlsxImporterRunContext::MarkFileForAdd(const FString& AbsoluteFilePath, FPMXlsxImporterContextLogger& InOutErrors)
+{
+	if (Current == nullptr)
+	{
+		MarkFilesForAdd({ AbsoluteFilePath }, InOutErrors);
+		return;
+	}
+	Current->FilesToMarkForAdd.AddUnique(AbsoluteFilePath);
+	Current->EntriesWithQueuedChanges.Add(Current->CurrentEntry);
+}
+
+void FPMXlsxImporterRunContext::DeleteAsset(const FString& AssetPath, FPMXlsxImporterContextLogger& InOutErrors)
+{
+	if (Current == nullptr)
+	{
+		DeleteAssets({ AssetPath }, InOutErrors);
+		return;
+	}
+	Current->AssetsToDelete.AddUnique(AssetPath);
+	Current->EntriesWithQueuedChanges.Add(Current->CurrentEntry);
+}
+
+void FPMXlsxImporterRunContext::SubmitSourceControlChanges(FPMXlsxImporterContextLogger& InOutErrors)
+{
+	MarkFilesForAdd(FilesToMarkForAdd, InOutErrors);
+	FilesToMarkForAdd.Reset();
+
+	DeleteAssets(AssetsToDelete, InOutErrors);
+	AssetsToDelete.Reset();
+}
+
+TSet<const FPMXlsxImporterSettingsEntry*> FPMXlsxImporterRunContext::TakeEntriesWithQueuedChanges()
+{
+	return MoveTemp(EntriesWithQueuedChanges);
+}
+
+TArray<UObject*> FPMXlsxImporterRunContext::CheckOutAssets(const TArray<UObject*>& Assets, FPMXlsxImporterContextLogger& InOutErrors)
+{
+	PMXLSX_IMPORT_STAGE_SCOPE(SourceControl);
+	ISourceControlProvider& Provider = ISourceControlModule::Get().GetProvider();
+	if (!ISourceControlModule::Get().IsEnabled() || !Provider.IsAvailable())
+	{
+		InOutErrors.Logf(TEXT("Unable to checkout %i assets: source control is not available"), Assets.Num());
+		return TArray<UObject*>();
+	}
+
+	TArray<FString> Files;
+	Files.Reserve(Assets.Num());
+	for (const UObject* Asset : Assets)
+	{
+		Files.Add(SourceControlHelpers::PackageFilename(Asset->GetOutermost()));
+	}
+
+	// One query and one checkout for all files, rather than a round trip per asset
+	TArray<FSourceControlStateRef> States;
+	if (Provider.GetState(Files, States, EStateCacheUsage::ForceUpdate) != ECommandResult::Succeeded || States.Num() != Files.Num())
+	{
+		InOutErrors.Logf(TEXT("Unable to checkout %i assets: could not get their source control state"), Assets.Num());
+		return TArray<UObject*>();
+	}
+
+	TArray<UObject*> CheckedOutAssets;
+	TArray<UObject*> AssetsToCheckOut;
+	TArray<FString> FilesToCheckOut;
+	for (int32 Index = 0; Index < Assets.Num(); ++Index)
+	{
+		const FSourceControlStateRef& State = States[Index];
+		if (State->IsCheckedOut() || State->IsAdded() || !State->IsSourceControlled())
+		{
+			CheckedOutAssets.Add(Assets[Index]);
+		}
+		else if (State->CanCheckout())
+		{
+			AssetsToCheckOut.Add(Assets[Index]);
+			FilesToCheckOut.Add(Files[Index]);
+		}
+		else
+		{
+			InOutErrors.Logf(TEXT("Unable to checkout asset %s"), *Assets[Index]->GetName());
+		}
+	}
+
+	if (FilesToCheckOut.Num() > 0)
+	{
+		if (Provider.Execute(ISourceControlOperation::Create<FCheckOut>(), FilesToCheckOut) == ECommandResult::Succeeded)
+		{
+			CheckedOutAssets.Append(AssetsToCheckOut);
+		}
+		else
+		{
+			for (const UObject* Asset : AssetsToCheckOut)
+			{
+				InOutErrors.Logf(TEXT("Unable to checkout asset %s"), *Asset->GetName());
+			}
+		}
+	}
+
+	UE_LOG(LogPMXlsxImporter, Log, TEXT("Checked out %i assets"), FilesToCheckOut.Num());
+	return CheckedOutAssets;
+}
+
+void FPMXlsxImporterRunContext::MarkFilesForAdd(const TArray<FString>& AbsoluteFilePaths, FPMXlsxImporterContextLogger& InOutErrors)
+{
+	if (AbsoluteFilePaths.Num() == 0)
+	{
+		return;
+	}
+
+	PMXLSX_IMPORT_STAGE_SCOPE(SourceControl);
+	ISourceControlProvider& Provider = ISourceControlModule::Get().GetProvider();
+	if (!ISourceControlModule::Get().IsEnabled() || !Provider.IsAvailable() ||
+		Provider.Execute(ISourceControlOperation::Create<FMarkForAdd>(), AbsoluteFilePaths) != ECommandResult::Succeeded)
+	{
+		InOutErrors.Logf(TEXT("Unable to mark %i new files for add"), AbsoluteFilePaths.Num());
+		return;
+	}
+
+	UE_LOG(LogPMXlsxImporter, Log, TEXT("Marked %i new files for add"), AbsoluteFilePaths.Num());
+}
+
+void FPMXlsxImporterRunContext::DeleteAssets(const TArray<FString>& AssetPaths, FPMXlsxImporterContextLogger& InOutErrors)
+{
+	if (AssetPaths.Num() == 0)
+	{
+		return;
+	}
+
+	PMXLSX_IMPORT_STAGE_SCOPE(SourceControl);
+	ISourceControlProvider& Provider = ISourceControlModule::Get().GetProvider();
+	if (!ISourceControlModule::Get().IsEnabled() || !Provider.IsAvailable())
+	{
+		InOutErrors.Logf(TEXT("Unable to delete %i assets: source control is not available"), AssetPaths.Num());
+		return;
+	}
+
+	// Convert each asset path (e.g. "/Game/Generated/TestData/test/Sheet1/TestDataFromXLS1.TestDataFromXLS1") to an absolute file path
+	TArray<FString> Files;
+	Files.Reserve(AssetPaths.Num());
+	for (const FString& AssetPath : AssetPaths)
+	{
+		const FString PackageName = FEditorFileUtils::ExtractPackageName(AssetPath);
+		const FString RelativePath = FPackageName::LongPackageNameToFilename(PackageName, FPackageName::GetAssetPackageExtension());
+		Files.Add(IFileManager::Get().ConvertToAbsolutePathForExternalAppForWrite(*RelativePath));
+	}
+
+	TArray<FSourceControlStateRef> States;
+	if (Provider.GetState(Files, States, EStateCacheUsage::ForceUpdate) != ECommandResult::Succeeded || States.Num() != Files.Num())
+	{
+		InOutErrors.Logf(TEXT("Unable to delete %i assets: could not get their source control state"), AssetPaths.Num());
+		return;
+	}
+
+	TArray<UObject*> AssetsToDelete;
+	for (int32 Index = 0; Index < AssetPaths.Num(); ++Index)
+	{
+		if (!States[Index]->IsValid())
+		{
+			InOutErrors.Logf(TEXT("Source control state is invalid for %s. Refusing to delete this file."), *Files[Index]);
+			continue;
+		}
+
+		UObject* Asset = UEditorAssetLibrary::LoadAsset(AssetPaths[Index]);
+		if (Asset == nullptr)
+		{
+			InOutErrors.Logf(TEXT("Unable to delete asset %s"), *AssetPaths[Index]);
+			continue;
+		}
+		AssetsToDelete.Add(Asset);
+	}
+
+	if (AssetsToDelete.Num() == 0)
+	{
+		return;
+	}
+
+	// Deletes the packages together, which marks all of their files for delete in source control in one go
+	if (!UEditorAssetLibrary::DeleteLoadedAssets(AssetsToDelete))
+	{
+		InOutErrors.Logf(TEXT("Unable to delete some of %i assets"), AssetsToDelete.Num());
+	}
+}
+
+FString FPMXlsxImporterRunContext::MakeWorksheetKey(const FString& AbsoluteFilePath, const FString& WorksheetName)
+{
+	return FString::Printf(TEXT("%s:%s"), *AbsoluteFilePath, *WorksheetName);
+}
+
+FPMXlsxImporterStageTimer::FPMXlsxImporterStageTimer(EPMXlsxImportStage InStage, bool bInForRun)
+	: Stage(InStage)
+	, bForRun(bInForRun)
+	, StartCycles(FPlatformTime::Cycles64())
+{
+}
+
+FPMXlsxImporterStageTimer::~FPMXlsxImporterStageTimer()
+{
+	const uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+	if (!bForRun)
+	{
+		if (FPMXlsxImporterStageTimes* Times = FPMXlsxImporterStageTimeCollector::GetTimes())
+		{
+			Times->Cycles[static_cast<int32>(Stage)] += Cycles;
+			return;
+		}
+	}
+
+	if (FPMXlsxImporterRunContext* RunContext = FPMXlsxImporterRunContext::Get())
+	{
+		RunContext->GetStats().AddTime(Stage, Cycles * FPlatformTime::GetSecondsPerCycle64(), bForRun);
+	}
+}
+
+namespace
+{
+	thread_local FPMXlsxImporterStageTimeCollector* CurrentStageTimeCollector = nullptr;
+}
+
+FPMXlsxImporterStageTimeCollector::FPMXlsxImporterStageTimeCollector()
+	: Times(OwnTimes)
+	, bAddToRun(true)
+	, Outer(CurrentStageTimeCollector)
+{
+	CurrentStageTimeCollector = this;
+}
+
+FPMXlsxImporterStageTimeCollector::FPMXlsxImporterStageTimeCollector(FPMXlsxImporterStageTimes& OutTimes)
+	: Times(OutTimes)
+	, bAddToRun(false)
+	, Outer(CurrentStageTimeCollector)
+{
+	CurrentStageTimeCollector = this;
+}
+
+FPMXlsxImporterStageTimeCollector::~FPMXlsxImporterStageTimeCollector()
+{
+	check(CurrentStageTimeCollector == this);
+	CurrentStageTimeCollector = Outer;
+
+	FPMXlsxImporterRunContext* RunContext = FPMXlsxImporterRunContext::Get();
+	if (bAddToRun && RunContext)
+	{
+		RunContext->GetStats().AddTimes(Times);
+	}
+}
+
+FPMXlsxImporterStageTimes* FPMXlsxImporterStageTimeCollector::GetTimes()
+{
+	return CurrentStageTimeCollector ? &CurrentStageTimeCollector->Times : nullptr;
+}
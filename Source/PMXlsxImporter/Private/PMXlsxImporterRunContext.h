@@ -0,0 +1,259 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "PMXlsxImporterPythonBridge.h"
+#include "PMXlsxImporterRunStats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "UObject/GCObject.h"
+
+enum class EPMXlsxJsonDumpMode : uint8;
+class FPMXlsxImporterContextLogger;
+class FPMXlsxWorksheetData;
+struct FPMXlsxColumnBindings;
+struct FPMXlsxStructBindings;
+class IPMXlsxImporterReader;
+struct FPMXlsxImporterSettingsEntry;
+
+/**
+ * State shared by all steps of one import run (UPMXlsxImporterSettings::ImportAll, ImportCheckedOut or ImportEntry).
+ * Create one on the stack for the duration of the run. Runs don't nest: a context created while another one is active does nothing.
+ */
+class FPMXlsxImporterRunContext : public FGCObject
+{
+public:
+	// The run's times and counters are written to OutStats if it's not null
+	explicit FPMXlsxImporterRunContext(FPMXlsxImporterRunStats* OutStats = nullptr);
+	~FPMXlsxImporterRunContext();
+
+	FPMXlsxImporterRunContext(const FPMXlsxImporterRunContext&) = delete;
+	FPMXlsxImporterRunContext& operator=(const FPMXlsxImporterRunContext&) = delete;
+
+	// Returns the context of the current import run, or nullptr if no import is running
+	static FPMXlsxImporterRunContext* Get();
+
+	FPMXlsxImporterRunStats& GetStats() { return *Stats; }
+
+	// Stages timed from now on count towards Entry in the run's stats, or towards the run if Entry is null.
+	// Assets and files queued by SaveCreatedAsset, MarkFileForAdd and DeleteAsset from now on are counted as Entry's work.
+	void SetCurrentEntry(const FPMXlsxImporterSettingsEntry* Entry);
+
+	// Prefetches the worksheets of all Entries, grouping them by xlsx file so that each file takes a single reader call.
+	// Files are read in the order of Entries. If the reader can read on any thread, up to UPMXlsxImporterSettings::PipelineDepth files
+	// are read on worker threads ahead of the one being used, otherwise all of them are read here.
+	// Errors are kept in the results and reported by the entries when they use them.
+	void PrefetchWorksheets(const TArray<const FPMXlsxImporterSettingsEntry*>& Entries);
+
+	// Returns the asset names of a prefetched worksheet, or nullptr if it was not prefetched. Waits for the file to be read if needed.
+	const FPMXlsxImporterPythonBridgeAssetNames* FindPrefetchedAssetNames(const FString& AbsoluteFilePath, const FString& WorksheetName);
+
+	// Returns false if the worksheet was not prefetched with Struct. Otherwise returns its decoded data, or null data and OutError if it
+	// could not be read or decoded. Waits for it to be decoded on a worker thread, or decodes it here if that was not started yet.
+	// The run lets go of the data, so it is only returned once.
+	// Either way, starts decoding up to UPMXlsxImporterSettings::PipelineDepth of the prefetched worksheets that come after this one
+	// on worker threads, so that they're ready by the time their entries need them.
+	bool TakeDecodedWorksheet(const FString& AbsoluteFilePath, const FString& WorksheetName, const UStruct* Struct, TSharedPtr<const FPMXlsxWorksheetData>& OutData, FString& OutError);
+
+	// Decodes data returned by a reader. Returns false and the error to log if the reader failed, or the data has no rows.
+	// May be called from any thread.
+	static bool DecodeWorksheet(const FPMXlsxImporterPythonBridgeJsonString& Data, TSharedPtr<FPMXlsxWorksheetData>& OutData, FString& OutError);
+
+	// Makes how FPMXlsxDataAssetImporterJSON reads the properties of Struct and of every struct they contain, unless they were made already.
+	// They're kept until the run ends, so every row of a worksheet shares them. Game thread only, and never while other threads read them.
+	void AddStructBindings(const UStruct* Struct);
+
+	// Returns the bindings made by AddStructBindings, or nullptr. Doesn't lock, so it may be called from worker threads.
+	const FPMXlsxStructBindings* FindStructBindings(const UStruct* Struct) const;
+
+	// Returns how FPMXlsxDataAssetImporterJSON reads the columns of WorksheetData into Struct, made the first time a worksheet with the same
+	// columns and row key is read into Struct in this run. Struct's bindings must have been added. Game thread only.
+	TSharedRef<const FPMXlsxColumnBindings> AddColumnBindings(const UStruct* Struct, const FPMXlsxWorksheetData& WorksheetData, const FString& RowKey);
+
+	// Writes Data to Intermediate/XlsxJsonFiles on a worker thread if UPMXlsxImporterSettings::JsonDebugDump is enabled.
+	// The run waits for pending writes when it ends.
+	void WriteJsonDebugDump(const FString& AbsoluteFilePath, const FString& WorksheetName, const FPMXlsxImporterPythonBridgeJsonString& Data);
+
+	// Called by importers after they changed Asset. During an import run, Asset is queued to be saved with all other modified assets once
+	// the run has validated them. Outside of an import run, Asset is saved right away. Returns false if that fails.
+	static bool SaveModifiedAsset(UObject* Asset, FPMXlsxImporterContextLogger& InOutErrors);
+
+	// The assets queued by SaveModifiedAsset, by the entry that was current when they were queued
+	const TMap<const FPMXlsxImporterSettingsEntry*, TArray<UObject*>>& GetModifiedAssets() const { return ModifiedAssets; }
+
+	// Checks out Assets with a single source control operation if bCheckoutGeneratedAssets is set, then saves all of them with a single save call.
+	// Returns false if any of them could not be checked out or saved.
+	static bool SaveAssets(const TArray<UObject*>& Assets, FPMXlsxImporterContextLogger& InOutErrors);
+
+	// Called by SyncAssets for each asset it creates. During an import run, new packages are saved together by SaveCreatedAssets,
+	// otherwise the package is saved right away.
+	static void SaveCreatedAsset(UObject* Asset, FPMXlsxImporterContextLogger& InOutErrors);
+
+	// Called by SyncAssets for each output dir of primary assets, so that UAssetManager knows about created assets before ParseData.
+	// During an import run, paths are queued and scanned together by ScanPrimaryAssetPaths, otherwise Path is scanned right away.
+	static void ScanPrimaryAssetPath(const FString& Path);
+
+	// Saves all queued new packages in one batch, writing their files asynchronously
+	void SaveCreatedAssets(FPMXlsxImporterContextLogger& InOutErrors);
+
+	// Rescans the union of all queued paths with a single UAssetManager::ScanPathsSynchronous call
+	void ScanPrimaryAssetPaths();
+
+	// Called by SyncAssets for each file it creates and each asset it removes. During an import run, these are queued until
+	// SubmitSourceControlChanges, otherwise they are applied right away.
+	static void MarkFileForAdd(const FString& AbsoluteFilePath, FPMXlsxImporterContextLogger& InOutErrors);
+	static void DeleteAsset(const FString& AssetPath, FPMXlsxImporterContextLogger& InOutErrors);
+
+	// Marks all queued files for add with one source control operation, then deletes all queued assets together
+	void SubmitSourceControlChanges(FPMXlsxImporterContextLogger& InOutErrors);
+
+	// Removes and returns the entries that queued work for SaveCreatedAssets or SubmitSourceControlChanges since the last call.
+	// Those batches don't tell which of their files failed, so the run fails all of these entries if a batch logs an error.
+	TSet<const FPMXlsxImporterSettingsEntry*> TakeEntriesWithQueuedChanges();
+
+	// FGCObject interface
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override;
+
+private:
+	struct FPrefetchedFile
+	{
+		FString AbsoluteFilePath;
+		TArray<FPMXlsxImporterPythonBridgeWorksheetRequest> Requests;
+		// Set while the file is read on a worker thread. Shared so that the results can be moved out of the future
+		TFuture<TSharedPtr<TArray<FPMXlsxImporterPythonBridgeWorksheetResult>>> PendingResults;
+		bool bRead = false;
+	};
+
+	struct FDecodedWorksheet
+	{
+		TSharedPtr<const FPMXlsxWorksheetData> Data;
+		FString Error;
+		// Size of the data returned by the reader
+		int64 NumBytes = 0;
+		// Counted towards the entry that takes the worksheet, rather than the one being imported while it was decoded
+		double DecodeSeconds = 0.0;
+	};
+
+	struct FPrefetchedWorksheet
+	{
+		const UStruct* Struct = nullptr;
+		FString WorksheetName;
+		// Index in PrefetchedFiles
+		int32 FileIndex = 0;
+		// Index in PrefetchedWorksheetOrder
+		int32 Order = 0;
+		// Kept until the run ends, since SyncAssets and Validate both use them
+		FPMXlsxImporterPythonBridgeAssetNames AssetNames;
+		// Moved into the decode task when decoding starts, so that it is freed as soon as the worksheet is decoded
+		FPMXlsxImporterPythonBridgeJsonString Data;
+		TFuture<FDecodedWorksheet> PendingDecode;
+		bool bDecodeStarted = false;
+	};
+
+	static FString MakeWorksheetKey(const FString& AbsoluteFilePath, const FString& WorksheetName);
+
+	// Starts reading the files after FileIndex on worker threads, up to PipelineDepth of them, then waits for FileIndex to be read
+	void WaitForPrefetchedFile(int32 FileIndex);
+	// Moves the results of a file that was read into PrefetchedWorksheets
+	void StorePrefetchedResults(const FPrefetchedFile& File, TArray<FPMXlsxImporterPythonBridgeWorksheetResult>&& Results);
+	// Moves the data of Worksheet, which must have been read, into a task that decodes it on a worker thread
+	void StartDecoding(FPrefetchedWorksheet& Worksheet);
+	// Decodes Data and writes the json debug dump of the result if UPMXlsxImporterSettings::JsonDebugDump is enabled
+	static FDecodedWorksheet DecodePrefetchedWorksheet(const FPMXlsxImporterPythonBridgeJsonString& Data, const FString& JsonDebugDumpFile, EPMXlsxJsonDumpMode DumpMode);
+	static FString MakeJsonDebugDumpFile(const FString& AbsoluteFilePath, const FString& WorksheetName);
+	static void SaveJsonDebugDump(const FPMXlsxWorksheetData& WorksheetData, const FString& JsonDebugDumpFile, EPMXlsxJsonDumpMode DumpMode);
+
+	// Returns the assets whose files are checked out, or were not under source control to begin with
+	static TArray<UObject*> CheckOutAssets(const TArray<UObject*>& Assets, FPMXlsxImporterContextLogger& InOutErrors);
+	static void SavePackages(const TArray<UObject*>& Assets, FPMXlsxImporterContextLogger& InOutErrors);
+	static void MarkFilesForAdd(const TArray<FString>& AbsoluteFilePaths, FPMXlsxImporterContextLogger& InOutErrors);
+	static void DeleteAssets(const TArray<FString>& AssetPaths, FPMXlsxImporterContextLogger& InOutErrors);
+
+	// Files to prefetch, in the order they're used
+	TArray<FPrefetchedFile> PrefetchedFiles;
+	TMap<FString, FPrefetchedWorksheet> PrefetchedWorksheets;
+	// Keys of PrefetchedWorksheets in the order they're used
+	TArray<FString> PrefetchedWorksheetOrder;
+	// Number of files to read and worksheets to decode ahead of the one being used, see UPMXlsxImporterSettings::PipelineDepth
+	int32 PipelineDepth = 0;
+	// False if the reader can only be used on the game thread, then all files are read up front
+	bool bReadOnWorkerThreads = false;
+
+	// Not moved when the map grows, so references stay valid when more bindings are added
+	TMap<const UStruct*, TUniquePtr<const FPMXlsxStructBindings>> StructBindings;
+	// By struct and the row key followed by the column names
+	TMap<TPair<const UStruct*, FString>, TSharedRef<const FPMXlsxColumnBindings>> ColumnBindings;
+
+	TArray<TFuture<void>> PendingJsonDebugDumps;
+
+	// Referenced until the run ends, since nothing else keeps loaded assets from being garbage collected before the run saves them.
+	// Arrays rather than sets: importers queue each asset once, after importing its row.
+	TMap<const FPMXlsxImporterSettingsEntry*, TArray<UObject*>> ModifiedAssets;
+
+	TArray<UObject*> CreatedAssets;
+	TArray<FString> PrimaryAssetPathsToScan;
+
+	TArray<FString> FilesToMarkForAdd;
+	TArray<FString> AssetsToDelete;
+
+	// See SetCurrentEntry
+	const FPMXlsxImporterSettingsEntry* CurrentEntry = nullptr;
+	TSet<const FPMXlsxImporterSettingsEntry*> EntriesWithQueuedChanges;
+
+	// The reader told about this run, so it can keep workbooks open until the run ends
+	IPMXlsxImporterReader* Reader = nullptr;
+
+	// Points to the caller's stats, or to OwnStats
+	FPMXlsxImporterRunStats* Stats = nullptr;
+	FPMXlsxImporterRunStats OwnStats;
+	// Index of each entry in Stats
+	TMap<const FPMXlsxImporterSettingsEntry*, int32> StatsEntryIndices;
+
+	static FPMXlsxImporterRunContext* Current;
+};
+
+// Adds the time until it goes out of scope to a stage of the current import run, if there is one. Usually made by PMXLSX_IMPORT_STAGE_SCOPE.
+// The time goes to the thread's FPMXlsxImporterStageTimeCollector if it has one, otherwise straight to the run's stats.
+class FPMXlsxImporterStageTimer
+{
+public:
+	// bForRun counts the time towards the run rather than the entry being imported, for work on other threads that is not done for that entry
+	explicit FPMXlsxImporterStageTimer(EPMXlsxImportStage InStage, bool bInForRun = false);
+	~FPMXlsxImporterStageTimer();
+
+private:
+	EPMXlsxImportStage Stage;
+	bool bForRun;
+	uint64 StartCycles;
+};
+
+// Sums the stages timed on this thread while it's in scope, so that stages timed for every row don't lock the run's stats each time.
+// Collectors nest, the innermost one of a thread collects.
+class FPMXlsxImporterStageTimeCollector
+{
+public:
+	// Collects into its own times and adds them to the current import run when it goes out of scope
+	FPMXlsxImporterStageTimeCollector();
+	// Collects into OutTimes, for the caller to add to the run, e.g. on the game thread once a batch of worker tasks is done
+	explicit FPMXlsxImporterStageTimeCollector(FPMXlsxImporterStageTimes& OutTimes);
+	~FPMXlsxImporterStageTimeCollector();
+
+	FPMXlsxImporterStageTimeCollector(const FPMXlsxImporterStageTimeCollector&) = delete;
+	FPMXlsxImporterStageTimeCollector& operator=(const FPMXlsxImporterStageTimeCollector&) = delete;
+
+	// Returns the times of the innermost collector of this thread, or nullptr if it has none
+	static FPMXlsxImporterStageTimes* GetTimes();
+
+private:
+	FPMXlsxImporterStageTimes OwnTimes;
+	FPMXlsxImporterStageTimes& Times;
+	bool bAddToRun;
+	FPMXlsxImporterStageTimeCollector* Outer;
+};
+
+// Names the rest of the scope PMXlsxImporter_<Stage> in Unreal Insights and adds its time to the stage in the stats of the current import run
+#define PMXLSX_IMPORT_STAGE_SCOPE(Stage) \
+	TRACE_CPUPROFILER_EVENT_SCOPE(PMXlsxImporter_##Stage); \
+	const FPMXlsxImporterStageTimer PMXlsxImporterStageTimer_##Stage(EPMXlsxImportStage::Stage)
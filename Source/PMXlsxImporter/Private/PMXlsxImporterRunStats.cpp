@@ -0,0 +1,199 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+
+#include "PMXlsxImporterRunStats.h"
+
+#include "PMXlsxImporterLog.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+#include "ProfilingDebugging/CountersTrace.h"
+
+TRACE_DECLARE_INT_COUNTER(PMXlsxImporter_Rows, TEXT("PMXlsxImporter/Rows"));
+TRACE_DECLARE_INT_COUNTER(PMXlsxImporter_Bytes, TEXT("PMXlsxImporter/Bytes"));
+TRACE_DECLARE_INT_COUNTER(PMXlsxImporter_SavedAssets, TEXT("PMXlsxImporter/SavedAssets"));
+
+void FPMXlsxImporterStageTimes::Add(const FPMXlsxImporterStageTimes& Other)
+{
+	for (int32 Stage = 0; Stage < static_cast<int32>(EPMXlsxImportStage::Num); ++Stage)
+	{
+		Cycles[Stage] += Other.Cycles[Stage];
+	}
+}
+
+FPMXlsxImporterRunStats::FPMXlsxImporterRunStats()
+	: StartTime(FPlatformTime::Seconds())
+{
+	Run.Name = TEXT("(run)");
+}
+
+int32 FPMXlsxImporterRunStats::AddEntry(const FString& Name)
+{
+	FScopeLock Lock(&CriticalSection);
+	const int32 EntryIndex = Entries.AddDefaulted();
+	Entries[EntryIndex].Name = Name;
+	return EntryIndex;
+}
+
+void FPMXlsxImporterRunStats::SetCurrentEntry(int32 EntryIndex)
+{
+	FScopeLock Lock(&CriticalSection);
+	CurrentEntryIndex = EntryIndex;
+}
+
+void FPMXlsxImporterRunStats::AddTime(EPMXlsxImportStage Stage, double Seconds, bool bForRun)
+{
+	FScopeLock Lock(&CriticalSection);
+	GetCurrentEntry(bForRun).StageSeconds[static_cast<int32>(Stage)] += Seconds;
+}
+
+void FPMXlsxImporterRunStats::AddTimes(const FPMXlsxImporterStageTimes& Times)
+{
+	const double SecondsPerCycle = FPlatformTime::GetSecondsPerCycle64();
+	FScopeLock Lock(&CriticalSection);
+	FEntry& Entry = GetCurrentEntry(false);
+	for (int32 Stage = 0; Stage < static_cast<int32>(EPMXlsxImportStage::Num); ++Stage)
+	{
+		Entry.StageSeconds[Stage] += Times.Cycles[Stage] * SecondsPerCycle;
+	}
+}
+
+void FPMXlsxImporterRunStats::AddRows(int64 NumRows)
+{
+	TRACE_COUNTER_ADD(PMXlsxImporter_Rows, NumRows);
+	FScopeLock Lock(&CriticalSection);
+	GetCurrentEntry(false).NumRows += NumRows;
+}
+
+void FPMXlsxImporterRunStats::AddBytes(int64 NumBytes)
+{
+	TRACE_COUNTER_ADD(PMXlsxImporter_Bytes, NumBytes);
+	FScopeLock Lock(&CriticalSection);
+	GetCurrentEntry(false).NumBytes += NumBytes;
+}
+
+void FPMXlsxImporterRunStats::AddSavedAssets(int32 NumAssets)
+{
+	TRACE_COUNTER_ADD(PMXlsxImporter_SavedAssets, NumAssets);
+	FScopeLock Lock(&CriticalSection);
+	NumSavedAssets += NumAssets;
+}
+
+void FPMXlsxImporterRunStats::Finish()
+{
+	TotalSeconds = FPlatformTime::Seconds() - StartTime;
+}
+
+double FPMXlsxImporterRunStats::GetStageSeconds(EPMXlsxImportStage Stage) const
+{
+	double Seconds = Run.StageSeconds[static_cast<int32>(Stage)];
+	for (const FEntry& Entry : Entries)
+	{
+		Seconds += Entry.StageSeconds[static_cast<int32>(Stage)];
+	}
+	return Seconds;
+}
+
+int64 FPMXlsxImporterRunStats::GetNumRows() const
+{
+	int64 NumRows = Run.NumRows;
+	for (const FEntry& Entry : Entries)
+	{
+		NumRows += Entry.NumRows;
+	}
+	return NumRows;
+}
+
+int64 FPMXlsxImporterRunStats::GetNumBytes() const
+{
+	int64 NumBytes = Run.NumBytes;
+	for (const FEntry& Entry : Entries)
+	{
+		NumBytes += Entry.NumBytes;
+	}
+	return NumBytes;
+}
+
+const TCHAR* FPMXlsxImporterRunStats::GetStageName(EPMXlsxImportStage Stage)
+{
+	switch (Stage)
+	{
+	case EPMXlsxImportStage::Read: return TEXT("Read");
+	case EPMXlsxImportStage::Wait: return TEXT("Wait");
+	case EPMXlsxImportStage::Decode: return TEXT("Decode");
+	case EPMXlsxImportStage::SyncAssets: return TEXT("SyncAssets");
+	case EPMXlsxImportStage::ParseData: return TEXT("ParseData");
+	case EPMXlsxImportStage::ReadAsset: return TEXT("ReadAsset");
+	case EPMXlsxImportStage::WasModified: return TEXT("WasModified");
+	case EPMXlsxImportStage::Validate: return TEXT("Validate");
+	case EPMXlsxImportStage::Save: return TEXT("Save");
+	case EPMXlsxImportStage::SourceControl: return TEXT("SourceControl");
+	default: return TEXT("Unknown");
+	}
+}
+
+bool FPMXlsxImporterRunStats::IsSummedOverThreads(EPMXlsxImportStage Stage)
+{
+	return Stage == EPMXlsxImportStage::Read || Stage == EPMXlsxImportStage::Decode || Stage == EPMXlsxImportStage::ReadAsset;
+}
+
+void FPMXlsxImporterRunStats::LogSummary() const
+{
+	FEntry Total;
+	Total.Name = TEXT("(total)");
+	for (int32 Stage = 0; Stage < static_cast<int32>(EPMXlsxImportStage::Num); ++Stage)
+	{
+		Total.StageSeconds[Stage] = GetStageSeconds(static_cast<EPMXlsxImportStage>(Stage));
+	}
+	Total.NumRows = GetNumRows();
+	Total.NumBytes = GetNumBytes();
+
+	TArray<const FEntry*> Lines;
+	Lines.Add(&Run);
+	for (const FEntry& Entry : Entries)
+	{
+		Lines.Add(&Entry);
+	}
+	Lines.Add(&Total);
+
+	int32 NameWidth = 0;
+	for (const FEntry* Line : Lines)
+	{
+		NameWidth = FMath::Max(NameWidth, Line->Name.Len());
+	}
+
+	// Each column is as wide as its header, and at least wide enough for a few minutes with millisecond precision
+	constexpr int32 MinColumnWidth = 8;
+	TArray<FString> StageLabels;
+	FString Header = FString().RightPad(NameWidth);
+	for (int32 Stage = 0; Stage < static_cast<int32>(EPMXlsxImportStage::Num); ++Stage)
+	{
+		const EPMXlsxImportStage ImportStage = static_cast<EPMXlsxImportStage>(Stage);
+		FString& Label = StageLabels.Add_GetRef(GetStageName(ImportStage));
+		if (IsSummedOverThreads(ImportStage))
+		{
+			Label += TEXT(" CPU");
+		}
+		Header += TEXT(" ") + Label.LeftPad(MinColumnWidth);
+	}
+	Header += TEXT(" ") + FString(TEXT("Rows")).LeftPad(10) + TEXT(" ") + FString(TEXT("Bytes")).LeftPad(12);
+
+	UE_LOG(LogPMXlsxImporter, Log, TEXT("Import run took %.3f s: %i entries, %lld rows, %lld bytes of worksheet data, %i assets saved. Seconds per stage, CPU stages are summed over all threads:"),
+		TotalSeconds, Entries.Num(), Total.NumRows, Total.NumBytes, NumSavedAssets);
+	UE_LOG(LogPMXlsxImporter, Log, TEXT("%s"), *Header);
+	for (const FEntry* Line : Lines)
+	{
+		FString Text = Line->Name.RightPad(NameWidth);
+		for (int32 Stage = 0; Stage < static_cast<int32>(EPMXlsxImportStage::Num); ++Stage)
+		{
+			const int32 ColumnWidth = FMath::Max(MinColumnWidth, StageLabels[Stage].Len());
+			Text += TEXT(" ") + FString::Printf(TEXT("%.3f"), Line->StageSeconds[Stage]).LeftPad(ColumnWidth);
+		}
+		Text += TEXT(" ") + FString::Printf(TEXT("%lld"), Line->NumRows).LeftPad(10) + TEXT(" ") + FString::Printf(TEXT("%lld"), Line->NumBytes).LeftPad(12);
+		UE_LOG(LogPMXlsxImporter, Log, TEXT("%s"), *Text);
+	}
+}
+
+FPMXlsxImporterRunStats::FEntry& FPMXlsxImporterRunStats::GetCurrentEntry(bool bForRun)
+{
+	return bForRun || !Entries.IsValidIndex(CurrentEntryIndex) ? Run : Entries[CurrentEntryIndex];
+}
@@ -4,7 +4,12 @@
 #include "PMXlsxImporterSettingsEntry.h"
 #include "PMXlsxImporterPythonBridge.h"
 #include "PMXlsxImporterLog.h"
+#include "PMXlsxImporterManifest.h"
+#include "PMXlsxImporterRunContext.h"
 #include "Containers/List.h"
+#include "ISourceControlModule.h"
+#include "ISourceControlProvider.h"
+#include "SourceControlOperations.h"
 
 #if WITH_EDITOR
 void UPMXlsxImporterSettings::PostEditChangeChainProperty(FPropertyChangedChainEvent& PropertyChangedEvent)
@@ -35,119 +40,226 @@ void UPMXlsxImporterSettings::PostEditChangeChainProperty(FPropertyChangedChainE
 }
 #endif
 
-void UPMXlsxImporterSettings::ImportCheckedOut(FPMXlsxImporterContextLogger& InOutErrors) const
+void UPMXlsxImporterSettings::ImportCheckedOut(FPMXlsxImporterContextLogger& InOutErrors, bool bForce, FPMXlsxImporterRunStats* OutStats) const
 {
-	// First, create all autogenerated objects so that they can reference each other
+	// Comes before the run starts, so it's only traced and not part of the run's stats
+	TRACE_CPUPROFILER_EVENT_SCOPE(PMXlsxImporter_SourceControl);
+
+	// Update the status of every xlsx file with a single source control operation. Entries often share a workbook, so query each file once.
+	TArray<FString> XlsxFiles;
 	for (const FPMXlsxImporterSettingsEntry& AssetImportData : AssetImportSettings)
 	{
-		FSourceControlState State = AssetImportData.GetXlsxFileSourceControlState(/*bSilent:*/ false);
-		if (State.bIsValid && State.bIsCheckedOut)
-		{
-			UE_LOG(LogPMXlsxImporter, Log, TEXT("File %s is checked out"), *AssetImportData.XlsxFile.FilePath);
-			AssetImportData.SyncAssets(InOutErrors, MaxErrors);
-			if (InOutErrors.Num() >= MaxErrors)
-			{
-				return;
-			}
-		}
-		else
+		const FString XlsxAbsolutePath = AssetImportData.GetXlsxAbsolutePath();
+		if (!XlsxAbsolutePath.IsEmpty())
 		{
-			UE_LOG(LogPMXlsxImporter, Verbose, TEXT("File %s is NOT checked out. Skipping."), *AssetImportData.XlsxFile.FilePath);
+			XlsxFiles.AddUnique(XlsxAbsolutePath);
 		}
 	}
 
-	// Then get each of them to parse data from xlsx
-	for (const FPMXlsxImporterSettingsEntry& AssetImportData : AssetImportSettings)
+	TSet<FString> CheckedOutFiles;
+	ISourceControlProvider& Provider = ISourceControlModule::Get().GetProvider();
+	if (!ISourceControlModule::Get().IsEnabled() || !Provider.IsAvailable())
 	{
-		FSourceControlState State = AssetImportData.GetXlsxFileSourceControlState(/*bSilent:*/ true);
-		if (State.bIsValid && State.bIsCheckedOut)
+		UE_LOG(LogPMXlsxImporter, Warning, TEXT("Source control is not available. No xlsx file is checked out."));
+	}
+	else if (XlsxFiles.Num() > 0)
+	{
+		// GetState only reads the cache that FUpdateStatus just filled, and returns the states in the order of XlsxFiles
+		TArray<FSourceControlStateRef> States;
+		if (Provider.Execute(ISourceControlOperation::Create<FUpdateStatus>(), XlsxFiles) != ECommandResult::Succeeded ||
+			Provider.GetState(XlsxFiles, States, EStateCacheUsage::Use) != ECommandResult::Succeeded || States.Num() != XlsxFiles.Num())
 		{
-			AssetImportData.ParseData(InOutErrors, MaxErrors);
-			if (InOutErrors.Num() >= MaxErrors)
+			UE_LOG(LogPMXlsxImporter, Warning, TEXT("Could not get the source control state of %i xlsx files"), XlsxFiles.Num());
+			States.Reset();
+		}
+
+		for (int32 Index = 0; Index < States.Num(); ++Index)
+		{
+			if (States[Index]->IsValid() && States[Index]->IsCheckedOut())
 			{
-				return;
+				CheckedOutFiles.Add(XlsxFiles[Index]);
 			}
 		}
 	}
 
-	// Then validate the data
+	TArray<const FPMXlsxImporterSettingsEntry*> CheckedOutEntries;
 	for (const FPMXlsxImporterSettingsEntry& AssetImportData : AssetImportSettings)
 	{
-		FSourceControlState State = AssetImportData.GetXlsxFileSourceControlState(/*bSilent:*/ true);
-		if (State.bIsValid && State.bIsCheckedOut)
+		if (CheckedOutFiles.Contains(AssetImportData.GetXlsxAbsolutePath()))
 		{
-			AssetImportData.Validate(InOutErrors, MaxErrors);
-			if (InOutErrors.Num() >= MaxErrors)
-			{
-				return;
-			}
+			UE_LOG(LogPMXlsxImporter, Log, TEXT("File %s is checked out"), *AssetImportData.XlsxFile.FilePath);
+			CheckedOutEntries.Add(&AssetImportData);
+		}
+		else
+		{
+			UE_LOG(LogPMXlsxImporter, Verbose, TEXT("File %s is NOT checked out. Skipping."), *AssetImportData.XlsxFile.FilePath);
 		}
 	}
+
+	ImportEntries(CheckedOutEntries, bForce, InOutErrors, OutStats);
 }
 
-void UPMXlsxImporterSettings::ImportAll(FPMXlsxImporterContextLogger& InOutErrors) const
+void UPMXlsxImporterSettings::ImportAll(FPMXlsxImporterContextLogger& InOutErrors, bool bForce, FPMXlsxImporterRunStats* OutStats) const
 {
 	UE_LOG(LogPMXlsxImporter, Log, TEXT("Importing all XLSX files"));
 
-	// First, create all autogenerated objects so that they can reference each other
+	TArray<const FPMXlsxImporterSettingsEntry*> Entries;
 	for (const FPMXlsxImporterSettingsEntry& AssetImportData : AssetImportSettings)
 	{
-		AssetImportData.SyncAssets(InOutErrors, MaxErrors);
-		if (InOutErrors.Num() >= MaxErrors)
+		Entries.Add(&AssetImportData);
+	}
+
+	ImportEntries(Entries, bForce, InOutErrors, OutStats);
+}
+
+void UPMXlsxImporterSettings::ImportEntry(int32 Index, FPMXlsxImporterContextLogger& InOutErrors, FPMXlsxImporterRunStats* OutStats) const
+{
+	UE_LOG(LogPMXlsxImporter, Log, TEXT("Importing entry %i"), Index);
+
+	if (!AssetImportSettings.IsValidIndex(Index))
+	{
+		InOutErrors.Logf(TEXT("Invalid index %i"), Index);
+		return;
+	}
+
+	// Importing a single entry is always an explicit request, so it doesn't skip unchanged entries
+	ImportEntries({ &AssetImportSettings[Index] }, /*bForce:*/ true, InOutErrors, OutStats);
+}
+
+void UPMXlsxImporterSettings::ImportEntries(const TArray<const FPMXlsxImporterSettingsEntry*>& Entries, bool bForce, FPMXlsxImporterContextLogger& InOutErrors, FPMXlsxImporterRunStats* OutStats) const
+{
+	FPMXlsxImporterRunContext RunContext(OutStats);
+
+	FPMXlsxImporterManifest Manifest;
+	Manifest.Load();
+
+	// Skip entries whose xlsx file, settings and struct did not change since they were last imported successfully
+	TArray<const FPMXlsxImporterSettingsEntry*> ChangedEntries;
+	TMap<const FPMXlsxImporterSettingsEntry*, FString> EntryHashes;
+	for (const FPMXlsxImporterSettingsEntry* AssetImportData : Entries)
+	{
+		FString Hash;
+		if (Manifest.ComputeHash(*AssetImportData, Hash))
 		{
-			return;
+			if (!bForce && Manifest.IsUpToDate(*AssetImportData, Hash))
+			{
+				UE_LOG(LogPMXlsxImporter, Log, TEXT("%s:%s is unchanged since the last import. Skipping."), *AssetImportData->XlsxFile.FilePath, *AssetImportData->WorksheetName);
+				continue;
+			}
+			EntryHashes.Add(AssetImportData, Hash);
 		}
+		ChangedEntries.Add(AssetImportData);
 	}
 
-	// Then get each of them to parse data from xlsx
-	for (const FPMXlsxImporterSettingsEntry& AssetImportData : AssetImportSettings)
+	RunContext.PrefetchWorksheets(ChangedEntries);
+
+	// Entries that logged an error are imported again next time, as are entries left unfinished once MaxErrors is reached
+	TSet<const FPMXlsxImporterSettingsEntry*> FailedEntries;
+	TSet<const FPMXlsxImporterSettingsEntry*> UnfinishedEntries;
+	const auto RunStep = [&InOutErrors, &FailedEntries, &ChangedEntries, &RunContext](const FPMXlsxImporterSettingsEntry* AssetImportData, TFunctionRef<void()> Step)
 	{
-		AssetImportData.ParseData(InOutErrors, MaxErrors);
-		if (InOutErrors.Num() >= MaxErrors)
+		// Errors are reported by entry, whichever step logged them
+		auto ScopedErrorOrder = InOutErrors.PushOrder(ChangedEntries.IndexOfByKey(AssetImportData));
+		const int32 NumErrors = InOutErrors.Num();
+		RunContext.SetCurrentEntry(AssetImportData);
+		Step();
+		RunContext.SetCurrentEntry(nullptr);
+		if (InOutErrors.Num() > NumErrors)
 		{
-			return;
+			FailedEntries.Add(AssetImportData);
 		}
-	}
+	};
 
-	// Then validate the data
-	for (const FPMXlsxImporterSettingsEntry& AssetImportData : AssetImportSettings)
+	// Runs a step for each entry until MaxErrors is reached. The entries it doesn't get to are unfinished.
+	// The entries that did finish are still saved below.
+	const auto RunSteps = [this, &InOutErrors, &ChangedEntries, &UnfinishedEntries, &RunStep](TFunctionRef<void(const FPMXlsxImporterSettingsEntry&)> Step)
 	{
-		AssetImportData.Validate(InOutErrors, MaxErrors);
-		if (InOutErrors.Num() >= MaxErrors)
+		for (int32 Index = 0; Index < ChangedEntries.Num(); ++Index)
 		{
-			return;
+			if (InOutErrors.Num() >= MaxErrors)
+			{
+				for (; Index < ChangedEntries.Num(); ++Index)
+				{
+					UnfinishedEntries.Add(ChangedEntries[Index]);
+				}
+				break;
+			}
+
+			const FPMXlsxImporterSettingsEntry* AssetImportData = ChangedEntries[Index];
+			RunStep(AssetImportData, [&Step, AssetImportData]() { Step(*AssetImportData); });
 		}
-	}
-}
+	};
 
-void UPMXlsxImporterSettings::ImportEntry(int32 Index, FPMXlsxImporterContextLogger& InOutErrors) const
-{
-	UE_LOG(LogPMXlsxImporter, Log, TEXT("Importing entry %i"), Index);
+	// First, create all autogenerated objects so that they can reference each other
+	RunSteps([this, &InOutErrors](const FPMXlsxImporterSettingsEntry& AssetImportData) { AssetImportData.SyncAssets(InOutErrors, MaxErrors); });
 
-	if (!AssetImportSettings.IsValidIndex(Index))
+	// Save all created assets as one batch, let the AssetManager discover them with a single rescan,
+	// then mark their files for add and delete all removed assets, one source control operation each
+	const int32 NumErrorsBeforeBatches = InOutErrors.Num();
+	RunContext.SaveCreatedAssets(InOutErrors);
+	RunContext.ScanPrimaryAssetPaths();
+	RunContext.SubmitSourceControlChanges(InOutErrors);
+	const TSet<const FPMXlsxImporterSettingsEntry*> EntriesWithQueuedChanges = RunContext.TakeEntriesWithQueuedChanges();
+	if (InOutErrors.Num() > NumErrorsBeforeBatches)
 	{
-		InOutErrors.Logf(TEXT("Invalid index %i"), Index);
-		return;
+		// There's no telling which entry's files failed, so import all entries that queued any of them again next time
+		FailedEntries.Append(EntriesWithQueuedChanges);
 	}
 
-	const FPMXlsxImporterSettingsEntry& Entry = AssetImportSettings[Index];
+	// Then get each of them to parse data from xlsx. Modified assets are saved at the end, once they have been validated.
+	RunSteps([this, &InOutErrors](const FPMXlsxImporterSettingsEntry& AssetImportData) { AssetImportData.ParseData(InOutErrors, MaxErrors); });
 
-	// First, create all autogenerated objects so that they can reference each other
-	Entry.SyncAssets(InOutErrors, MaxErrors);
-	if (InOutErrors.Num() >= MaxErrors)
+	// Then validate the data
+	RunSteps([this, &InOutErrors](const FPMXlsxImporterSettingsEntry& AssetImportData) { AssetImportData.Validate(InOutErrors, MaxErrors); });
+
+	// Save the assets of all entries that succeeded in one batch. Entries with errors don't get written to disk at all,
+	// their modified assets stay dirty in the editor.
+	const TMap<const FPMXlsxImporterSettingsEntry*, TArray<UObject*>>& ModifiedAssets = RunContext.GetModifiedAssets();
+	TArray<UObject*> AssetsToSave;
+	for (const TPair<const FPMXlsxImporterSettingsEntry*, TArray<UObject*>>& EntryAssets : ModifiedAssets)
 	{
-		return;
+		if (EntryAssets.Value.Num() == 0)
+		{
+			continue;
+		}
+
+		if (FailedEntries.Contains(EntryAssets.Key))
+		{
+			UE_LOG(LogPMXlsxImporter, Warning, TEXT("%s:%s had errors. Not saving its %i modified assets."), *EntryAssets.Key->XlsxFile.FilePath,
+				*EntryAssets.Key->WorksheetName, EntryAssets.Value.Num());
+			continue;
+		}
+
+		if (UnfinishedEntries.Contains(EntryAssets.Key))
+		{
+			UE_LOG(LogPMXlsxImporter, Warning, TEXT("%s:%s was not validated before reaching the error limit. Not saving its %i modified assets."),
+				*EntryAssets.Key->XlsxFile.FilePath, *EntryAssets.Key->WorksheetName, EntryAssets.Value.Num());
+			continue;
+		}
+
+		AssetsToSave.Append(EntryAssets.Value);
 	}
 
-	// Then get each of them to parse data from xlsx
-	Entry.ParseData(InOutErrors, MaxErrors);
-	if (InOutErrors.Num() >= MaxErrors)
+	if (!FPMXlsxImporterRunContext::SaveAssets(AssetsToSave, InOutErrors))
 	{
-		return;
+		// There's no telling which assets failed, so import all entries that modified assets again next time
+		for (const TPair<const FPMXlsxImporterSettingsEntry*, TArray<UObject*>>& EntryAssets : ModifiedAssets)
+		{
+			if (EntryAssets.Value.Num() > 0)
+			{
+				FailedEntries.Add(EntryAssets.Key);
+			}
+		}
 	}
 
-	// Then validate the data
-	Entry.Validate(InOutErrors, MaxErrors);
+	for (const TPair<const FPMXlsxImporterSettingsEntry*, FString>& EntryHash : EntryHashes)
+	{
+		if (!FailedEntries.Contains(EntryHash.Key) && !UnfinishedEntries.Contains(EntryHash.Key))
+		{
+			Manifest.Update(*EntryHash.Key, EntryHash.Value);
+		}
+	}
+	Manifest.Save();
 }
 
 TArray<FString> UPMXlsxImporterSettings::GetWorksheetNames() const
@@ -7,11 +7,15 @@
 #include "PMXlsxImporterLog.h"
 #include "EditorAssetLibrary.h"
 #include "Engine/AssetManager.h"
+#include "Async/ParallelFor.h"
 #include "UObject/SavePackage.h"
 #include "FileHelpers.h"
 #include "PMXlsxDataTableImportUtils.h"
 #include "PMXlsxImporterPythonReflection.h"
+#include "PMXlsxImporterReader.h"
+#include "PMXlsxImporterRunContext.h"
 #include "PMXlsxImporterSettings.h"
+#include "PMXlsxWorksheetData.h"
 #include "Engine/Private/DataTableJSON.h"
 #include "Kismet/DataTableFunctionLibrary.h"
 #include "Kismet/KismetStringLibrary.h"
@@ -71,12 +75,13 @@ TArray<FString> FPMXlsxImporterSettingsEntry::GetWorksheetNames() const
 		return TArray<FString>();
 	}
 
-	UPMXlsxImporterPythonBridge* PythonBridge = UPMXlsxImporterPythonBridge::Get();
-	return PythonBridge ? PythonBridge->ReadWorksheetNames(XlsxAbsolutePath) : TArray<FString>();
+	IPMXlsxImporterReader* Reader = IPMXlsxImporterReader::Get();
+	return Reader ? Reader->ReadWorksheetNames(XlsxAbsolutePath) : TArray<FString>();
 }
 
 void FPMXlsxImporterSettingsEntry::SyncAssets(FPMXlsxImporterContextLogger& InOutErrors, int32 MaxErrors) const
 {
+	PMXLSX_IMPORT_STAGE_SCOPE(SyncAssets);
 	auto ScopedErrorContext = InOutErrors.PushContext(FString::Printf(TEXT("%s:%s"), *XlsxFile.FilePath, *WorksheetName));
 
 	if ((ImportType == EPMXlsxImportType::DataAsset && !DataAssetType.IsValid()) ||
@@ -118,29 +123,27 @@ void FPMXlsxImporterSettingsEntry::SyncAssets(FPMXlsxImporterContextLogger& InOu
 
 		IFileManager& FileManager = IFileManager::Get();
 	
-		UPMXlsxImporterPythonBridge* PythonBridge = UPMXlsxImporterPythonBridge::Get(&InOutErrors);
-		if (PythonBridge == nullptr)
+		IPMXlsxImporterReader* Reader = IPMXlsxImporterReader::Get(&InOutErrors);
+		if (Reader == nullptr)
 		{
-			return; // UPMXlsxImporterPythonBridge::Get() logs an error when it returns null
+			return; // IPMXlsxImporterReader::Get() logs an error when it returns null
 		}
 
-		const UPMXlsxImporterSettings* ImporterSettings = GetDefault<UPMXlsxImporterSettings>();
-		check(ImporterSettings);
-
-		FPMXlsxImporterPythonBridgeAssetNames AssetNames = PythonBridge->ReadWorksheetAssetNames(XlsxAbsolutePath, WorksheetName,
-			ImporterSettings->XlsxHeaderRow, ImporterSettings->XlsxDataStartRow);
+		FPMXlsxImporterPythonBridgeAssetNames AssetNames = ReadAssetNames(*Reader, XlsxAbsolutePath);
 		if (!AssetNames.Error.IsEmpty())
 		{
 			InOutErrors.Logf(TEXT("Could not sync assets: could not read asset names from worksheet:\n%s"), *AssetNames.Error);
 			return;
 		}
 
+		// Compare the asset names of the worksheet with the assets of the output dir as sets, rather than looking up each asset.
+		// Note that both sets are case-insensitive.
+		// This is good - perforce will have issues if you change the case of a file.
+		const TMap<FString, FString> ExistingAssets = ListOutputDirAssets();
 		for (const FString& AssetName : AssetNames.AssetNames)
 		{
 			const FString AssetPath = GetProjectRootOutputPath(AssetName);
-			// Note that DoesAssetExist is case-insensitive.
-			// This is good - perforce will have issues if you change the case of a file.
-			if (!UEditorAssetLibrary::DoesAssetExist(AssetPath))
+			if (!ExistingAssets.Contains(AssetName))
 			{
 				// https://isaratech.com/save-a-procedurally-generated-texture-as-a-new-asset/
 				UPackage* Package = CreatePackage(*AssetPath);
@@ -148,82 +151,36 @@ void FPMXlsxImporterSettingsEntry::SyncAssets(FPMXlsxImporterContextLogger& InOu
 				UPMXlsxDataAsset* Asset = NewObject<UPMXlsxDataAsset>(Package, Class, FName(AssetName), RF_Public | RF_Standalone | RF_MarkAsRootSet);
 				Package->MarkPackageDirty();
 				FAssetRegistryModule::AssetCreated(Asset);
-				const FString PackageFileName = FPackageName::LongPackageNameToFilename(AssetPath, FPackageName::GetAssetPackageExtension());
-
-#if ENGINE_MAJOR_VERSION == 4
-				if (!UPackage::SavePackage(Package, Asset, EObjectFlags::RF_NoFlags, *PackageFileName))
-#elif ENGINE_MAJOR_VERSION == 5
-				FSavePackageArgs SaveArgs;
-				if (!UPackage::SavePackage(Package, Asset, *PackageFileName, SaveArgs))
-#else
-# error Unknown engine version
-#endif
+				// Saved together with all other assets created by the run
+				FPMXlsxImporterRunContext::SaveCreatedAsset(Asset, InOutErrors);
+				if (InOutErrors.Num() >= MaxErrors)
 				{
-					InOutErrors.Logf(TEXT("Unable to save file %s"), *PackageFileName);
-					if (InOutErrors.Num() < MaxErrors)
-					{
-						continue;
-					}
-					else
-					{
-						return;
-					}
+					return;
 				}
-				UE_LOG(LogPMXlsxImporter, Log, TEXT("Created new asset %s"), *AssetPath);
 #if PM_ENABLE_SOURCE_CONTROL
+				const FString PackageFileName = FPackageName::LongPackageNameToFilename(AssetPath, FPackageName::GetAssetPackageExtension());
 				const FString AssetAbsolutePath = FileManager.ConvertToAbsolutePathForExternalAppForWrite(*PackageFileName);
-				USourceControlHelpers::MarkFileForAdd(AssetAbsolutePath);
+				FPMXlsxImporterRunContext::MarkFileForAdd(AssetAbsolutePath, InOutErrors);
 #endif
 			}
 		}
 #if PM_ENABLE_SOURCE_CONTROL
-		TArray<FString> ExistingAssets = UEditorAssetLibrary::ListAssets(GetProjectRootOutputDir(), /*bRecursive:*/ false, /*bIncludeFolder:*/ false);
-		for (const FString& ExistingAssetPath : ExistingAssets)
+		const TSet<FString> WorksheetAssetNames(AssetNames.AssetNames);
+		for (const TPair<FString, FString>& ExistingAsset : ExistingAssets)
 		{
-			// ExistingAssetPath = (e.g.) "/Game/Generated/TestData/test/Sheet1/TestDataFromXLS1.TestDataFromXLS1"
+			// ExistingAsset.Value = (e.g.) "/Game/Generated/TestData/test/Sheet1/TestDataFromXLS1.TestDataFromXLS1"
 
-			if (!ShouldAssetExist(ExistingAssetPath, ParsedWorksheet))
+			if (!WorksheetAssetNames.Contains(ExistingAsset.Key))
 			{
-				// Convert ExistingAssetPath an absolute file path for USourceControlHelpers. There must be a better way to do this.
-				// USourceControlHelpers does try to do this conversion, but it doesn't always work.
-				// PackageName = "/Game/Generated/TestData/test/Sheet1/TestDataFromXLS1"
-				const FString PackageName = FEditorFileUtils::ExtractPackageName(ExistingAssetPath);
-				// RelativePath = "../../../PluginDev/Content/Generated/TestData/test/Sheet1/TestDataFromXLS1.uasset"
-				const FString RelativePath = FPackageName::LongPackageNameToFilename(PackageName, FPackageName::GetAssetPackageExtension());
-				// AbsolutePath = "C:/dev/plugindev-main/PluginDev/Content/Generated/TestData/test/Sheet1/TestDataFromXLS1.uasset"
-				const FString AbsolutePath = FileManager.ConvertToAbsolutePathForExternalAppForWrite(*RelativePath);
-
-				FSourceControlState State = USourceControlHelpers::QueryFileState(AbsolutePath);
-				if (!State.bIsValid)
-				{
-					InOutErrors.Logf(TEXT("Source control state is invalid for %s. Refusing to delete this file."), *AbsolutePath);
-					if (InOutErrors.Num() < MaxErrors)
-					{
-						continue;
-					}
-					else
-					{
-						return;
-					}
-				}
-
-				// Internally marks the file for delete in source control and logs what it's doing
-				if (!UEditorAssetLibrary::DeleteAsset(ExistingAssetPath))
-				{
-					InOutErrors.Logf(TEXT("Unable to delete asset %s"), *ExistingAssetPath);
-					if (InOutErrors.Num() >= MaxErrors)
-					{
-						return;
-					}
-				}
+				// Checks the source control state of the file and deletes the asset, together with all other removed assets of the run
+				FPMXlsxImporterRunContext::DeleteAsset(ExistingAsset.Value, InOutErrors);
 			}
 		}
 #endif
 
-		// Force the AssetManager to rescan now so that it's up to date when we try to validate FPrimaryAssetIds in ParseData().
-		TArray<FString> PathToScan;
-		PathToScan.Add(GetProjectRootOutputDir());
-		AssetManager.ScanPathsSynchronous(PathToScan);
+		// Force the AssetManager to rescan so that it's up to date when we try to validate FPrimaryAssetIds in ParseData().
+		// During an import run, all output dirs are rescanned together once every entry has synced.
+		FPMXlsxImporterRunContext::ScanPrimaryAssetPath(GetProjectRootOutputDir());
 	}
 	else if (ImportType == EPMXlsxImportType::DataTable)
 	{
@@ -252,24 +209,12 @@ void FPMXlsxImporterSettingsEntry::SyncAssets(FPMXlsxImporterContextLogger& InOu
 					DataTable->RowStruct = ScriptStruct;
 					Package->MarkPackageDirty();
 					FAssetRegistryModule::AssetCreated(DataTable);
-					const FString PackageFileName = FPackageName::LongPackageNameToFilename(AssetPath, FPackageName::GetAssetPackageExtension());
-
-#if ENGINE_MAJOR_VERSION == 4
-					if (!UPackage::SavePackage(Package, Asset, EObjectFlags::RF_NoFlags, *PackageFileName))
-#elif ENGINE_MAJOR_VERSION == 5
-					FSavePackageArgs SaveArgs;
-					if (!UPackage::SavePackage(Package, DataTable, *PackageFileName, SaveArgs))
-#else
-# error Unknown engine version
-#endif
-					{
-						InOutErrors.Logf(TEXT("Unable to save file %s"), *PackageFileName);
-						return;
-					}
-					UE_LOG(LogPMXlsxImporter, Log, TEXT("Created new asset %s"), *AssetPath);
+					// Saved together with all other assets created by the run
+					FPMXlsxImporterRunContext::SaveCreatedAsset(DataTable, InOutErrors);
 #if PM_ENABLE_SOURCE_CONTROL
+					const FString PackageFileName = FPackageName::LongPackageNameToFilename(AssetPath, FPackageName::GetAssetPackageExtension());
 					const FString AssetAbsolutePath = FileManager.ConvertToAbsolutePathForExternalAppForWrite(*PackageFileName);
-					USourceControlHelpers::MarkFileForAdd(AssetAbsolutePath);
+					FPMXlsxImporterRunContext::MarkFileForAdd(AssetAbsolutePath, InOutErrors);
 #endif
 				}
 			}
@@ -279,6 +224,9 @@ void FPMXlsxImporterSettingsEntry::SyncAssets(FPMXlsxImporterContextLogger& InOu
 
 void FPMXlsxImporterSettingsEntry::ParseData(FPMXlsxImporterContextLogger& InOutErrors, int32 MaxErrors) const
 {
+	PMXLSX_IMPORT_STAGE_SCOPE(ParseData);
+	// Decode and ReadAsset are timed for each row, sum them here and add them to the run once
+	FPMXlsxImporterStageTimeCollector StageTimeCollector;
 	auto ScopedErrorContext = InOutErrors.PushContext(FString::Printf(TEXT("%s:%s"), *XlsxFile.FilePath, *WorksheetName));
 
 	if ((ImportType == EPMXlsxImportType::DataAsset && !DataAssetType.IsValid()) ||
@@ -307,10 +255,10 @@ void FPMXlsxImporterSettingsEntry::ParseData(FPMXlsxImporterContextLogger& InOut
 		return;
 	}
 
-	UPMXlsxImporterPythonBridge* PythonBridge = UPMXlsxImporterPythonBridge::Get(&InOutErrors);
-	if (PythonBridge == nullptr)
+	IPMXlsxImporterReader* Reader = IPMXlsxImporterReader::Get(&InOutErrors);
+	if (Reader == nullptr)
 	{
-		return; // UPMXlsxImporterPythonBridge::Get() logs an error when it returns null
+		return; // IPMXlsxImporterReader::Get() logs an error when it returns null
 	}
 
 	const UStruct* Struct = GetReflectionStruct(InOutErrors);
@@ -330,48 +278,128 @@ void FPMXlsxImporterSettingsEntry::ParseData(FPMXlsxImporterContextLogger& InOut
 	FPMXlsxWorksheetTypeInfo WorksheetTypeInfo;
 	WorksheetTypeInfo.ReadStruct(Struct);
 
-	const UPMXlsxImporterSettings* ImporterSettings = GetDefault<UPMXlsxImporterSettings>();
-	check(ImporterSettings);
-
-	const FPMXlsxImporterPythonBridgeJsonString JSONData = PythonBridge->ReadWorksheetAsJson(XlsxAbsolutePath, WorksheetName,
-		ImporterSettings->XlsxHeaderRow, ImporterSettings->XlsxDataStartRow, WorksheetTypeInfo);
-	if (!JSONData.Error.IsEmpty())
+	// Rows are decoded or parsed one at a time, the worksheet is never turned into a json DOM as a whole.
+	// During an import run the data was usually read and decoded on worker threads while the previous entries were imported.
+	FPMXlsxImporterRunContext* RunContext = FPMXlsxImporterRunContext::Get();
+	TSharedPtr<const FPMXlsxWorksheetData> DecodedWorksheetData;
 	{
-		InOutErrors.Logf(TEXT("%s"), *JSONData.Error);
-		return;
-	}
-	if (JSONData.JsonString.IsEmpty())
-	{
-		InOutErrors.Log(TEXT("Could not parse data: json data is empty."));
-		return;
-	}
+		FString ReadError;
+		if (!RunContext || !RunContext->TakeDecodedWorksheet(XlsxAbsolutePath, WorksheetName, Struct, DecodedWorksheetData, ReadError))
+		{
+			const FPMXlsxImporterPythonBridgeJsonString JSONData = ReadJson(*Reader, XlsxAbsolutePath, WorksheetTypeInfo);
+			if (RunContext)
+			{
+				RunContext->GetStats().AddBytes(JSONData.JsonString.Len() + JSONData.BinaryData.Len());
+				RunContext->WriteJsonDebugDump(XlsxAbsolutePath, WorksheetName, JSONData);
+			}
 
-	TArray< TSharedPtr<FJsonValue> > ParsedTableRows;
-	{
-		const TSharedRef< TJsonReader<TCHAR> > JsonReader = TJsonReaderFactory<TCHAR>::Create(JSONData.JsonString);
-		if (!FJsonSerializer::Deserialize(JsonReader, ParsedTableRows) || ParsedTableRows.Num() == 0)
+			PMXLSX_IMPORT_STAGE_SCOPE(Decode);
+			TSharedPtr<FPMXlsxWorksheetData> NewWorksheetData;
+			FPMXlsxImporterRunContext::DecodeWorksheet(JSONData, NewWorksheetData, ReadError);
+			DecodedWorksheetData = NewWorksheetData;
+		}
+
+		if (!DecodedWorksheetData.IsValid())
 		{
-			InOutErrors.Log(FString::Printf(TEXT("Failed to parse the JSON data. Error: %s"), *JsonReader->GetErrorMessage()));
+			InOutErrors.Log(ReadError);
 			return;
 		}
 	}
+	const FPMXlsxWorksheetData& WorksheetData = *DecodedWorksheetData;
+	if (RunContext)
+	{
+		RunContext->GetStats().AddRows(WorksheetData.Num());
+	}
 	
 	if (ImportType == EPMXlsxImportType::DataAsset)
 	{
+		const IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+		const FString SchemaFingerprint = WorksheetTypeInfo.MakeSchemaFingerprint();
+		int32 NumUnchangedRows = 0;
+
+		// With bParallelParseData, rows are converted on worker threads into staged rows, a batch at a time so that only one batch
+		// is held in memory. Each batch is then committed to its assets in row order on this thread.
+		const bool bParallelParseData = GetDefault<UPMXlsxImporterSettings>()->bParallelParseData;
+		constexpr int32 ParallelBatchSize = 1024;
+		struct FStagedImport
+		{
+			int32 RowIdx = 0;
+			UPMXlsxDataAsset* Asset = nullptr;
+			TSharedPtr<const FPMXlsxColumnBindings> ColumnBindings;
+			FString RowHash;
+			FPMXlsxDataAssetStagedRow Row;
+			FPMXlsxImporterStageTimes StageTimes;
+		};
+		TArray<FStagedImport> StagedImports;
+		// Returns false if the import should stop
+		const auto ImportStagedRows = [&]()
+		{
+			ParallelFor(StagedImports.Num(), [&StagedImports, &WorksheetData](int32 Index)
+			{
+				FStagedImport& StagedImport = StagedImports[Index];
+				const FPMXlsxImporterStageTimeCollector RowStageTimeCollector(StagedImport.StageTimes);
+				StagedImport.Row.Read(*StagedImport.Asset, WorksheetData, StagedImport.RowIdx, *StagedImport.ColumnBindings);
+			});
+
+			FPMXlsxImporterStageTimes* const BatchStageTimes = FPMXlsxImporterStageTimeCollector::GetTimes();
+			for (const FStagedImport& StagedImport : StagedImports)
+			{
+				BatchStageTimes->Add(StagedImport.StageTimes);
+			}
+
+			for (const FStagedImport& StagedImport : StagedImports)
+			{
+				auto ScopedErrorOrder = InOutErrors.PushOrder(StagedImport.RowIdx);
+				StagedImport.Asset->ImportFromStagedRow(StagedImport.Row, InOutErrors, StagedImport.RowHash);
+
+				if (InOutErrors.Num() >= MaxErrors)
+				{
+					return false;
+				}
+			}
+			StagedImports.Reset();
+			return true;
+		};
+
+		// Classes that support parallel import don't override how rows are read, so their rows are read straight from the worksheet data
+		// by column index, on worker threads or on this thread, instead of being made into json objects first.
+		// The column bindings are made once per class and kept while consecutive rows have assets of that class.
+		const int32 NameColumn = WorksheetData.FindColumn(TEXT("Name"));
+		const UClass* ColumnBindingsClass = nullptr;
+		TSharedPtr<const FPMXlsxColumnBindings> ColumnBindings;
+		FPMXlsxDataAssetStagedRow StagedRow;
+
 		// Iterate over rows
-		for (int32 RowIdx = 0; RowIdx < ParsedTableRows.Num(); ++RowIdx)
+		for (int32 RowIdx = 0; RowIdx < WorksheetData.Num(); ++RowIdx)
 		{
-			const TSharedPtr<FJsonValue>& ParsedTableRowValue = ParsedTableRows[RowIdx];
-			TSharedPtr<FJsonObject> ParsedTableRowObject = ParsedTableRowValue->AsObject();
-			if (!ParsedTableRowObject.IsValid())
+			auto ScopedErrorOrder = InOutErrors.PushOrder(RowIdx);
+
+			FString AssetNameString;
+			if (!WorksheetData.TryGetRowString(RowIdx, NameColumn, AssetNameString))
 			{
-				InOutErrors.Log(FString::Printf(TEXT("Row '%d' is not a valid JSON object."), RowIdx));
+				InOutErrors.Logf(TEXT("Row '%d' has no Name."), RowIdx);
 				continue;
 			}
-			
-			const FName AssetName = DataTableUtils::MakeValidName(ParsedTableRowObject->GetStringField(TEXT("Name")));
+
+			const FName AssetName = DataTableUtils::MakeValidName(AssetNameString);
 			
 			FString AssetPath = GetProjectRootOutputPath(AssetName.ToString());
+
+			// Rows that did not change since their asset was last imported don't need to be loaded, imported or diffed.
+			// Only the saved hash counts, and only while the asset has no unsaved changes: an asset modified by a run that failed
+			// holds other values than the saved ones even if its row was reverted to match the saved hash since.
+			const FString RowHash = WorksheetData.ComputeRowHash(RowIdx, SchemaFingerprint);
+			const FAssetData AssetData = AssetRegistry.GetAssetByObjectPath(FName(AssetPath + TEXT(".") + AssetName.ToString()), /*bIncludeOnlyOnDiskAssets:*/ true);
+			const UPackage* LoadedPackage = FindObject<UPackage>(nullptr, *AssetPath);
+			FString AssetRowHash;
+			if ((LoadedPackage == nullptr || !LoadedPackage->IsDirty()) && AssetData.IsValid() &&
+				AssetData.GetTagValue(GET_MEMBER_NAME_CHECKED(UPMXlsxDataAsset, XlsxRowHash), AssetRowHash) &&
+				AssetRowHash.Equals(RowHash, ESearchCase::CaseSensitive))
+			{
+				++NumUnchangedRows;
+				continue;
+			}
+
 			UPMXlsxDataAsset* Asset = Cast<UPMXlsxDataAsset>(UEditorAssetLibrary::LoadAsset(AssetPath));
 			if (Asset == nullptr)
 			{
@@ -379,13 +407,70 @@ void FPMXlsxImporterSettingsEntry::ParseData(FPMXlsxImporterContextLogger& InOut
 				continue;
 			}
 
-			Asset->ImportFromXLSX(ParsedTableRowObject.ToSharedRef(), InOutErrors);
+			const bool bReadColumns = Asset->SupportsParallelImport();
+			if (bReadColumns && ColumnBindingsClass != Asset->GetClass())
+			{
+				ColumnBindingsClass = Asset->GetClass();
+				ColumnBindings = FPMXlsxDataAssetImporterJSON::PrepareColumnBindings(ColumnBindingsClass, WorksheetData, TEXT("Name"));
+			}
+
+			if (bParallelParseData)
+			{
+				if (Asset->CanImportInParallel())
+				{
+					FStagedImport& StagedImport = StagedImports.AddDefaulted_GetRef();
+					StagedImport.RowIdx = RowIdx;
+					StagedImport.Asset = Asset;
+					StagedImport.ColumnBindings = ColumnBindings;
+					StagedImport.RowHash = RowHash;
+					if (StagedImports.Num() >= ParallelBatchSize && !ImportStagedRows())
+					{
+						return;
+					}
+					continue;
+				}
+
+				// Keep the rows in order: commit what's staged before importing this one on this thread
+				if (!ImportStagedRows())
+				{
+					return;
+				}
+			}
+
+			if (bReadColumns)
+			{
+				StagedRow.Read(*Asset, WorksheetData, RowIdx, *ColumnBindings);
+				Asset->ImportFromStagedRow(StagedRow, InOutErrors, RowHash);
+			}
+			else
+			{
+				FString RowError;
+				TSharedPtr<FJsonObject> ParsedTableRowObject;
+				{
+					PMXLSX_IMPORT_STAGE_SCOPE(Decode);
+					ParsedTableRowObject = WorksheetData.MakeRowObject(RowIdx, RowError);
+				}
+				if (!ParsedTableRowObject.IsValid())
+				{
+					InOutErrors.Log(RowError);
+					continue;
+				}
+
+				Asset->ImportFromXLSX(ParsedTableRowObject.ToSharedRef(), InOutErrors, RowHash);
+			}
 
 			if (InOutErrors.Num() >= MaxErrors)
 			{
 				return;
 			}
 		}
+
+		if (!ImportStagedRows())
+		{
+			return;
+		}
+
+		UE_LOG(LogPMXlsxImporter, Log, TEXT("%s:%s: skipped %i of %i rows that did not change"), *XlsxFile.FilePath, *WorksheetName, NumUnchangedRows, WorksheetData.Num());
 	}
 	else
 	{
@@ -397,12 +482,13 @@ void FPMXlsxImporterSettingsEntry::ParseData(FPMXlsxImporterContextLogger& InOut
 			return;
 		}
 
-		FPMXlsxDataTableImportUtils::ImportDataTableFromXlsx(DataTable, JSONData.JsonString, InOutErrors);
+		FPMXlsxDataTableImportUtils::ImportDataTableFromXlsx(DataTable, WorksheetData, InOutErrors);
 	}
 }
 
 void FPMXlsxImporterSettingsEntry::Validate(FPMXlsxImporterContextLogger& InOutErrors, int32 MaxErrors) const
 {
+	PMXLSX_IMPORT_STAGE_SCOPE(Validate);
 	auto ScopedErrorContext = InOutErrors.PushContext(FString::Printf(TEXT("%s:%s"), *XlsxFile.FilePath, *WorksheetName));
 
 	{
@@ -435,17 +521,13 @@ void FPMXlsxImporterSettingsEntry::Validate(FPMXlsxImporterContextLogger& InOutE
 		return;
 	}
 
-	UPMXlsxImporterPythonBridge* PythonBridge = UPMXlsxImporterPythonBridge::Get(&InOutErrors);
-	if (PythonBridge == nullptr)
+	IPMXlsxImporterReader* Reader = IPMXlsxImporterReader::Get(&InOutErrors);
+	if (Reader == nullptr)
 	{
-		return; // UPMXlsxImporterPythonBridge::Get() logs an error when it returns null
+		return; // IPMXlsxImporterReader::Get() logs an error when it returns null
 	}
 
-	const UPMXlsxImporterSettings* ImporterSettings = GetDefault<UPMXlsxImporterSettings>();
-	check(ImporterSettings);
-
-	FPMXlsxImporterPythonBridgeAssetNames AssetNames = PythonBridge->ReadWorksheetAssetNames(XlsxAbsolutePath, WorksheetName,
-		ImporterSettings->XlsxHeaderRow, ImporterSettings->XlsxDataStartRow);
+	FPMXlsxImporterPythonBridgeAssetNames AssetNames = ReadAssetNames(*Reader, XlsxAbsolutePath);
 	if (!AssetNames.Error.IsEmpty())
 	{
 		InOutErrors.Logf(TEXT("Could not validate assets: could not read asset names from worksheet:\n%s"), *AssetNames.Error);
@@ -473,6 +555,57 @@ void FPMXlsxImporterSettingsEntry::Validate(FPMXlsxImporterContextLogger& InOutE
 	}
 }
 
+bool FPMXlsxImporterSettingsEntry::MakeWorksheetRequest(FString& OutXlsxAbsolutePath, FPMXlsxImporterPythonBridgeWorksheetRequest& OutRequest) const
+{
+	OutXlsxAbsolutePath = GetXlsxAbsolutePath();
+	if (OutXlsxAbsolutePath.IsEmpty() || WorksheetName.IsEmpty())
+	{
+		return false;
+	}
+
+	FPMXlsxImporterContextLogger IgnoredErrors; // Logged again by ParseData
+	const UStruct* Struct = GetReflectionStruct(IgnoredErrors);
+	if (Struct == nullptr)
+	{
+		return false;
+	}
+
+	const UPMXlsxImporterSettings* ImporterSettings = GetDefault<UPMXlsxImporterSettings>();
+	check(ImporterSettings);
+
+	OutRequest.WorksheetName = WorksheetName;
+	OutRequest.HeaderRow = ImporterSettings->XlsxHeaderRow;
+	OutRequest.DataStartRow = ImporterSettings->XlsxDataStartRow;
+	OutRequest.WorksheetTypeInfo.ReadStruct(Struct);
+	OutRequest.bUseJson = ImporterSettings->bUseJsonInterchange;
+	return true;
+}
+
+FPMXlsxImporterPythonBridgeAssetNames FPMXlsxImporterSettingsEntry::ReadAssetNames(IPMXlsxImporterReader& Reader, const FString& XlsxAbsolutePath) const
+{
+	FPMXlsxImporterRunContext* RunContext = FPMXlsxImporterRunContext::Get();
+	const FPMXlsxImporterPythonBridgeAssetNames* Prefetched = RunContext ? RunContext->FindPrefetchedAssetNames(XlsxAbsolutePath, WorksheetName) : nullptr;
+	if (Prefetched)
+	{
+		return *Prefetched;
+	}
+
+	const UPMXlsxImporterSettings* ImporterSettings = GetDefault<UPMXlsxImporterSettings>();
+	check(ImporterSettings);
+
+	PMXLSX_IMPORT_STAGE_SCOPE(Read);
+	return Reader.ReadWorksheetAssetNames(XlsxAbsolutePath, WorksheetName, ImporterSettings->XlsxHeaderRow, ImporterSettings->XlsxDataStartRow);
+}
+
+FPMXlsxImporterPythonBridgeJsonString FPMXlsxImporterSettingsEntry::ReadJson(IPMXlsxImporterReader& Reader, const FString& XlsxAbsolutePath, const FPMXlsxWorksheetTypeInfo& WorksheetTypeInfo) const
+{
+	const UPMXlsxImporterSettings* ImporterSettings = GetDefault<UPMXlsxImporterSettings>();
+	check(ImporterSettings);
+
+	PMXLSX_IMPORT_STAGE_SCOPE(Read);
+	return Reader.ReadWorksheetAsJson(XlsxAbsolutePath, WorksheetName, ImporterSettings->XlsxHeaderRow, ImporterSettings->XlsxDataStartRow, WorksheetTypeInfo);
+}
+
 FSourceControlState FPMXlsxImporterSettingsEntry::GetXlsxFileSourceControlState(bool bSilent /* = false*/) const
 {
 	return USourceControlHelpers::QueryFileState(GetXlsxAbsolutePath(), bSilent);
@@ -541,16 +674,29 @@ UStruct* FPMXlsxImporterSettingsEntry::GetReflectionStruct(FPMXlsxImporterContex
 	return nullptr;
 }
 
-bool FPMXlsxImporterSettingsEntry::ShouldAssetExist(const FString& AssetPath, const TArray<FString>& AssetNames) const
+TMap<FString, FString> FPMXlsxImporterSettingsEntry::ListOutputDirAssets() const
 {
-	for (const FString& AssetName : AssetNames)
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+
+	FString OutputDirPath = GetProjectRootOutputDir();
+	OutputDirPath.RemoveFromEnd(TEXT("/"));
+
+	// The registry may still be discovering assets, e.g. right after the editor or a commandlet started
+	if (AssetRegistry.IsLoadingAssets())
 	{
-		if (AssetPath.EndsWith(FString::Printf(TEXT(".%s"), *AssetName)))
-		{
-			return true;
-		}
+		AssetRegistry.ScanPathsSynchronous({ OutputDirPath });
+	}
+
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssetsByPath(FName(*OutputDirPath), Assets, /*bRecursive:*/ false);
+
+	TMap<FString, FString> AssetPaths;
+	AssetPaths.Reserve(Assets.Num());
+	for (const FAssetData& Asset : Assets)
+	{
+		AssetPaths.Add(Asset.AssetName.ToString(), FString::Printf(TEXT("%s.%s"), *Asset.PackageName.ToString(), *Asset.AssetName.ToString()));
 	}
-	return false;
+	return AssetPaths;
 }
 
 FString FPMXlsxImporterSettingsEntry::GetDataTableName() const
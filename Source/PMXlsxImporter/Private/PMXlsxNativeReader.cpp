@@ -0,0 +1,1566 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+
+#include "PMXlsxNativeReader.h"
+
+#include "PMXlsxImporterLog.h"
+#include "PMXlsxWorksheetData.h"
+#include "PMXlsxXmlReader.h"
+#include "Algo/Reverse.h"
+#include "Dom/JsonObject.h"
+#include "Dom/JsonValue.h"
+#include "Misc/DefaultValueHelper.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace
+{
+	const FPMXlsxCell EmptyCell;
+
+	const FPMXlsxCell& GetCell(const FPMXlsxRow& Row, int32 ColumnIndex)
+	{
+		return Row.IsValidIndex(ColumnIndex) ? Row[ColumnIndex] : EmptyCell;
+	}
+
+	// Python's str.isspace(): true for strings that are not empty and only contain whitespace
+	bool IsWhitespaceOnly(const FString& Value)
+	{
+		if (Value.IsEmpty())
+		{
+			return false;
+		}
+
+		for (const TCHAR Char : Value)
+		{
+			if (!FChar::IsWhitespace(Char))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Converts the letters of a cell reference like "AB12" to a 0-based column index
+	int32 CellReferenceToColumnIndex(const ANSICHAR* Reference, int32 Len)
+	{
+		int32 Column = 0;
+		for (int32 Index = 0; Index < Len && FCharAnsi::IsAlpha(Reference[Index]); ++Index)
+		{
+			Column = Column * 26 + (FCharAnsi::ToUpper(Reference[Index]) - 'A' + 1);
+		}
+		return Column - 1;
+	}
+
+	int32 ParseRowReference(const ANSICHAR* Reference, int32 Len)
+	{
+		int32 Row = 0;
+		for (int32 Index = 0; Index < Len && FCharAnsi::IsDigit(Reference[Index]); ++Index)
+		{
+			Row = Row * 10 + (Reference[Index] - '0');
+		}
+		return Row;
+	}
+
+	// Converts a 0-based column index to its Excel name, like xl_col_to_name in pm_xlsx_field_parser.py
+	FString ColumnIndexToName(int32 ColumnIndex)
+	{
+		FString Name;
+		for (int32 Column = ColumnIndex + 1; Column > 0; Column = (Column - 1) / 26)
+		{
+			Name.InsertAt(0, (TCHAR)(TEXT('A') + (Column - 1) % 26));
+		}
+		return Name;
+	}
+
+	struct FRelationship
+	{
+		FString Id;
+		FString Type;
+		FString Target;
+	};
+
+	bool ReadRelationships(const FPMXlsxZipReader& Archive, const FString& EntryName, TArray<FRelationship>& OutRelationships, FString& OutError)
+	{
+		if (!Archive.Contains(EntryName))
+		{
+			return true; // Relationships are optional
+		}
+
+		TArray<uint8> Data;
+		if (!Archive.ReadEntry(EntryName, Data, OutError))
+		{
+			return false;
+		}
+
+		FPMXlsxXmlReader Xml(Data.GetData(), Data.Num());
+		while (Xml.Next())
+		{
+			if (Xml.IsStartElement("Relationship"))
+			{
+				FRelationship& Relationship = OutRelationships.AddDefaulted_GetRef();
+				Xml.GetAttribute("Id", Relationship.Id);
+				Xml.GetAttribute("Type", Relationship.Type);
+				Xml.GetAttribute("Target", Relationship.Target);
+			}
+		}
+
+		if (!Xml.GetError().IsEmpty())
+		{
+			OutError = FString::Printf(TEXT("%s: %s"), *EntryName, *Xml.GetError());
+			return false;
+		}
+		return true;
+	}
+
+	// Relationship targets are relative to the directory of the part that owns the relationship, unless they start with '/'
+	FString ResolvePartPath(const FString& OwnerDirectory, const FString& Target)
+	{
+		if (Target.StartsWith(TEXT("/")))
+		{
+			return Target.RightChop(1);
+		}
+
+		FString Path = OwnerDirectory.IsEmpty() ? Target : OwnerDirectory / Target;
+		FPaths::CollapseRelativeDirectories(Path);
+		return Path;
+	}
+
+	// Reads the text of a shared string <si> or inline string <is>, which is either a single <t> or several rich text runs
+	void ReadStringItem(FPMXlsxXmlReader& Xml, const ANSICHAR* ItemElement, FString& OutString)
+	{
+		while (Xml.Next() && !Xml.IsEndElement(ItemElement))
+		{
+			if (Xml.IsStartElement("rPh"))
+			{
+				Xml.SkipElement(); // Phonetic hints are not part of the string
+			}
+			else if (Xml.IsStartElement("t"))
+			{
+				while (Xml.Next() && !Xml.IsEndElement("t"))
+				{
+					Xml.AppendText(OutString);
+				}
+			}
+		}
+	}
+
+	struct FValidationError
+	{
+		FString Message;
+		int32 ColumnIndex = INDEX_NONE;
+		int32 RowIndex = INDEX_NONE;
+
+		// Same format as ValidationError.__str__ in pm_xlsx_field_parser.py
+		FString ToString(const FString& FileName, const FString& WorksheetName) const
+		{
+			if (RowIndex != INDEX_NONE && ColumnIndex != INDEX_NONE)
+			{
+				return FString::Printf(TEXT("%s:%s-[%i:%s]: %s"), *FileName, *WorksheetName, RowIndex, *ColumnIndexToName(ColumnIndex), *Message);
+			}
+			else if (RowIndex != INDEX_NONE)
+			{
+				return FString::Printf(TEXT("%s:%s-[%i:?]: %s"), *FileName, *WorksheetName, RowIndex, *Message);
+			}
+			return FString::Printf(TEXT("%s:%s: %s"), *FileName, *WorksheetName, *Message);
+		}
+	};
+
+	bool SetError(FValidationError& OutError, int32 ColumnIndex, const FString& Message)
+	{
+		OutError.Message = Message;
+		OutError.ColumnIndex = ColumnIndex;
+		return false;
+	}
+
+	FString CellToString(const FPMXlsxCell& Cell)
+	{
+		switch (Cell.Type)
+		{
+		case EPMXlsxCellType::Empty:
+			return TEXT("None");
+		case EPMXlsxCellType::Bool:
+			return Cell.Value == TEXT("1") ? TEXT("True") : TEXT("False");
+		default:
+			return Cell.Value;
+		}
+	}
+
+	// The value openpyxl would return for this cell
+	TSharedPtr<FJsonValue> CellToJsonValue(const FPMXlsxCell& Cell)
+	{
+		switch (Cell.Type)
+		{
+		case EPMXlsxCellType::Empty:
+			return MakeShared<FJsonValueNull>();
+		case EPMXlsxCellType::Number:
+			return MakeShared<FJsonValueNumber>(FCString::Atod(*Cell.Value));
+		case EPMXlsxCellType::Bool:
+			return MakeShared<FJsonValueBoolean>(Cell.Value == TEXT("1"));
+		default:
+			return MakeShared<FJsonValueString>(Cell.Value);
+		}
+	}
+
+	bool ParseCellAsDouble(const FPMXlsxCell& Cell, double& OutValue)
+	{
+		switch (Cell.Type)
+		{
+		case EPMXlsxCellType::Number:
+			OutValue = FCString::Atod(*Cell.Value);
+			return true;
+		case EPMXlsxCellType::Bool:
+			OutValue = Cell.Value == TEXT("1") ? 1.0 : 0.0;
+			return true;
+		case EPMXlsxCellType::String:
+			return FDefaultValueHelper::ParseDouble(Cell.Value.TrimStartAndEnd(), OutValue);
+		default:
+			return false;
+		}
+	}
+
+	bool ParseCellAsInt(const FPMXlsxCell& Cell, int64& OutValue)
+	{
+		switch (Cell.Type)
+		{
+		case EPMXlsxCellType::Number:
+			// Python's int() truncates floats, so numeric cells like 2.5 become 2
+			if (Cell.Value.Contains(TEXT(".")) || Cell.Value.Contains(TEXT("e")))
+			{
+				OutValue = (int64)FCString::Atod(*Cell.Value);
+			}
+			else
+			{
+				OutValue = FCString::Atoi64(*Cell.Value);
+			}
+			return true;
+		case EPMXlsxCellType::Bool:
+			OutValue = Cell.Value == TEXT("1") ? 1 : 0;
+			return true;
+		case EPMXlsxCellType::String:
+			return FDefaultValueHelper::ParseInt64(Cell.Value.TrimStartAndEnd(), OutValue);
+		default:
+			return false;
+		}
+	}
+
+	bool IsJsonNumber(const FString& Value)
+	{
+		int32 Index = 0;
+		const int32 Len = Value.Len();
+		auto SkipDigits = [&Value, &Index, Len]()
+		{
+			const int32 Start = Index;
+			while (Index < Len && FChar::IsDigit(Value[Index]))
+			{
+				++Index;
+			}
+			return Index > Start;
+		};
+
+		if (Index < Len && Value[Index] == TEXT('-'))
+		{
+			++Index;
+		}
+		if (!SkipDigits())
+		{
+			return false;
+		}
+		if (Index < Len && Value[Index] == TEXT('.'))
+		{
+			++Index;
+			if (!SkipDigits())
+			{
+				return false;
+			}
+		}
+		if (Index < Len && (Value[Index] == TEXT('e') || Value[Index] == TEXT('E')))
+		{
+			++Index;
+			if (Index < Len && (Value[Index] == TEXT('+') || Value[Index] == TEXT('-')))
+			{
+				++Index;
+			}
+			if (!SkipDigits())
+			{
+				return false;
+			}
+		}
+		return Index == Len;
+	}
+
+	// Parses the relaxed json that pm_xlsx_field_parser.py reads from a single cell with hjson:
+	// keys and strings may be unquoted and trailing commas are allowed.
+	class FLooseJsonParser
+	{
+	public:
+		explicit FLooseJsonParser(const FString& InText)
+			: Text(InText)
+		{
+		}
+
+		// Returns nullptr if Text is not valid
+		TSharedPtr<FJsonValue> Parse()
+		{
+			TSharedPtr<FJsonValue> Value = ParseValue();
+			SkipWhitespace();
+			return Pos == Text.Len() ? Value : nullptr;
+		}
+
+	private:
+		TSharedPtr<FJsonValue> ParseValue()
+		{
+			SkipWhitespace();
+			if (Pos >= Text.Len())
+			{
+				return nullptr;
+			}
+
+			const TCHAR Char = Text[Pos];
+			if (Char == TEXT('{'))
+			{
+				return ParseObject();
+			}
+			if (Char == TEXT('['))
+			{
+				return ParseArray();
+			}
+			if (Char == TEXT('"') || Char == TEXT('\''))
+			{
+				FString String;
+				return ParseQuotedString(String) ? MakeShared<FJsonValueString>(String) : TSharedPtr<FJsonValue>();
+			}
+			return ParseQuotelessValue();
+		}
+
+		TSharedPtr<FJsonValue> ParseObject()
+		{
+			++Pos; // '{'
+			TSharedRef<FJsonObject> Object = MakeShared<FJsonObject>();
+			for (;;)
+			{
+				SkipWhitespace();
+				if (Pos >= Text.Len())
+				{
+					return nullptr;
+				}
+				if (Text[Pos] == TEXT('}'))
+				{
+					++Pos;
+					return MakeShared<FJsonValueObject>(Object);
+				}
+
+				FString Key;
+				if (Text[Pos] == TEXT('"') || Text[Pos] == TEXT('\''))
+				{
+					if (!ParseQuotedString(Key))
+					{
+						return nullptr;
+					}
+				}
+				else
+				{
+					const int32 KeyStart = Pos;
+					while (Pos < Text.Len() && Text[Pos] != TEXT(':'))
+					{
+						++Pos;
+					}
+					Key = Text.Mid(KeyStart, Pos - KeyStart).TrimStartAndEnd();
+				}
+
+				SkipWhitespace();
+				if (Pos >= Text.Len() || Text[Pos] != TEXT(':') || Key.IsEmpty())
+				{
+					return nullptr;
+				}
+				++Pos;
+
+				TSharedPtr<FJsonValue> Value = ParseValue();
+				if (!Value.IsValid())
+				{
+					return nullptr;
+				}
+				Object->SetField(Key, Value);
+
+				SkipSeparator();
+			}
+		}
+
+		TSharedPtr<FJsonValue> ParseArray()
+		{
+			++Pos; // '['
+			TArray<TSharedPtr<FJsonValue>> Elements;
+			for (;;)
+			{
+				SkipWhitespace();
+				if (Pos >= Text.Len())
+				{
+					return nullptr;
+				}
+				if (Text[Pos] == TEXT(']'))
+				{
+					++Pos;
+					return MakeShared<FJsonValueArray>(Elements);
+				}
+
+				TSharedPtr<FJsonValue> Value = ParseValue();
+				if (!Value.IsValid())
+				{
+					return nullptr;
+				}
+				Elements.Add(Value);
+
+				SkipSeparator();
+			}
+		}
+
+		bool ParseQuotedString(FString& OutString)
+		{
+			const TCHAR Quote = Text[Pos++];
+			while (Pos < Text.Len())
+			{
+				const TCHAR Char = Text[Pos++];
+				if (Char == Quote)
+				{
+					return true;
+				}
+
+				if (Char != TEXT('\\'))
+				{
+					OutString.AppendChar(Char);
+					continue;
+				}
+
+				if (Pos >= Text.Len())
+				{
+					return false;
+				}
+
+				const TCHAR Escaped = Text[Pos++];
+				switch (Escaped)
+				{
+				case TEXT('n'): OutString.AppendChar(TEXT('\n')); break;
+				case TEXT('r'): OutString.AppendChar(TEXT('\r')); break;
+				case TEXT('t'): OutString.AppendChar(TEXT('\t')); break;
+				case TEXT('b'): OutString.AppendChar(TEXT('\b')); break;
+				case TEXT('f'): OutString.AppendChar(TEXT('\f')); break;
+				case TEXT('u'):
+					if (Pos + 4 > Text.Len())
+					{
+						return false;
+					}
+					OutString.AppendChar((TCHAR)FParse::HexNumber(*Text.Mid(Pos, 4)));
+					Pos += 4;
+					break;
+				default:
+					OutString.AppendChar(Escaped);
+					break;
+				}
+			}
+			return false; // Unterminated string
+		}
+
+		// Quoteless values end at the next separator, closing bracket or line break
+		TSharedPtr<FJsonValue> ParseQuotelessValue()
+		{
+			const int32 Start = Pos;
+			while (Pos < Text.Len() && Text[Pos] != TEXT(',') && Text[Pos] != TEXT(']') && Text[Pos] != TEXT('}') &&
+				Text[Pos] != TEXT('\n') && Text[Pos] != TEXT('\r'))
+			{
+				++Pos;
+			}
+
+			const FString Value = Text.Mid(Start, Pos - Start).TrimStartAndEnd();
+			if (Value.IsEmpty())
+			{
+				return nullptr;
+			}
+			if (Value.Equals(TEXT("true"), ESearchCase::CaseSensitive))
+			{
+				return MakeShared<FJsonValueBoolean>(true);
+			}
+			if (Value.Equals(TEXT("false"), ESearchCase::CaseSensitive))
+			{
+				return MakeShared<FJsonValueBoolean>(false);
+			}
+			if (Value.Equals(TEXT("null"), ESearchCase::CaseSensitive))
+			{
+				return MakeShared<FJsonValueNull>();
+			}
+			if (IsJsonNumber(Value))
+			{
+				return MakeShared<FJsonValueNumber>(FCString::Atod(*Value));
+			}
+			return MakeShared<FJsonValueString>(Value);
+		}
+
+		void SkipWhitespace()
+		{
+			while (Pos < Text.Len() && FChar::IsWhitespace(Text[Pos]))
+			{
+				++Pos;
+			}
+		}
+
+		void SkipSeparator()
+		{
+			SkipWhitespace();
+			if (Pos < Text.Len() && Text[Pos] == TEXT(','))
+			{
+				++Pos;
+			}
+		}
+
+		const FString& Text;
+		int32 Pos = 0;
+	};
+
+	TSharedPtr<FJsonValue> ParseLooseJson(const FString& Text)
+	{
+		return FLooseJsonParser(Text).Parse();
+	}
+
+	class FFieldParser;
+	TUniquePtr<FFieldParser> CreateFieldParser(int32 FieldIndex, const FPMXlsxWorksheetTypeInfo& TypeInfo);
+
+	// C++ port of PMXlsxFieldParser in pm_xlsx_field_parser.py. Keep the two in sync.
+	class FFieldParser
+	{
+	public:
+		FFieldParser(int32 InFieldIndex, const FPMXlsxWorksheetTypeInfo& InTypeInfo)
+			: FieldIndex(InFieldIndex)
+			, TypeInfo(InTypeInfo)
+		{
+		}
+
+		virtual ~FFieldParser()
+		{
+		}
+
+		const FPMXlsxFieldTypeInfo& GetField() const
+		{
+			return TypeInfo.AllFields[FieldIndex];
+		}
+
+		const FString& GetFieldName() const
+		{
+			return GetField().NameCPP;
+		}
+
+		// Determines how many columns this field occupies and validates their names.
+		// Returns the end column index, or INDEX_NONE if the header is not valid.
+		virtual int32 ParseHeaderRow(const FPMXlsxRow& HeaderRow, int32 InStartColumnIndex, int32 ArrayIndex, FValidationError& OutError)
+		{
+			if (!ValidateColumnName(HeaderRow, InStartColumnIndex, ArrayIndex, OutError))
+			{
+				return INDEX_NONE;
+			}
+
+			StartColumnIndex = InStartColumnIndex;
+			EndColumnIndex = InStartColumnIndex + 1; // ordinary types only occupy one column
+			return EndColumnIndex;
+		}
+
+		// Returns nullptr if the data is not valid
+		virtual TSharedPtr<FJsonValue> ParseDataRow(const FPMXlsxRow& DataRow, FValidationError& OutError) const
+		{
+			return ParseDataCell(DataRow, StartColumnIndex, OutError);
+		}
+
+		bool IsDataRowEmpty(const FPMXlsxRow& DataRow) const
+		{
+			for (int32 ColumnIndex = StartColumnIndex; ColumnIndex < EndColumnIndex; ++ColumnIndex)
+			{
+				if (!GetCell(DataRow, ColumnIndex).IsBlank())
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		int32 StartColumnIndex = INDEX_NONE;
+		int32 EndColumnIndex = INDEX_NONE;
+
+	protected:
+		// ArrayIndex >= 0 is the [index] the column name must have, -1 means the column name has no []
+		bool ValidateColumnName(const FPMXlsxRow& HeaderRow, int32 ColumnIndex, int32 ArrayIndex, FValidationError& OutError) const
+		{
+			if (ColumnIndex >= HeaderRow.Num())
+			{
+				return SetError(OutError, ColumnIndex, FString::Printf(TEXT("missing field \"%s\" in header row"), *GetFieldName()));
+			}
+
+			const FPMXlsxCell& Cell = HeaderRow[ColumnIndex];
+			if (Cell.IsBlank())
+			{
+				return SetError(OutError, ColumnIndex, TEXT("column name is empty"));
+			}
+
+			const FString& ColumnName = Cell.Value;
+			TArray<FString> ColumnParts;
+			ColumnName.ParseIntoArray(ColumnParts, TEXT("."), /*bCullEmpty:*/ false);
+			Algo::Reverse(ColumnParts);
+
+			// Walk from this field up through its parents. The Name field (index 0) is never validated.
+			int32 CurrentFieldIndex = FieldIndex;
+			int32 ColumnPartIndex = 0;
+			while (CurrentFieldIndex > 0)
+			{
+				const FPMXlsxFieldTypeInfo& Field = TypeInfo.AllFields[CurrentFieldIndex];
+				if (!ColumnParts.IsValidIndex(ColumnPartIndex))
+				{
+					return SetError(OutError, ColumnIndex, FString::Printf(TEXT("column name %s is the same with cpp name, one or more fields are missing"), *ColumnName));
+				}
+
+				const FString ColumnPart = ColumnParts[ColumnPartIndex].TrimStartAndEnd();
+				FString FieldNameText = ColumnPart;
+				if (Field.Type == EPMXlsxFieldType::Array)
+				{
+					const int32 LeftBracketIndex = ColumnPart.Find(TEXT("["), ESearchCase::CaseSensitive);
+					const bool bHasArrayIndex = LeftBracketIndex > 0;
+					if (bHasArrayIndex && ArrayIndex < 0)
+					{
+						return SetError(OutError, ColumnIndex, FString::Printf(TEXT("unexpected [ in column name %s, inconsistent with array's first column"), *ColumnName));
+					}
+					if (!bHasArrayIndex && ArrayIndex >= 0)
+					{
+						return SetError(OutError, ColumnIndex, FString::Printf(TEXT("missing [ in column name %s"), *ColumnName));
+					}
+
+					if (bHasArrayIndex)
+					{
+						if (!ColumnPart.EndsWith(TEXT("]"), ESearchCase::CaseSensitive))
+						{
+							return SetError(OutError, ColumnIndex, FString::Printf(TEXT("missing ] in column name %s"), *ColumnName));
+						}
+
+						const FString ArrayIndexText = ColumnPart.Mid(LeftBracketIndex + 1, ColumnPart.Len() - LeftBracketIndex - 2).TrimStartAndEnd();
+						int32 ColumnArrayIndex = INDEX_NONE;
+						if (!FDefaultValueHelper::ParseInt(ArrayIndexText, ColumnArrayIndex))
+						{
+							return SetError(OutError, ColumnIndex, FString::Printf(TEXT("array index in %s is not a valid number"), *ColumnName));
+						}
+						if (ColumnArrayIndex != ArrayIndex)
+						{
+							return SetError(OutError, ColumnIndex, FString::Printf(TEXT("array index in %s is wrong, expect %i got %s"), *ColumnName, ArrayIndex, *ArrayIndexText));
+						}
+
+						FieldNameText = ColumnPart.Left(LeftBracketIndex).TrimStartAndEnd();
+					}
+				}
+
+				if (!FieldNameText.Equals(Field.NameCPP, ESearchCase::CaseSensitive))
+				{
+					return SetError(OutError, ColumnIndex, FString::Printf(TEXT("column name %s is not the same with cpp name, expect %s got %s"), *ColumnName, *Field.NameCPP, *FieldNameText));
+				}
+
+				CurrentFieldIndex = Field.ParentIndex;
+				++ColumnPartIndex;
+			}
+			return true;
+		}
+
+		TSharedPtr<FJsonValue> ParseDataCell(const FPMXlsxRow& DataRow, int32 ColumnIndex, FValidationError& OutError) const
+		{
+			const FPMXlsxCell& Cell = GetCell(DataRow, ColumnIndex);
+			const FPMXlsxFieldTypeInfo& Field = GetField();
+
+			EPMXlsxFieldType FieldType = Field.Type;
+			const FString* FieldCPPType = &Field.CPPType;
+			if (FieldType == EPMXlsxFieldType::Array)
+			{
+				FieldType = Field.Element_Type;
+				FieldCPPType = &Field.Element_CPPType;
+			}
+
+			auto InvalidValue = [&]()
+			{
+				SetError(OutError, ColumnIndex, FString::Printf(TEXT("value %s is not a valid %s"), *CellToString(Cell), **FieldCPPType));
+				return TSharedPtr<FJsonValue>();
+			};
+
+			switch (FieldType)
+			{
+			case EPMXlsxFieldType::Numeric:
+				if (*FieldCPPType == TEXT("float") || *FieldCPPType == TEXT("double"))
+				{
+					double Value = 0.0;
+					return ParseCellAsDouble(Cell, Value) ? MakeShared<FJsonValueNumber>(Value) : InvalidValue();
+				}
+				else
+				{
+					int64 Value = 0;
+					return ParseCellAsInt(Cell, Value) ? MakeShared<FJsonValueNumber>((double)Value) : InvalidValue();
+				}
+			case EPMXlsxFieldType::Bool:
+				if (Cell.Type == EPMXlsxCellType::Bool)
+				{
+					return MakeShared<FJsonValueBoolean>(Cell.Value == TEXT("1"));
+				}
+				if (Cell.Type == EPMXlsxCellType::String && Cell.Value.Equals(TEXT("true"), ESearchCase::IgnoreCase))
+				{
+					return MakeShared<FJsonValueBoolean>(true);
+				}
+				if (Cell.Type == EPMXlsxCellType::String && Cell.Value.Equals(TEXT("false"), ESearchCase::IgnoreCase))
+				{
+					return MakeShared<FJsonValueBoolean>(false);
+				}
+				return InvalidValue();
+			case EPMXlsxFieldType::Enum:
+				if (Cell.Type == EPMXlsxCellType::String && IsWhitespaceOnly(Cell.Value))
+				{
+					return InvalidValue();
+				}
+				break;
+			default:
+				break;
+			}
+
+			return CellToJsonValue(Cell);
+		}
+
+		const int32 FieldIndex;
+		const FPMXlsxWorksheetTypeInfo& TypeInfo;
+	};
+
+	// C++ port of PMXlsxStructFieldParser in pm_xlsx_field_parser.py
+	class FStructFieldParser : public FFieldParser
+	{
+	public:
+		using FFieldParser::FFieldParser;
+
+		virtual int32 ParseHeaderRow(const FPMXlsxRow& HeaderRow, int32 InStartColumnIndex, int32 ArrayIndex, FValidationError& OutError) override
+		{
+			StartColumnIndex = InStartColumnIndex;
+
+			const FPMXlsxFieldTypeInfo& Field = GetField();
+			if (Field.ChildIndices.Num() == 0)
+			{
+				return FFieldParser::ParseHeaderRow(HeaderRow, InStartColumnIndex, ArrayIndex, OutError);
+			}
+
+			int32 NextColumnIndex = InStartColumnIndex;
+			for (const int32 ChildIndex : Field.ChildIndices)
+			{
+				if (TypeInfo.AllFields[ChildIndex].Type == EPMXlsxFieldType::Array)
+				{
+					SetError(OutError, NextColumnIndex, TEXT("array in struct is not allowed"));
+					return INDEX_NONE;
+				}
+
+				TUniquePtr<FFieldParser> ChildParser = CreateFieldParser(ChildIndex, TypeInfo);
+				NextColumnIndex = ChildParser->ParseHeaderRow(HeaderRow, NextColumnIndex, ArrayIndex, OutError);
+				if (NextColumnIndex == INDEX_NONE)
+				{
+					return INDEX_NONE;
+				}
+				ChildParsers.Add(MoveTemp(ChildParser));
+			}
+
+			EndColumnIndex = NextColumnIndex;
+			return EndColumnIndex;
+		}
+
+		virtual TSharedPtr<FJsonValue> ParseDataRow(const FPMXlsxRow& DataRow, FValidationError& OutError) const override
+		{
+			const FPMXlsxFieldTypeInfo& Field = GetField();
+
+			if (Field.ChildIndices.Num() > 0)
+			{
+				TSharedRef<FJsonObject> Object = MakeShared<FJsonObject>();
+				for (const TUniquePtr<FFieldParser>& ChildParser : ChildParsers)
+				{
+					TSharedPtr<FJsonValue> ChildValue = ChildParser->ParseDataRow(DataRow, OutError);
+					if (!ChildValue.IsValid())
+					{
+						return nullptr;
+					}
+					Object->SetField(ChildParser->GetFieldName(), ChildValue);
+				}
+				return MakeShared<FJsonValueObject>(Object);
+			}
+
+			const FPMXlsxCell& Cell = GetCell(DataRow, StartColumnIndex);
+			if (Cell.Type == EPMXlsxCellType::Empty)
+			{
+				SetError(OutError, StartColumnIndex, FString::Printf(TEXT("field \"%s\"'s data is not valid: cell is empty"), *GetFieldName()));
+				return nullptr;
+			}
+
+			const FString StrippedData = Cell.Value.TrimStartAndEnd();
+			if (StrippedData.StartsWith(TEXT("{")) && StrippedData.EndsWith(TEXT("}")))
+			{
+				// struct with { and } is treated as a json string
+				TSharedPtr<FJsonValue> Parsed = ParseLooseJson(StrippedData);
+				if (!Parsed.IsValid())
+				{
+					SetError(OutError, StartColumnIndex, FString::Printf(TEXT("%s is not a valid struct"), *StrippedData));
+				}
+				return Parsed;
+			}
+
+			// struct without { and } is treated as an ordinary string
+			if (Field.CPPType == TEXT("FGameplayTag"))
+			{
+				return ParseGameplayTag(Field, StrippedData);
+			}
+			if (Field.CPPType == TEXT("FGameplayTagContainer"))
+			{
+				return ParseGameplayTagContainer(Field, StrippedData);
+			}
+			return CellToJsonValue(Cell);
+		}
+
+	private:
+		static FString ApplyGameplayTagFilter(const FString& Filter, const FString& Tag)
+		{
+			return Filter.IsEmpty() || Tag.StartsWith(Filter, ESearchCase::CaseSensitive) ? Tag : Filter + TEXT(".") + Tag;
+		}
+
+		static TSharedPtr<FJsonValue> MakeGameplayTag(const FString& TagName)
+		{
+			TSharedRef<FJsonObject> Tag = MakeShared<FJsonObject>();
+			Tag->SetStringField(TEXT("TagName"), TagName);
+			return MakeShared<FJsonValueObject>(Tag);
+		}
+
+		static TSharedPtr<FJsonValue> ParseGameplayTag(const FPMXlsxFieldTypeInfo& Field, const FString& StrippedData)
+		{
+			if (IsWhitespaceOnly(Field.GameplayTagFilter))
+			{
+				return MakeShared<FJsonValueString>(StrippedData);
+			}
+			return MakeGameplayTag(ApplyGameplayTagFilter(Field.GameplayTagFilter, StrippedData));
+		}
+
+		static TSharedPtr<FJsonValue> ParseGameplayTagContainer(const FPMXlsxFieldTypeInfo& Field, const FString& StrippedData)
+		{
+			TArray<TSharedPtr<FJsonValue>> GameplayTags;
+			if (!IsWhitespaceOnly(Field.GameplayTagFilter))
+			{
+				TArray<FString> Tags;
+				StrippedData.ParseIntoArray(Tags, TEXT(","), /*bCullEmpty:*/ false);
+				for (const FString& Tag : Tags)
+				{
+					GameplayTags.Add(MakeGameplayTag(ApplyGameplayTagFilter(Field.GameplayTagFilter, Tag.TrimStartAndEnd())));
+				}
+			}
+
+			TSharedRef<FJsonObject> TagContainer = MakeShared<FJsonObject>();
+			TagContainer->SetArrayField(TEXT("GameplayTags"), GameplayTags);
+			TagContainer->SetArrayField(TEXT("ParentTags"), TArray<TSharedPtr<FJsonValue>>());
+			return MakeShared<FJsonValueObject>(TagContainer);
+		}
+
+		TArray<TUniquePtr<FFieldParser>> ChildParsers;
+	};
+
+	// C++ port of PMXlsxArrayFieldParser in pm_xlsx_field_parser.py
+	class FArrayFieldParser : public FFieldParser
+	{
+	public:
+		using FFieldParser::FFieldParser;
+
+		virtual int32 ParseHeaderRow(const FPMXlsxRow& HeaderRow, int32 InStartColumnIndex, int32 ArrayIndex, FValidationError& OutError) override
+		{
+			if (InStartColumnIndex >= HeaderRow.Num())
+			{
+				SetError(OutError, InStartColumnIndex, FString::Printf(TEXT("missing field \"%s\" in header row"), *GetFieldName()));
+				return INDEX_NONE;
+			}
+
+			StartColumnIndex = InStartColumnIndex;
+
+			const FPMXlsxFieldTypeInfo& Field = GetField();
+			int32 NextColumnIndex = InStartColumnIndex;
+
+			if (Field.ChildIndices.Num() > 0) // array of struct
+			{
+				int32 ElementIndex = 0;
+				while (IsColumnOfThisField(HeaderRow, NextColumnIndex))
+				{
+					for (const int32 ChildIndex : Field.ChildIndices)
+					{
+						TUniquePtr<FFieldParser> ChildParser = CreateFieldParser(ChildIndex, TypeInfo);
+						NextColumnIndex = ChildParser->ParseHeaderRow(HeaderRow, NextColumnIndex, ElementIndex, OutError);
+						if (NextColumnIndex == INDEX_NONE)
+						{
+							return INDEX_NONE;
+						}
+						ChildParsers.Add(MoveTemp(ChildParser));
+					}
+					++ElementIndex;
+				}
+				ArrayLength = ElementIndex;
+			}
+			else // array of ordinary types
+			{
+				const FPMXlsxCell& StartColumn = HeaderRow[InStartColumnIndex];
+				bIsArrayInOneCell = !StartColumn.IsBlank() && !StartColumn.Value.Contains(TEXT("["), ESearchCase::CaseSensitive);
+				if (bIsArrayInOneCell)
+				{
+					NextColumnIndex = FFieldParser::ParseHeaderRow(HeaderRow, InStartColumnIndex, -1, OutError);
+					if (NextColumnIndex == INDEX_NONE)
+					{
+						return INDEX_NONE;
+					}
+				}
+				else // array split on multiple cells
+				{
+					int32 ElementIndex = 0;
+					while (IsColumnOfThisField(HeaderRow, NextColumnIndex))
+					{
+						if (!ValidateColumnName(HeaderRow, NextColumnIndex, ElementIndex, OutError))
+						{
+							return INDEX_NONE;
+						}
+						++NextColumnIndex;
+						++ElementIndex;
+					}
+				}
+			}
+
+			EndColumnIndex = NextColumnIndex;
+			return EndColumnIndex;
+		}
+
+		virtual TSharedPtr<FJsonValue> ParseDataRow(const FPMXlsxRow& DataRow, FValidationError& OutError) const override
+		{
+			TArray<TSharedPtr<FJsonValue>> Elements;
+
+			if (ChildParsers.Num() > 0) // array of struct
+			{
+				const int32 NumChildFields = GetField().ChildIndices.Num();
+				for (int32 ElementIndex = 0; ElementIndex < ArrayLength; ++ElementIndex)
+				{
+					bool bIsEmptyElement = true;
+					for (int32 ChildFieldIndex = 0; ChildFieldIndex < NumChildFields; ++ChildFieldIndex)
+					{
+						if (!ChildParsers[ElementIndex * NumChildFields + ChildFieldIndex]->IsDataRowEmpty(DataRow))
+						{
+							bIsEmptyElement = false;
+							break;
+						}
+					}
+					if (bIsEmptyElement)
+					{
+						break; // stop on first empty element
+					}
+
+					TSharedRef<FJsonObject> Element = MakeShared<FJsonObject>();
+					for (int32 ChildFieldIndex = 0; ChildFieldIndex < NumChildFields; ++ChildFieldIndex)
+					{
+						const FFieldParser& ChildParser = *ChildParsers[ElementIndex * NumChildFields + ChildFieldIndex];
+						TSharedPtr<FJsonValue> ChildValue = ChildParser.ParseDataRow(DataRow, OutError);
+						if (!ChildValue.IsValid())
+						{
+							return nullptr;
+						}
+						Element->SetField(ChildParser.GetFieldName(), ChildValue);
+					}
+					Elements.Add(MakeShared<FJsonValueObject>(Element));
+				}
+				return MakeShared<FJsonValueArray>(Elements);
+			}
+
+			if (bIsArrayInOneCell)
+			{
+				const FPMXlsxCell& Cell = GetCell(DataRow, StartColumnIndex);
+				if (Cell.Type == EPMXlsxCellType::Empty)
+				{
+					SetError(OutError, StartColumnIndex, FString::Printf(TEXT("field \"%s\"'s data is not valid: cell is empty"), *GetFieldName()));
+					return nullptr;
+				}
+
+				// [ and ] can be omitted
+				const FString StrippedData = Cell.Value.TrimStartAndEnd();
+				const bool bHasBrackets = StrippedData.StartsWith(TEXT("[")) && StrippedData.EndsWith(TEXT("]"));
+				TSharedPtr<FJsonValue> Parsed = ParseLooseJson(bHasBrackets ? StrippedData : FString::Printf(TEXT("[ %s ]"), *StrippedData));
+				if (!Parsed.IsValid())
+				{
+					SetError(OutError, StartColumnIndex, FString::Printf(TEXT("data %s is not a valid array"), *StrippedData));
+				}
+				return Parsed;
+			}
+
+			// array split on multiple cells
+			for (int32 ColumnIndex = StartColumnIndex; ColumnIndex < EndColumnIndex; ++ColumnIndex)
+			{
+				if (GetCell(DataRow, ColumnIndex).IsBlank())
+				{
+					break; // stop on first empty element
+				}
+
+				TSharedPtr<FJsonValue> Value = ParseDataCell(DataRow, ColumnIndex, OutError);
+				if (!Value.IsValid())
+				{
+					return nullptr;
+				}
+				Elements.Add(Value);
+			}
+			return MakeShared<FJsonValueArray>(Elements);
+		}
+
+	private:
+		bool IsColumnOfThisField(const FPMXlsxRow& HeaderRow, int32 ColumnIndex) const
+		{
+			const FPMXlsxCell& Cell = GetCell(HeaderRow, ColumnIndex);
+			return !Cell.IsBlank() && Cell.Value.TrimStart().StartsWith(GetFieldName(), ESearchCase::CaseSensitive);
+		}
+
+		TArray<TUniquePtr<FFieldParser>> ChildParsers;
+		bool bIsArrayInOneCell = false;
+		int32 ArrayLength = 0; // only set if there are ChildParsers
+	};
+
+	TUniquePtr<FFieldParser> CreateFieldParser(int32 FieldIndex, const FPMXlsxWorksheetTypeInfo& TypeInfo)
+	{
+		switch (TypeInfo.AllFields[FieldIndex].Type)
+		{
+		case EPMXlsxFieldType::Array:
+			return MakeUnique<FArrayFieldParser>(FieldIndex, TypeInfo);
+		case EPMXlsxFieldType::Struct:
+			return MakeUnique<FStructFieldParser>(FieldIndex, TypeInfo);
+		default:
+			return MakeUnique<FFieldParser>(FieldIndex, TypeInfo);
+		}
+	}
+
+	FString SerializeRows(const TArray<TSharedPtr<FJsonValue>>& Rows)
+	{
+		FString JsonString;
+		const TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> JsonWriter = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&JsonString);
+		FJsonSerializer::Serialize(Rows, JsonWriter);
+		return JsonString;
+	}
+}
+
+bool FPMXlsxCell::IsBlank() const
+{
+	switch (Type)
+	{
+	case EPMXlsxCellType::Empty:
+		return true;
+	case EPMXlsxCellType::String:
+	case EPMXlsxCellType::Error:
+		return Value.IsEmpty() || IsWhitespaceOnly(Value);
+	default:
+		return false;
+	}
+}
+
+bool FPMXlsxNativeWorkbook::Open(const FString& AbsoluteFilePath, FString& OutError)
+{
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *AbsoluteFilePath))
+	{
+		OutError = FString::Printf(TEXT("Unable to read file %s"), *AbsoluteFilePath);
+		return false;
+	}
+
+	if (!Archive.Open(MoveTemp(FileData), OutError))
+	{
+		return false;
+	}
+
+	// Find the workbook part through the package relationships. It's almost always xl/workbook.xml.
+	FString WorkbookEntry = TEXT("xl/workbook.xml");
+	TArray<FRelationship> PackageRelationships;
+	if (!ReadRelationships(Archive, TEXT("_rels/.rels"), PackageRelationships, OutError))
+	{
+		return false;
+	}
+	for (const FRelationship& Relationship : PackageRelationships)
+	{
+		if (Relationship.Type.EndsWith(TEXT("/officeDocument")))
+		{
+			WorkbookEntry = ResolvePartPath(FString(), Relationship.Target);
+		}
+	}
+
+	const FString WorkbookDirectory = FPaths::GetPath(WorkbookEntry);
+	TArray<FRelationship> WorkbookRelationships;
+	if (!ReadRelationships(Archive, WorkbookDirectory / TEXT("_rels") / FPaths::GetCleanFilename(WorkbookEntry) + TEXT(".rels"), WorkbookRelationships, OutError))
+	{
+		return false;
+	}
+
+	TArray<uint8> WorkbookData;
+	if (!Archive.ReadEntry(WorkbookEntry, WorkbookData, OutError))
+	{
+		return false;
+	}
+
+	FPMXlsxXmlReader Xml(WorkbookData.GetData(), WorkbookData.Num());
+	while (Xml.Next())
+	{
+		if (Xml.IsStartElement("sheet"))
+		{
+			FString Name;
+			FString RelationshipId;
+			Xml.GetAttribute("name", Name);
+			Xml.GetAttribute("id", RelationshipId);
+
+			const FRelationship* Relationship = WorkbookRelationships.FindByPredicate([&RelationshipId](const FRelationship& Candidate)
+			{
+				return Candidate.Id == RelationshipId;
+			});
+
+			WorksheetNames.Add(Name);
+			WorksheetEntries.Add(Relationship ? ResolvePartPath(WorkbookDirectory, Relationship->Target) : FString());
+		}
+	}
+
+	if (!Xml.GetError().IsEmpty())
+	{
+		OutError = FString::Printf(TEXT("%s: %s"), *WorkbookEntry, *Xml.GetError());
+		return false;
+	}
+
+	for (const FRelationship& Relationship : WorkbookRelationships)
+	{
+		if (Relationship.Type.EndsWith(TEXT("/sharedStrings")))
+		{
+			return ReadSharedStrings(ResolvePartPath(WorkbookDirectory, Relationship.Target), OutError);
+		}
+	}
+
+	return true;
+}
+
+bool FPMXlsxNativeWorkbook::ReadSharedStrings(const FString& EntryName, FString& OutError)
+{
+	TArray<uint8> Data;
+	if (!Archive.ReadEntry(EntryName, Data, OutError))
+	{
+		return false;
+	}
+
+	FPMXlsxXmlReader Xml(Data.GetData(), Data.Num());
+	while (Xml.Next())
+	{
+		if (Xml.IsStartElement("si"))
+		{
+			ReadStringItem(Xml, "si", SharedStrings.AddDefaulted_GetRef());
+		}
+		else if (Xml.IsStartElement("sst"))
+		{
+			FString UniqueCount;
+			if (Xml.GetAttribute("uniqueCount", UniqueCount))
+			{
+				SharedStrings.Reserve(FCString::Atoi(*UniqueCount));
+			}
+		}
+	}
+
+	if (!Xml.GetError().IsEmpty())
+	{
+		OutError = FString::Printf(TEXT("%s: %s"), *EntryName, *Xml.GetError());
+		return false;
+	}
+	return true;
+}
+
+bool FPMXlsxNativeWorkbook::ForEachRow(const FString& WorksheetName, TFunctionRef<bool(int32 RowIndex, const FPMXlsxRow& Row)> Visitor, FString& OutError) const
+{
+	// Worksheet names are case sensitive, same as openpyxl
+	const int32 WorksheetIndex = WorksheetNames.IndexOfByPredicate([&WorksheetName](const FString& Candidate)
+	{
+		return Candidate.Equals(WorksheetName, ESearchCase::CaseSensitive);
+	});
+	if (WorksheetIndex == INDEX_NONE || WorksheetEntries[WorksheetIndex].IsEmpty())
+	{
+		OutError = FString::Printf(TEXT("Worksheet %s does not exist"), *WorksheetName);
+		return false;
+	}
+
+	TArray<uint8> Data;
+	if (!Archive.ReadEntry(WorksheetEntries[WorksheetIndex], Data, OutError))
+	{
+		return false;
+	}
+
+	const FPMXlsxRow EmptyRow;
+	FPMXlsxRow Row;
+	int32 RowIndex = 0;
+	int32 NextRowIndex = 1;
+	int32 NextColumnIndex = 0;
+
+	const ANSICHAR* Reference = nullptr;
+	int32 ReferenceLen = 0;
+
+	FPMXlsxXmlReader Xml(Data.GetData(), Data.Num());
+	while (Xml.Next())
+	{
+		if (Xml.IsStartElement("row"))
+		{
+			RowIndex = Xml.GetRawAttribute("r", Reference, ReferenceLen) ? ParseRowReference(Reference, ReferenceLen) : NextRowIndex;
+			for (; NextRowIndex < RowIndex; ++NextRowIndex)
+			{
+				if (!Visitor(NextRowIndex, EmptyRow))
+				{
+					return true;
+				}
+			}
+			Row.Reset();
+			NextColumnIndex = 0;
+		}
+		else if (Xml.IsEndElement("row"))
+		{
+			NextRowIndex = RowIndex + 1;
+			if (!Visitor(RowIndex, Row))
+			{
+				return true;
+			}
+		}
+		else if (Xml.IsStartElement("c"))
+		{
+			const int32 ColumnIndex = Xml.GetRawAttribute("r", Reference, ReferenceLen) ? CellReferenceToColumnIndex(Reference, ReferenceLen) : NextColumnIndex;
+			NextColumnIndex = ColumnIndex + 1;
+
+			const ANSICHAR* CellType = "n";
+			int32 CellTypeLen = 1;
+			Xml.GetRawAttribute("t", CellType, CellTypeLen);
+			auto IsCellType = [CellType, CellTypeLen](const ANSICHAR* Type)
+			{
+				return FCStringAnsi::Strlen(Type) == CellTypeLen && FCStringAnsi::Strncmp(CellType, Type, CellTypeLen) == 0;
+			};
+
+			if (Row.Num() <= ColumnIndex)
+			{
+				Row.SetNum(ColumnIndex + 1);
+			}
+			FPMXlsxCell& Cell = Row[ColumnIndex];
+
+			bool bHasValue = false;
+			while (Xml.Next() && !Xml.IsEndElement("c"))
+			{
+				if (Xml.IsStartElement("v"))
+				{
+					while (Xml.Next() && !Xml.IsEndElement("v"))
+					{
+						Xml.AppendText(Cell.Value);
+					}
+					bHasValue = true;
+				}
+				else if (Xml.IsStartElement("is"))
+				{
+					ReadStringItem(Xml, "is", Cell.Value);
+					bHasValue = true;
+				}
+				else if (Xml.GetNodeType() == FPMXlsxXmlReader::ENodeType::StartElement)
+				{
+					Xml.SkipElement(); // Formulas and extensions
+				}
+			}
+
+			if (!bHasValue)
+			{
+				Cell.Type = EPMXlsxCellType::Empty;
+			}
+			else if (IsCellType("s"))
+			{
+				const int32 SharedStringIndex = FCString::Atoi(*Cell.Value);
+				Cell.Value = SharedStrings.IsValidIndex(SharedStringIndex) ? SharedStrings[SharedStringIndex] : FString();
+				Cell.Type = EPMXlsxCellType::String;
+			}
+			else if (IsCellType("b"))
+			{
+				Cell.Type = EPMXlsxCellType::Bool;
+			}
+			else if (IsCellType("e"))
+			{
+				Cell.Type = EPMXlsxCellType::Error;
+			}
+			else if (IsCellType("str") || IsCellType("inlineStr") || IsCellType("d"))
+			{
+				Cell.Type = EPMXlsxCellType::String;
+			}
+			else
+			{
+				Cell.Type = Cell.Value.IsEmpty() ? EPMXlsxCellType::Empty : EPMXlsxCellType::Number;
+			}
+		}
+	}
+
+	if (!Xml.GetError().IsEmpty())
+	{
+		OutError = FString::Printf(TEXT("%s: %s"), *WorksheetEntries[WorksheetIndex], *Xml.GetError());
+		return false;
+	}
+	return true;
+}
+
+void FPMXlsxNativeReader::BeginImportRun()
+{
+	bIsImportRunActive = true;
+}
+
+void FPMXlsxNativeReader::EndImportRun()
+{
+	bIsImportRunActive = false;
+
+	FScopeLock Lock(&WorkbookCacheCriticalSection);
+	WorkbookCache.Empty();
+}
+
+TSharedPtr<const FPMXlsxNativeWorkbook> FPMXlsxNativeReader::OpenWorkbook(const FString& AbsoluteFilePath, FString& OutError)
+{
+	const FFileStatData StatData = IFileManager::Get().GetStatData(*AbsoluteFilePath);
+	if (bIsImportRunActive && StatData.bIsValid)
+	{
+		FScopeLock Lock(&WorkbookCacheCriticalSection);
+		const FCachedWorkbook* CachedWorkbook = WorkbookCache.Find(AbsoluteFilePath);
+		if (CachedWorkbook && CachedWorkbook->TimeStamp == StatData.ModificationTime && CachedWorkbook->Size == StatData.FileSize)
+		{
+			return CachedWorkbook->Workbook;
+		}
+	}
+
+	const TSharedRef<FPMXlsxNativeWorkbook> Workbook = MakeShared<FPMXlsxNativeWorkbook>();
+	if (!Workbook->Open(AbsoluteFilePath, OutError))
+	{
+		return nullptr;
+	}
+
+	if (bIsImportRunActive && StatData.bIsValid)
+	{
+		FScopeLock Lock(&WorkbookCacheCriticalSection);
+		FCachedWorkbook& CachedWorkbook = WorkbookCache.FindOrAdd(AbsoluteFilePath);
+		CachedWorkbook.TimeStamp = StatData.ModificationTime;
+		CachedWorkbook.Size = StatData.FileSize;
+		CachedWorkbook.Workbook = Workbook;
+	}
+	return Workbook;
+}
+
+TArray<FString> FPMXlsxNativeReader::ReadWorksheetNames(const FString& AbsoluteFilePath)
+{
+	UE_LOG(LogPMXlsxImporter, Log, TEXT("Reading xlsx file \"%s\""), *AbsoluteFilePath);
+
+	FString Error;
+	const TSharedPtr<const FPMXlsxNativeWorkbook> Workbook = OpenWorkbook(AbsoluteFilePath, Error);
+	if (!Workbook.IsValid())
+	{
+		UE_LOG(LogPMXlsxImporter, Error, TEXT("Could not read worksheet names: %s"), *Error);
+		return TArray<FString>();
+	}
+
+	UE_LOG(LogPMXlsxImporter, Log, TEXT("All sheet names: %s"), *FString::Join(Workbook->GetWorksheetNames(), TEXT(", ")));
+	return Workbook->GetWorksheetNames();
+}
+
+FPMXlsxImporterPythonBridgeAssetNames FPMXlsxNativeReader::ReadWorksheetAssetNames(const FString& AbsoluteFilePath, const FString& WorksheetName, int32 HeaderRow, int32 DataStartRow)
+{
+	FPMXlsxImporterPythonBridgeAssetNames Result;
+
+	const TSharedPtr<const FPMXlsxNativeWorkbook> Workbook = OpenWorkbook(AbsoluteFilePath, Result.Error);
+	if (!Workbook.IsValid())
+	{
+		return Result;
+	}
+
+	Workbook->ForEachRow(WorksheetName, [&Result, DataStartRow](int32 RowIndex, const FPMXlsxRow& Row)
+	{
+		if (RowIndex < DataStartRow)
+		{
+			return true;
+		}
+
+		const FPMXlsxCell& NameCell = GetCell(Row, 0); // Name should always be the first column
+		if (NameCell.IsBlank())
+		{
+			return false; // not valid since this row
+		}
+
+		Result.AssetNames.Add(CellToString(NameCell));
+		return true;
+	}, Result.Error);
+
+	return Result;
+}
+
+FPMXlsxImporterPythonBridgeJsonString FPMXlsxNativeReader::ReadWorksheetAsJson(const FString& AbsoluteFilePath, const FString& WorksheetName, int32 HeaderRow, int32 DataStartRow, const FPMXlsxWorksheetTypeInfo& WorksheetTypeInfo)
+{
+	FPMXlsxImporterPythonBridgeJsonString Result;
+	TArray<TSharedPtr<FJsonValue>> Rows;
+	if (ReadWorksheetRows(AbsoluteFilePath, WorksheetName, HeaderRow, DataStartRow, WorksheetTypeInfo, Rows, Result.Error))
+	{
+		Result.JsonString = SerializeRows(Rows);
+	}
+	return Result;
+}
+
+TArray<FPMXlsxImporterPythonBridgeWorksheetResult> FPMXlsxNativeReader::ReadWorksheets(const FString& AbsoluteFilePath, const TArray<FPMXlsxImporterPythonBridgeWorksheetRequest>& Requests)
+{
+	TArray<FPMXlsxImporterPythonBridgeWorksheetResult> Results;
+	Results.Reserve(Requests.Num());
+	for (const FPMXlsxImporterPythonBridgeWorksheetRequest& Request : Requests)
+	{
+		FPMXlsxImporterPythonBridgeWorksheetResult& Result = Results.AddDefaulted_GetRef();
+		Result.WorksheetName = Request.WorksheetName;
+
+		// One pass over the worksheet for both the asset names and the rows
+		TArray<TSharedPtr<FJsonValue>> Rows;
+		if (!ReadWorksheetRows(AbsoluteFilePath, Request.WorksheetName, Request.HeaderRow, Request.DataStartRow, Request.WorksheetTypeInfo, Rows,
+			Result.JsonString.Error, &Result.AssetNames))
+		{
+			continue;
+		}
+
+		if (Request.bUseJson)
+		{
+			Result.JsonString.JsonString = SerializeRows(Rows);
+		}
+		else
+		{
+			TArray<FString> ColumnNames;
+			for (const int32 FieldIndex : Request.WorksheetTypeInfo.TopFields)
+			{
+				ColumnNames.Add(Request.WorksheetTypeInfo.AllFields[FieldIndex].NameCPP);
+			}
+			Result.JsonString.BinaryData = FPMXlsxWorksheetData::EncodeBinary(ColumnNames, Rows);
+		}
+	}
+	return Results;
+}
+
+bool FPMXlsxNativeReader::ReadWorksheetRows(const FString& AbsoluteFilePath, const FString& WorksheetName, int32 HeaderRow, int32 DataStartRow, const FPMXlsxWorksheetTypeInfo& WorksheetTypeInfo,
+	TArray<TSharedPtr<FJsonValue>>& OutRows, FString& OutError, FPMXlsxImporterPythonBridgeAssetNames* OutAssetNames)
+{
+	const FString FileName = FPaths::GetCleanFilename(AbsoluteFilePath);
+
+	// Once a row is not valid, the pass stops, unless it goes on to list the names of the remaining rows
+	bool bValid = true;
+	const auto StopParsing = [&bValid, &OutRows, OutAssetNames]()
+	{
+		bValid = false;
+		OutRows.Empty();
+		return OutAssetNames != nullptr;
+	};
+
+	FValidationError ValidationError;
+	if (WorksheetTypeInfo.TopFields.Num() == 0)
+	{
+		ValidationError.Message = TEXT("Data class is not valid, has 0 top fields");
+		if (!StopParsing())
+		{
+			OutError = ValidationError.ToString(FileName, WorksheetName);
+			return false;
+		}
+	}
+
+	const TSharedPtr<const FPMXlsxNativeWorkbook> Workbook = OpenWorkbook(AbsoluteFilePath, OutError);
+	if (!Workbook.IsValid())
+	{
+		if (OutAssetNames)
+		{
+			OutAssetNames->Error = OutError;
+		}
+		return false;
+	}
+
+	UE_LOG(LogPMXlsxImporter, Verbose, TEXT("%s-%s: LIST ALL CPP FIELDS:"), *FileName, *WorksheetName);
+	for (const FPMXlsxFieldTypeInfo& Field : WorksheetTypeInfo.AllFields)
+	{
+		UE_LOG(LogPMXlsxImporter, Verbose, TEXT("%s-%s: - index: %i, name: %s, type: %s, cpp_type: %s, ele_type: %s"), *FileName, *WorksheetName,
+			Field.Index, *Field.NameCPP, *UEnum::GetValueAsString(Field.Type), *Field.CPPType, *UEnum::GetValueAsString(Field.Element_Type));
+	}
+
+	TArray<TUniquePtr<FFieldParser>> FieldParsers;
+	bool bHeaderParsed = false;
+
+	const bool bRead = Workbook->ForEachRow(WorksheetName, [&](int32 RowIndex, const FPMXlsxRow& Row)
+	{
+		if (RowIndex == HeaderRow && bValid)
+		{
+			int32 ColumnIndex = 0;
+			for (const int32 FieldIndex : WorksheetTypeInfo.TopFields)
+			{
+				TUniquePtr<FFieldParser> FieldParser = CreateFieldParser(FieldIndex, WorksheetTypeInfo);
+				ColumnIndex = FieldParser->ParseHeaderRow(Row, ColumnIndex, -1, ValidationError);
+				if (ColumnIndex == INDEX_NONE)
+				{
+					ValidationError.RowIndex = RowIndex;
+					return StopParsing();
+				}
+
+				UE_LOG(LogPMXlsxImporter, Verbose, TEXT("%s-%s: - field %s range [%i-%i]"), *FileName, *WorksheetName,
+					*FieldParser->GetFieldName(), FieldParser->StartColumnIndex, FieldParser->EndColumnIndex - 1);
+				FieldParsers.Add(MoveTemp(FieldParser));
+			}
+			bHeaderParsed = true;
+		}
+
+		if (RowIndex < DataStartRow)
+		{
+			return true;
+		}
+
+		const FPMXlsxCell& NameCell = GetCell(Row, 0); // Name should always be the first column
+		if (NameCell.IsBlank())
+		{
+			return false; // not valid since this row
+		}
+
+		if (OutAssetNames)
+		{
+			OutAssetNames->AssetNames.Add(CellToString(NameCell));
+		}
+
+		if (!bValid)
+		{
+			return true;
+		}
+
+		if (!bHeaderParsed)
+		{
+			ValidationError.Message = FString::Printf(TEXT("header row %i must come before data start row %i"), HeaderRow, DataStartRow);
+			return StopParsing();
+		}
+
+		TSharedRef<FJsonObject> RowObject = MakeShared<FJsonObject>();
+		for (const TUniquePtr<FFieldParser>& FieldParser : FieldParsers)
+		{
+			TSharedPtr<FJsonValue> Value = FieldParser->ParseDataRow(Row, ValidationError);
+			if (!Value.IsValid())
+			{
+				ValidationError.RowIndex = RowIndex;
+				return StopParsing();
+			}
+			RowObject->SetField(FieldParser->GetFieldName(), Value);
+		}
+		OutRows.Add(MakeShared<FJsonValueObject>(RowObject));
+		return true;
+	}, OutError);
+
+	if (!bRead)
+	{
+		if (OutAssetNames)
+		{
+			OutAssetNames->AssetNames.Reset();
+			OutAssetNames->Error = OutError;
+		}
+		return false;
+	}
+
+	if (!bValid)
+	{
+		OutError = ValidationError.ToString(FileName, WorksheetName);
+		return false;
+	}
+
+	if (!bHeaderParsed)
+	{
+		ValidationError.Message = FString::Printf(TEXT("header row %i does not exist"), HeaderRow);
+		OutError = ValidationError.ToString(FileName, WorksheetName);
+		return false;
+	}
+
+	return true;
+}
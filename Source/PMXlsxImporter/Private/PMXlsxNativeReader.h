@@ -0,0 +1,102 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "PMXlsxImporterReader.h"
+#include "PMXlsxZipReader.h"
+
+class FJsonValue;
+
+enum class EPMXlsxCellType : uint8
+{
+	Empty,
+	String,
+	Number,
+	Bool,
+	Error
+};
+
+struct FPMXlsxCell
+{
+	EPMXlsxCellType Type = EPMXlsxCellType::Empty;
+
+	// Cell content as stored in the file: the string itself, a number such as "1.5", or "1"/"0" for bools
+	FString Value;
+
+	// True for empty cells and cells that only contain whitespace
+	bool IsBlank() const;
+};
+
+typedef TArray<FPMXlsxCell> FPMXlsxRow;
+
+/**
+ * An opened xlsx file.
+ * The zip index, worksheet list and shared strings are read when the workbook is opened; worksheets are streamed on demand.
+ */
+class FPMXlsxNativeWorkbook
+{
+public:
+	bool Open(const FString& AbsoluteFilePath, FString& OutError);
+
+	const TArray<FString>& GetWorksheetNames() const { return WorksheetNames; }
+
+	// Visits the rows of a worksheet in order, starting at row 1. Rows missing from the file are visited as empty rows.
+	// RowIndex is 1-based like in Excel. Return false from Visitor to stop reading.
+	bool ForEachRow(const FString& WorksheetName, TFunctionRef<bool(int32 RowIndex, const FPMXlsxRow& Row)> Visitor, FString& OutError) const;
+
+private:
+	bool ReadSharedStrings(const FString& EntryName, FString& OutError);
+
+	FPMXlsxZipReader Archive;
+	TArray<FString> WorksheetNames;
+	// Zip entry of each worksheet, parallel to WorksheetNames
+	TArray<FString> WorksheetEntries;
+	TArray<FString> SharedStrings;
+};
+
+/**
+ * Reads xlsx files directly in C++. Does not need Python or openpyxl.
+ * Produces the same results as the Python implementation of UPMXlsxImporterPythonBridge (see init_unreal.py).
+ */
+class FPMXlsxNativeReader : public IPMXlsxImporterReader
+{
+public:
+	virtual void BeginImportRun() override;
+	virtual void EndImportRun() override;
+
+	virtual bool CanReadOnAnyThread() const override { return true; }
+
+	virtual TArray<FString> ReadWorksheetNames(const FString& AbsoluteFilePath) override;
+
+	virtual FPMXlsxImporterPythonBridgeAssetNames ReadWorksheetAssetNames(const FString& AbsoluteFilePath, const FString& WorksheetName, int32 HeaderRow, int32 DataStartRow) override;
+
+	virtual FPMXlsxImporterPythonBridgeJsonString ReadWorksheetAsJson(const FString& AbsoluteFilePath, const FString& WorksheetName, int32 HeaderRow, int32 DataStartRow, const FPMXlsxWorksheetTypeInfo& WorksheetTypeInfo) override;
+
+	// Returns the data in the binary format of FPMXlsxWorksheetData unless a request asks for json
+	virtual TArray<FPMXlsxImporterPythonBridgeWorksheetResult> ReadWorksheets(const FString& AbsoluteFilePath, const TArray<FPMXlsxImporterPythonBridgeWorksheetRequest>& Requests) override;
+
+private:
+	// Reads the data rows of a worksheet as json objects keyed by top field name.
+	// If OutAssetNames is set, it also receives what ReadWorksheetAssetNames would return, from the same pass over the worksheet:
+	// the names of all rows are listed even if a row is not valid, so that SyncAssets sees every asset while ParseData reports the error.
+	bool ReadWorksheetRows(const FString& AbsoluteFilePath, const FString& WorksheetName, int32 HeaderRow, int32 DataStartRow, const FPMXlsxWorksheetTypeInfo& WorksheetTypeInfo,
+		TArray<TSharedPtr<FJsonValue>>& OutRows, FString& OutError, FPMXlsxImporterPythonBridgeAssetNames* OutAssetNames = nullptr);
+
+	// Returns nullptr and sets OutError if the file could not be opened.
+	// During an import run workbooks are cached and only reopened if the file's timestamp or size changed.
+	TSharedPtr<const FPMXlsxNativeWorkbook> OpenWorkbook(const FString& AbsoluteFilePath, FString& OutError);
+
+	struct FCachedWorkbook
+	{
+		FDateTime TimeStamp;
+		int64 Size = 0;
+		TSharedPtr<const FPMXlsxNativeWorkbook> Workbook;
+	};
+
+	// Keyed by absolute file path. Guarded by WorkbookCacheCriticalSection since files may be read on worker threads
+	TMap<FString, FCachedWorkbook> WorkbookCache;
+	FCriticalSection WorkbookCacheCriticalSection;
+	bool bIsImportRunActive = false;
+};
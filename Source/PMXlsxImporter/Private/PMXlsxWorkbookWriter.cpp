@@ -0,0 +1,153 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+
+#include "PMXlsxWorkbookWriter.h"
+
+namespace
+{
+	const TCHAR* const XML_DECLARATION = TEXT("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n");
+	const TCHAR* const SPREADSHEET_NAMESPACE = TEXT("http://schemas.openxmlformats.org/spreadsheetml/2006/main");
+	const TCHAR* const RELATIONSHIPS_NAMESPACE = TEXT("http://schemas.openxmlformats.org/package/2006/relationships");
+	const TCHAR* const RELATIONSHIP_TYPE_PREFIX = TEXT("http://schemas.openxmlformats.org/officeDocument/2006/relationships/");
+
+	void AppendUtf8(TArray<uint8>& Out, const FString& Text)
+	{
+		const FTCHARToUTF8 Utf8Text(*Text);
+		Out.Append(reinterpret_cast<const uint8*>(Utf8Text.Get()), Utf8Text.Length());
+	}
+
+	TArray<uint8> ToUtf8(const FString& Text)
+	{
+		TArray<uint8> Out;
+		AppendUtf8(Out, Text);
+		return Out;
+	}
+
+	FString EscapeXml(const FString& Text)
+	{
+		return Text.Replace(TEXT("&"), TEXT("&amp;")).Replace(TEXT("<"), TEXT("&lt;")).Replace(TEXT(">"), TEXT("&gt;")).Replace(TEXT("\""), TEXT("&quot;"));
+	}
+
+	// 0 is "A", 26 is "AA"
+	FString ColumnIndexToName(int32 ColumnIndex)
+	{
+		FString Name;
+		for (int32 Remaining = ColumnIndex + 1; Remaining > 0; Remaining = (Remaining - 1) / 26)
+		{
+			Name.InsertAt(0, static_cast<TCHAR>(TEXT('A') + (Remaining - 1) % 26));
+		}
+		return Name;
+	}
+}
+
+void FPMXlsxWorkbookWriter::AddWorksheet(const FString& WorksheetName, int32 NumRows, TFunctionRef<void(int32 RowIndex, FPMXlsxRow& OutRow)> MakeRow)
+{
+	WorksheetNames.Add(WorksheetName);
+
+	TArray<uint8> WorksheetData;
+	AppendUtf8(WorksheetData, FString::Printf(TEXT("%s<worksheet xmlns=\"%s\"><sheetData>"), XML_DECLARATION, SPREADSHEET_NAMESPACE));
+
+	TArray<FString> ColumnNames;
+	FPMXlsxRow Row;
+	FString RowXml;
+	for (int32 RowIndex = 0; RowIndex < NumRows; ++RowIndex)
+	{
+		Row.Reset();
+		MakeRow(RowIndex, Row);
+
+		const int32 RowNumber = RowIndex + 1;
+		RowXml = FString::Printf(TEXT("<row r=\"%i\">"), RowNumber);
+		for (int32 ColumnIndex = 0; ColumnIndex < Row.Num(); ++ColumnIndex)
+		{
+			const FPMXlsxCell& Cell = Row[ColumnIndex];
+			if (Cell.Type == EPMXlsxCellType::Empty)
+			{
+				continue;
+			}
+
+			while (ColumnNames.Num() <= ColumnIndex)
+			{
+				ColumnNames.Add(ColumnIndexToName(ColumnNames.Num()));
+			}
+
+			switch (Cell.Type)
+			{
+			case EPMXlsxCellType::String:
+				RowXml += FString::Printf(TEXT("<c r=\"%s%i\" t=\"s\"><v>%i</v></c>"), *ColumnNames[ColumnIndex], RowNumber, AddSharedString(Cell.Value));
+				break;
+			case EPMXlsxCellType::Number:
+				RowXml += FString::Printf(TEXT("<c r=\"%s%i\"><v>%s</v></c>"), *ColumnNames[ColumnIndex], RowNumber, *EscapeXml(Cell.Value));
+				break;
+			case EPMXlsxCellType::Bool:
+				RowXml += FString::Printf(TEXT("<c r=\"%s%i\" t=\"b\"><v>%s</v></c>"), *ColumnNames[ColumnIndex], RowNumber, *EscapeXml(Cell.Value));
+				break;
+			case EPMXlsxCellType::Error:
+				RowXml += FString::Printf(TEXT("<c r=\"%s%i\" t=\"e\"><v>%s</v></c>"), *ColumnNames[ColumnIndex], RowNumber, *EscapeXml(Cell.Value));
+				break;
+			default:
+				break;
+			}
+		}
+		RowXml += TEXT("</row>");
+		AppendUtf8(WorksheetData, RowXml);
+	}
+
+	AppendUtf8(WorksheetData, TEXT("</sheetData></worksheet>"));
+	Archive.AddEntry(FString::Printf(TEXT("xl/worksheets/sheet%i.xml"), WorksheetNames.Num()), WorksheetData);
+}
+
+bool FPMXlsxWorkbookWriter::Save(const FString& AbsoluteFilePath, FString& OutError)
+{
+	FString ContentTypes = FString::Printf(TEXT("%s<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"), XML_DECLARATION);
+	ContentTypes += TEXT("<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>");
+	ContentTypes += TEXT("<Default Extension=\"xml\" ContentType=\"application/xml\"/>");
+	ContentTypes += TEXT("<Override PartName=\"/xl/workbook.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>");
+	ContentTypes += TEXT("<Override PartName=\"/xl/sharedStrings.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sharedStrings+xml\"/>");
+
+	FString Workbook = FString::Printf(TEXT("%s<workbook xmlns=\"%s\" xmlns:r=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships\"><sheets>"),
+		XML_DECLARATION, SPREADSHEET_NAMESPACE);
+	FString WorkbookRelationships = FString::Printf(TEXT("%s<Relationships xmlns=\"%s\">"), XML_DECLARATION, RELATIONSHIPS_NAMESPACE);
+
+	for (int32 Index = 0; Index < WorksheetNames.Num(); ++Index)
+	{
+		const int32 SheetNumber = Index + 1;
+		ContentTypes += FString::Printf(TEXT("<Override PartName=\"/xl/worksheets/sheet%i.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>"),
+			SheetNumber);
+		Workbook += FString::Printf(TEXT("<sheet name=\"%s\" sheetId=\"%i\" r:id=\"rId%i\"/>"), *EscapeXml(WorksheetNames[Index]), SheetNumber, SheetNumber);
+		WorkbookRelationships += FString::Printf(TEXT("<Relationship Id=\"rId%i\" Type=\"%sworksheet\" Target=\"worksheets/sheet%i.xml\"/>"),
+			SheetNumber, RELATIONSHIP_TYPE_PREFIX, SheetNumber);
+	}
+
+	ContentTypes += TEXT("</Types>");
+	Workbook += TEXT("</sheets></workbook>");
+	WorkbookRelationships += FString::Printf(TEXT("<Relationship Id=\"rId%i\" Type=\"%ssharedStrings\" Target=\"sharedStrings.xml\"/></Relationships>"),
+		WorksheetNames.Num() + 1, RELATIONSHIP_TYPE_PREFIX);
+
+	const FString PackageRelationships = FString::Printf(TEXT("%s<Relationships xmlns=\"%s\"><Relationship Id=\"rId1\" Type=\"%sofficeDocument\" Target=\"xl/workbook.xml\"/></Relationships>"),
+		XML_DECLARATION, RELATIONSHIPS_NAMESPACE, RELATIONSHIP_TYPE_PREFIX);
+
+	TArray<uint8> SharedStringsData;
+	AppendUtf8(SharedStringsData, FString::Printf(TEXT("%s<sst xmlns=\"%s\" count=\"%i\" uniqueCount=\"%i\">"), XML_DECLARATION, SPREADSHEET_NAMESPACE,
+		SharedStrings.Num(), SharedStrings.Num()));
+	for (const FString& SharedString : SharedStrings)
+	{
+		AppendUtf8(SharedStringsData, FString::Printf(TEXT("<si><t xml:space=\"preserve\">%s</t></si>"), *EscapeXml(SharedString)));
+	}
+	AppendUtf8(SharedStringsData, TEXT("</sst>"));
+
+	Archive.AddEntry(TEXT("[Content_Types].xml"), ToUtf8(ContentTypes));
+	Archive.AddEntry(TEXT("_rels/.rels"), ToUtf8(PackageRelationships));
+	Archive.AddEntry(TEXT("xl/workbook.xml"), ToUtf8(Workbook));
+	Archive.AddEntry(TEXT("xl/_rels/workbook.xml.rels"), ToUtf8(WorkbookRelationships));
+	Archive.AddEntry(TEXT("xl/sharedStrings.xml"), SharedStringsData);
+	return Archive.Save(AbsoluteFilePath, OutError);
+}
+
+int32 FPMXlsxWorkbookWriter::AddSharedString(const FString& Value)
+{
+	if (const int32* Index = SharedStringIndices.Find(Value))
+	{
+		return *Index;
+	}
+	return SharedStringIndices.Add(Value, SharedStrings.Add(Value));
+}
@@ -0,0 +1,30 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PMXlsxNativeReader.h"
+#include "PMXlsxZipWriter.h"
+
+/**
+ * Writes xlsx files with plain cells: strings go to the shared string table like Excel writes them, numbers and bools are stored as is,
+ * and there are no styles or formulas. Used to generate the workbooks of UPMXlsxImporterBenchmarkCommandlet.
+ */
+class FPMXlsxWorkbookWriter
+{
+public:
+	// Adds a worksheet of NumRows rows, the first one being row 1. MakeRow fills in the cells of each row, RowIndex is 0-based.
+	// The worksheet is compressed right away, only its strings are kept until Save.
+	void AddWorksheet(const FString& WorksheetName, int32 NumRows, TFunctionRef<void(int32 RowIndex, FPMXlsxRow& OutRow)> MakeRow);
+
+	// Writes the workbook and the shared strings of all worksheets. Call once, after all worksheets were added.
+	bool Save(const FString& AbsoluteFilePath, FString& OutError);
+
+private:
+	int32 AddSharedString(const FString& Value);
+
+	FPMXlsxZipWriter Archive;
+	TArray<FString> WorksheetNames;
+	TArray<FString> SharedStrings;
+	TMap<FString, int32> SharedStringIndices;
+};
@@ -0,0 +1,915 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+
+#include "PMXlsxWorksheetData.h"
+
+#include "Containers/StringView.h"
+#include "Dom/JsonObject.h"
+#include "Dom/JsonValue.h"
+#include "Misc/Base64.h"
+#include "Misc/SecureHash.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace
+{
+	const uint8 BinaryMagic[] = { 'P', 'M', 'X', 'B' };
+	const uint32 BinaryVersion = 1;
+
+	// The string table must keep strings that only differ in case apart. Keyed by views of the strings in the table, so that strings
+	// can be looked up without being copied into an FString first.
+	struct FCaseSensitiveStringViewKeyFuncs : TDefaultMapHashableKeyFuncs<FStringView, int32, false>
+	{
+		static FORCEINLINE bool Matches(FStringView A, FStringView B)
+		{
+			return A.Equals(B, ESearchCase::CaseSensitive);
+		}
+
+		static FORCEINLINE uint32 GetKeyHash(FStringView Key)
+		{
+			return FCrc::MemCrc32(Key.GetData(), Key.Len() * sizeof(TCHAR));
+		}
+	};
+
+	class FBinaryWriter
+	{
+	public:
+		void WriteUInt8(uint8 Value)
+		{
+			Bytes.Add(Value);
+		}
+
+		void WriteUInt32(uint32 Value)
+		{
+			for (int32 Shift = 0; Shift < 32; Shift += 8)
+			{
+				Bytes.Add((Value >> Shift) & 0xFF);
+			}
+		}
+
+		void WriteDouble(double Value)
+		{
+			uint64 Bits;
+			FMemory::Memcpy(&Bits, &Value, sizeof(Bits));
+			for (int32 Shift = 0; Shift < 64; Shift += 8)
+			{
+				Bytes.Add((Bits >> Shift) & 0xFF);
+			}
+		}
+
+		void WriteString(FStringView Value)
+		{
+			WriteUInt32(AddString(Value));
+		}
+
+		uint32 AddString(FStringView Value)
+		{
+			if (const int32* Index = StringIndices.Find(Value))
+			{
+				return *Index;
+			}
+			// Moving the table's strings when it grows keeps their characters where they are, so the key can point to them
+			const int32 Index = Strings.Emplace(Value.Len(), Value.GetData());
+			StringIndices.Add(FStringView(Strings[Index]), Index);
+			return Index;
+		}
+
+		int32 Num() const
+		{
+			return Bytes.Num();
+		}
+
+		// Header and string table followed by the columns written so far
+		TArray<uint8> Finish(int32 RowCount, int32 ColumnCount) const
+		{
+			FBinaryWriter Header;
+			Header.Bytes.Append(BinaryMagic, UE_ARRAY_COUNT(BinaryMagic));
+			Header.WriteUInt32(BinaryVersion);
+			Header.WriteUInt32(RowCount);
+			Header.WriteUInt32(ColumnCount);
+			Header.WriteUInt32(Strings.Num());
+			for (const FString& String : Strings)
+			{
+				const FTCHARToUTF8 Converter(*String);
+				Header.WriteUInt32(Converter.Length());
+				Header.Bytes.Append(reinterpret_cast<const uint8*>(Converter.Get()), Converter.Length());
+			}
+			Header.Bytes.Append(Bytes);
+			return MoveTemp(Header.Bytes);
+		}
+
+		// The values and the string table written so far, without a header
+		TArray<uint8> TakeBytes()
+		{
+			return MoveTemp(Bytes);
+		}
+
+		TArray<FString> TakeStrings()
+		{
+			StringIndices.Empty();
+			return MoveTemp(Strings);
+		}
+
+	private:
+		TArray<uint8> Bytes;
+		TArray<FString> Strings;
+		TMap<FStringView, int32, FDefaultSetAllocator, FCaseSensitiveStringViewKeyFuncs> StringIndices;
+	};
+
+	// Finds where each element of a json array starts and ends in one pass, without parsing the elements.
+	// Only checks that brackets and strings are closed; an element with invalid json is found when it is parsed.
+	bool FindJsonArrayElements(const FString& Json, TArray<TPair<int32, int32>>& OutElements, FString& OutError)
+	{
+		const TCHAR* Chars = *Json;
+		const int32 Len = Json.Len();
+
+		int32 Index = 0;
+		while (Index < Len && FChar::IsWhitespace(Chars[Index]))
+		{
+			++Index;
+		}
+		if (Index == Len || Chars[Index] != TEXT('['))
+		{
+			OutError = TEXT("worksheet data is not a json array");
+			return false;
+		}
+
+		int32 Depth = 0;
+		int32 ElementStart = INDEX_NONE;
+		int32 ElementEnd = INDEX_NONE;
+		bool bInString = false;
+		bool bExpectElement = false;
+		const auto FinishElement = [&]()
+		{
+			if (ElementStart == INDEX_NONE)
+			{
+				OutError = FString::Printf(TEXT("row %i of the worksheet data is empty"), OutElements.Num());
+				return false;
+			}
+			OutElements.Emplace(ElementStart, ElementEnd - ElementStart);
+			ElementStart = INDEX_NONE;
+			return true;
+		};
+
+		for (++Index; Index < Len; ++Index)
+		{
+			const TCHAR Char = Chars[Index];
+			if (bInString)
+			{
+				if (Char == TEXT('\\'))
+				{
+					++Index;
+				}
+				else if (Char == TEXT('"'))
+				{
+					bInString = false;
+					ElementEnd = Index + 1;
+				}
+				continue;
+			}
+
+			if (FChar::IsWhitespace(Char))
+			{
+				continue;
+			}
+
+			if (Depth == 0 && (Char == TEXT(',') || Char == TEXT(']')))
+			{
+				if (Char == TEXT(']') && ElementStart == INDEX_NONE && !bExpectElement)
+				{
+					return true; // empty array
+				}
+				if (!FinishElement())
+				{
+					return false;
+				}
+				if (Char == TEXT(']'))
+				{
+					return true;
+				}
+				bExpectElement = true;
+				continue;
+			}
+
+			if (ElementStart == INDEX_NONE)
+			{
+				ElementStart = Index;
+			}
+			ElementEnd = Index + 1;
+
+			if (Char == TEXT('"'))
+			{
+				bInString = true;
+			}
+			else if (Char == TEXT('{') || Char == TEXT('['))
+			{
+				++Depth;
+			}
+			else if (Char == TEXT('}') || Char == TEXT(']'))
+			{
+				--Depth;
+			}
+		}
+
+		OutError = TEXT("worksheet data ends before its json array is closed");
+		return false;
+	}
+
+	// Reads from a byte array with bounds checking. Once a read fails, all further reads fail.
+	class FBinaryReader
+	{
+	public:
+		explicit FBinaryReader(const TArray<uint8>& InBytes)
+			: Bytes(InBytes)
+		{
+		}
+
+		bool HasError() const { return bError; }
+		int32 GetOffset() const { return Offset; }
+
+		bool Skip(int64 Count)
+		{
+			if (bError || Count < 0 || Offset + Count > Bytes.Num())
+			{
+				bError = true;
+				return false;
+			}
+			Offset += static_cast<int32>(Count);
+			return true;
+		}
+
+		uint8 ReadUInt8()
+		{
+			const int32 Start = Offset;
+			return Skip(1) ? Bytes[Start] : 0;
+		}
+
+		uint32 ReadUInt32()
+		{
+			const int32 Start = Offset;
+			return Skip(4) ? ReadUInt32At(Bytes, Start) : 0;
+		}
+
+		static uint32 ReadUInt32At(const TArray<uint8>& Bytes, int32 Offset)
+		{
+			return uint32(Bytes[Offset]) | (uint32(Bytes[Offset + 1]) << 8) | (uint32(Bytes[Offset + 2]) << 16) | (uint32(Bytes[Offset + 3]) << 24);
+		}
+
+		static double ReadDoubleAt(const TArray<uint8>& Bytes, int32 Offset)
+		{
+			const uint64 Bits = uint64(ReadUInt32At(Bytes, Offset)) | (uint64(ReadUInt32At(Bytes, Offset + 4)) << 32);
+			double Value;
+			FMemory::Memcpy(&Value, &Bits, sizeof(Value));
+			return Value;
+		}
+
+	private:
+		const TArray<uint8>& Bytes;
+		int32 Offset = 0;
+		bool bError = false;
+	};
+
+	// Calls Function with a json value of the same type and value as Cell, made on the stack. Returns false for arrays, objects and
+	// missing values, which don't convert to anything.
+	template <typename FunctionType>
+	bool ConvertLikeJsonValue(const FPMXlsxCellValue& Cell, FunctionType Function)
+	{
+		switch (Cell.Type)
+		{
+		case EJson::Null:
+			return Function(FJsonValueNull());
+		case EJson::String:
+			return Function(FJsonValueString(*Cell.String));
+		case EJson::Number:
+			return Function(FJsonValueNumber(Cell.Number));
+		case EJson::Boolean:
+			return Function(FJsonValueBoolean(Cell.bBool));
+		default:
+			return false;
+		}
+	}
+
+	// Skips the rest of an array or object whose start Reader just read. Returns false if it is not valid json.
+	bool SkipJsonValue(TJsonReader<TCHAR>& Reader)
+	{
+		int32 Depth = 1;
+		EJsonNotation Notation;
+		while (Depth > 0 && Reader.ReadNext(Notation))
+		{
+			if (Notation == EJsonNotation::ArrayStart || Notation == EJsonNotation::ObjectStart)
+			{
+				++Depth;
+			}
+			else if (Notation == EJsonNotation::ArrayEnd || Notation == EJsonNotation::ObjectEnd)
+			{
+				--Depth;
+			}
+		}
+		return Depth == 0;
+	}
+
+	// Returns the value shared by every row holding it, made the first time it's needed
+	template <typename ValueType, typename... ArgTypes>
+	const TSharedPtr<FJsonValue>& FindOrMakeSharedValue(TSharedPtr<FJsonValue>& SharedValue, ArgTypes&&... Args)
+	{
+		if (!SharedValue.IsValid())
+		{
+			SharedValue = MakeShared<ValueType>(Forward<ArgTypes>(Args)...);
+		}
+		return SharedValue;
+	}
+
+	FString SerializeCondensed(const TSharedPtr<FJsonValue>& Value)
+	{
+		FString Result;
+		const TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> JsonWriter = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Result);
+		if (Value->Type == EJson::Array)
+		{
+			FJsonSerializer::Serialize(Value->AsArray(), JsonWriter);
+		}
+		else
+		{
+			FJsonSerializer::Serialize(Value->AsObject().ToSharedRef(), JsonWriter);
+		}
+		return Result;
+	}
+}
+
+const FString* FPMXlsxCellValue::TryGetString(FString& Scratch) const
+{
+	if (Type == EJson::String)
+	{
+		return String;
+	}
+	return ConvertLikeJsonValue(*this, [&Scratch](const FJsonValue& Value) { return Value.TryGetString(Scratch); }) ? &Scratch : nullptr;
+}
+
+bool FPMXlsxCellValue::TryGetNumber(double& OutNumber) const
+{
+	if (Type == EJson::Number)
+	{
+		OutNumber = Number;
+		return true;
+	}
+	return ConvertLikeJsonValue(*this, [&OutNumber](const FJsonValue& Value) { return Value.TryGetNumber(OutNumber); });
+}
+
+bool FPMXlsxCellValue::TryGetNumber(int64& OutNumber) const
+{
+	// Rounds like FJsonValue does
+	return ConvertLikeJsonValue(*this, [&OutNumber](const FJsonValue& Value) { return Value.TryGetNumber(OutNumber); });
+}
+
+bool FPMXlsxCellValue::TryGetBool(bool& OutBool) const
+{
+	if (Type == EJson::Boolean)
+	{
+		OutBool = bBool;
+		return true;
+	}
+	return ConvertLikeJsonValue(*this, [&OutBool](const FJsonValue& Value) { return Value.TryGetBool(OutBool); });
+}
+
+FString FPMXlsxWorksheetData::EncodeBinary(const TArray<FString>& ColumnNames, const TArray<TSharedPtr<FJsonValue>>& Rows)
+{
+	FBinaryWriter Writer;
+	TArray<TSharedPtr<FJsonValue>> Values;
+	Values.Reserve(Rows.Num());
+	for (const FString& ColumnName : ColumnNames)
+	{
+		Values.Reset();
+		bool bAllNumbers = true;
+		bool bAllBools = true;
+		for (const TSharedPtr<FJsonValue>& Row : Rows)
+		{
+			const TSharedPtr<FJsonObject>* RowObject = nullptr;
+			TSharedPtr<FJsonValue> Value = Row.IsValid() && Row->TryGetObject(RowObject) ? (*RowObject)->TryGetField(ColumnName) : nullptr;
+			if (!Value.IsValid())
+			{
+				Value = MakeShared<FJsonValueNull>();
+			}
+			bAllNumbers &= Value->Type == EJson::Number;
+			bAllBools &= Value->Type == EJson::Boolean;
+			Values.Add(MoveTemp(Value));
+		}
+
+		const EColumnType ColumnType = bAllBools ? EColumnType::Bool : bAllNumbers ? EColumnType::Number : EColumnType::Variant;
+		Writer.WriteString(ColumnName);
+		Writer.WriteUInt8(static_cast<uint8>(ColumnType));
+		for (const TSharedPtr<FJsonValue>& Value : Values)
+		{
+			switch (ColumnType)
+			{
+			case EColumnType::Number:
+				Writer.WriteDouble(Value->AsNumber());
+				break;
+			case EColumnType::Bool:
+				Writer.WriteUInt8(Value->AsBool() ? 1 : 0);
+				break;
+			case EColumnType::Variant:
+				switch (Value->Type)
+				{
+				case EJson::Boolean:
+					Writer.WriteUInt8(static_cast<uint8>(Value->AsBool() ? EValueType::True : EValueType::False));
+					break;
+				case EJson::Number:
+					Writer.WriteUInt8(static_cast<uint8>(EValueType::Number));
+					Writer.WriteDouble(Value->AsNumber());
+					break;
+				case EJson::String:
+					Writer.WriteUInt8(static_cast<uint8>(EValueType::String));
+					Writer.WriteString(Value->AsString());
+					break;
+				case EJson::Array:
+				case EJson::Object:
+					Writer.WriteUInt8(static_cast<uint8>(EValueType::Json));
+					Writer.WriteString(SerializeCondensed(Value));
+					break;
+				default:
+					Writer.WriteUInt8(static_cast<uint8>(EValueType::Null));
+					break;
+				}
+				break;
+			}
+		}
+	}
+
+	return FBase64::Encode(Writer.Finish(Rows.Num(), ColumnNames.Num()));
+}
+
+bool FPMXlsxWorksheetData::Read(const FPMXlsxImporterPythonBridgeJsonString& Data, FString& OutError)
+{
+	if (!Data.BinaryData.IsEmpty())
+	{
+		return ReadBinary(Data.BinaryData, OutError);
+	}
+
+	JsonString = Data.JsonString;
+	return ReadJson(OutError);
+}
+
+bool FPMXlsxWorksheetData::ReadJson(FString& OutError)
+{
+	if (!FindJsonArrayElements(JsonString, JsonRowSpans, OutError))
+	{
+		return false;
+	}
+	RowCount = JsonRowSpans.Num();
+	InvalidJsonRows.Init(false, RowCount);
+
+	// Each key becomes a variant column the first time a row has it. Rows usually have the same keys in the same order,
+	// so a key is compared with the column at its position before it is looked up.
+	TMap<FString, int32> ColumnIndices;
+	const auto FindOrAddColumn = [this, &ColumnIndices](const FString& Key, int32 FieldIndex, int32 RowIndex) -> FColumn&
+	{
+		if (Columns.IsValidIndex(FieldIndex) && Columns[FieldIndex].Name.Equals(Key, ESearchCase::IgnoreCase))
+		{
+			return Columns[FieldIndex];
+		}
+		if (const int32* ColumnIndex = ColumnIndices.Find(Key))
+		{
+			return Columns[*ColumnIndex];
+		}
+
+		ColumnIndices.Add(Key, Columns.Num());
+		FColumn& Column = Columns.AddDefaulted_GetRef();
+		Column.Name = Key;
+		Column.VariantOffsets.Reserve(RowCount);
+		Column.VariantOffsets.Init(INDEX_NONE, RowIndex + 1);
+		return Column;
+	};
+
+	FBinaryWriter Writer;
+	const auto ReadRow = [this, &Writer, &FindOrAddColumn](int32 RowIndex)
+	{
+		const TCHAR* RowChars = *JsonString + JsonRowSpans[RowIndex].Key;
+		FPMXlsxJsonStringViewReader Reader(RowChars, JsonRowSpans[RowIndex].Value);
+		EJsonNotation Notation;
+		if (!Reader.ReadNext(Notation) || Notation != EJsonNotation::ObjectStart)
+		{
+			return false;
+		}
+
+		for (int32 FieldIndex = 0; Reader.ReadNext(Notation); ++FieldIndex)
+		{
+			if (Notation == EJsonNotation::ObjectEnd)
+			{
+				return true;
+			}
+
+			FColumn& Column = FindOrAddColumn(Reader.GetIdentifier(), FieldIndex, RowIndex);
+			const int32 Offset = Writer.Num();
+			switch (Notation)
+			{
+			case EJsonNotation::String:
+				Writer.WriteUInt8(static_cast<uint8>(EValueType::String));
+				Writer.WriteString(Reader.GetValueAsString());
+				break;
+			case EJsonNotation::Number:
+				Writer.WriteUInt8(static_cast<uint8>(EValueType::Number));
+				Writer.WriteDouble(Reader.GetValueAsNumber());
+				break;
+			case EJsonNotation::Boolean:
+				Writer.WriteUInt8(static_cast<uint8>(Reader.GetValueAsBoolean() ? EValueType::True : EValueType::False));
+				break;
+			case EJsonNotation::Null:
+				Writer.WriteUInt8(static_cast<uint8>(EValueType::Null));
+				break;
+			case EJsonNotation::ArrayStart:
+			case EJsonNotation::ObjectStart:
+				{
+					// Kept as the json text it was sent as, with the same text of every row sharing a string
+					const int32 Start = Reader.GetCharOffset() - 1;
+					if (!SkipJsonValue(Reader))
+					{
+						return false;
+					}
+					Writer.WriteUInt8(static_cast<uint8>(EValueType::Json));
+					Writer.WriteString(FStringView(RowChars + Start, Reader.GetCharOffset() - Start));
+				}
+				break;
+			default:
+				return false;
+			}
+			// The last value wins if a row has the same key twice, like in a json object
+			Column.VariantOffsets[RowIndex] = Offset;
+		}
+		return false;
+	};
+
+	for (int32 RowIndex = 0; RowIndex < RowCount; ++RowIndex)
+	{
+		for (FColumn& Column : Columns)
+		{
+			Column.VariantOffsets.Add(INDEX_NONE);
+		}
+
+		if (!ReadRow(RowIndex))
+		{
+			InvalidJsonRows[RowIndex] = true;
+			for (FColumn& Column : Columns)
+			{
+				Column.VariantOffsets[RowIndex] = INDEX_NONE;
+			}
+		}
+	}
+
+	Binary = Writer.TakeBytes();
+	Strings = Writer.TakeStrings();
+	return true;
+}
+
+bool FPMXlsxWorksheetData::ReadBinary(const FString& BinaryData, FString& OutError)
+{
+	if (!FBase64::Decode(BinaryData, Binary))
+	{
+		OutError = TEXT("binary data is not valid base64");
+		return false;
+	}
+
+	FBinaryReader Reader(Binary);
+	if (!Reader.Skip(UE_ARRAY_COUNT(BinaryMagic)) || FMemory::Memcmp(Binary.GetData(), BinaryMagic, UE_ARRAY_COUNT(BinaryMagic)) != 0)
+	{
+		OutError = TEXT("binary data has no PMXB header");
+		return false;
+	}
+
+	const uint32 Version = Reader.ReadUInt32();
+	if (Version != BinaryVersion)
+	{
+		OutError = FString::Printf(TEXT("binary data has version %u, expect %u"), Version, BinaryVersion);
+		return false;
+	}
+
+	const uint32 NumRows = Reader.ReadUInt32();
+	const uint32 NumColumns = Reader.ReadUInt32();
+	const uint32 NumStrings = Reader.ReadUInt32();
+	// Every string and column takes at least 4 bytes, so larger counts can only come from corrupt data
+	if (Reader.HasError() || NumRows > MAX_int32 || NumStrings > uint32(Binary.Num()) / 4 || NumColumns > uint32(Binary.Num()) / 4)
+	{
+		OutError = TEXT("binary data is truncated");
+		return false;
+	}
+
+	Strings.Reserve(NumStrings);
+	for (uint32 StringIndex = 0; StringIndex < NumStrings; ++StringIndex)
+	{
+		const uint32 ByteCount = Reader.ReadUInt32();
+		const int32 StringOffset = Reader.GetOffset();
+		if (!Reader.Skip(ByteCount))
+		{
+			OutError = TEXT("binary data is truncated");
+			return false;
+		}
+		const FUTF8ToTCHAR Converter(reinterpret_cast<const ANSICHAR*>(Binary.GetData() + StringOffset), ByteCount);
+		Strings.Emplace(Converter.Length(), Converter.Get());
+	}
+
+	const auto IsValidStringIndex = [this](uint32 Index)
+	{
+		return Index < uint32(Strings.Num());
+	};
+
+	Columns.Reserve(NumColumns);
+	for (uint32 ColumnIndex = 0; ColumnIndex < NumColumns; ++ColumnIndex)
+	{
+		FColumn& Column = Columns.AddDefaulted_GetRef();
+		const uint32 NameIndex = Reader.ReadUInt32();
+		const uint8 ColumnType = Reader.ReadUInt8();
+		if (Reader.HasError() || !IsValidStringIndex(NameIndex) || ColumnType > static_cast<uint8>(EColumnType::Variant))
+		{
+			OutError = FString::Printf(TEXT("binary data has an invalid column %u"), ColumnIndex);
+			return false;
+		}
+
+		Column.Name = Strings[NameIndex];
+		Column.Type = static_cast<EColumnType>(ColumnType);
+		Column.ValuesOffset = Reader.GetOffset();
+
+		bool bValid = true;
+		switch (Column.Type)
+		{
+		case EColumnType::Number:
+			bValid = Reader.Skip(int64(NumRows) * sizeof(double));
+			break;
+		case EColumnType::Bool:
+			bValid = Reader.Skip(NumRows);
+			break;
+		case EColumnType::Variant:
+			Column.VariantOffsets.Reserve(NumRows);
+			for (uint32 RowIndex = 0; RowIndex < NumRows && bValid; ++RowIndex)
+			{
+				Column.VariantOffsets.Add(Reader.GetOffset());
+				const uint8 ValueType = Reader.ReadUInt8();
+				switch (static_cast<EValueType>(ValueType))
+				{
+				case EValueType::Null:
+				case EValueType::False:
+				case EValueType::True:
+					break;
+				case EValueType::Number:
+					Reader.Skip(sizeof(double));
+					break;
+				case EValueType::String:
+				case EValueType::Json:
+					bValid = IsValidStringIndex(Reader.ReadUInt32());
+					break;
+				default:
+					bValid = false;
+					break;
+				}
+				bValid &= !Reader.HasError();
+			}
+			break;
+		}
+
+		if (!bValid)
+		{
+			OutError = FString::Printf(TEXT("binary data has an invalid value in column %s"), *Column.Name);
+			return false;
+		}
+	}
+
+	RowCount = NumRows;
+	return true;
+}
+
+bool FPMXlsxWorksheetData::IsRowValid(int32 RowIndex, FString& OutError) const
+{
+	if (InvalidJsonRows.Num() > 0 && InvalidJsonRows[RowIndex])
+	{
+		OutError = FString::Printf(TEXT("Row '%d' is not a valid JSON object."), RowIndex);
+		return false;
+	}
+	return true;
+}
+
+int32 FPMXlsxWorksheetData::FindColumn(const FString& ColumnName) const
+{
+	return Columns.IndexOfByPredicate([&ColumnName](const FColumn& Column) { return Column.Name.Equals(ColumnName, ESearchCase::IgnoreCase); });
+}
+
+FPMXlsxCellValue FPMXlsxWorksheetData::GetValue(int32 RowIndex, int32 ColumnIndex) const
+{
+	const FColumn& Column = Columns[ColumnIndex];
+	FPMXlsxCellValue Value;
+	switch (Column.Type)
+	{
+	case EColumnType::Number:
+		Value.Type = EJson::Number;
+		Value.Number = FBinaryReader::ReadDoubleAt(Binary, Column.ValuesOffset + RowIndex * static_cast<int32>(sizeof(double)));
+		return Value;
+	case EColumnType::Bool:
+		Value.Type = EJson::Boolean;
+		Value.bBool = Binary[Column.ValuesOffset + RowIndex] != 0;
+		return Value;
+	default:
+		break;
+	}
+
+	const int32 Offset = Column.VariantOffsets[RowIndex];
+	if (Offset == INDEX_NONE)
+	{
+		return Value;
+	}
+
+	switch (static_cast<EValueType>(Binary[Offset]))
+	{
+	case EValueType::False:
+	case EValueType::True:
+		Value.Type = EJson::Boolean;
+		Value.bBool = static_cast<EValueType>(Binary[Offset]) == EValueType::True;
+		break;
+	case EValueType::Number:
+		Value.Type = EJson::Number;
+		Value.Number = FBinaryReader::ReadDoubleAt(Binary, Offset + 1);
+		break;
+	case EValueType::String:
+		Value.Type = EJson::String;
+		Value.String = &Strings[FBinaryReader::ReadUInt32At(Binary, Offset + 1)];
+		break;
+	case EValueType::Json:
+		Value.String = &Strings[FBinaryReader::ReadUInt32At(Binary, Offset + 1)];
+		Value.Type = Value.String->StartsWith(TEXT("["), ESearchCase::CaseSensitive) ? EJson::Array : EJson::Object;
+		break;
+	default:
+		Value.Type = EJson::Null;
+		break;
+	}
+	return Value;
+}
+
+TSharedPtr<FJsonValue> FPMXlsxWorksheetData::MakeValue(const FPMXlsxCellValue& Value) const
+{
+	switch (Value.Type)
+	{
+	case EJson::Number:
+		{
+			uint64 Bits;
+			FMemory::Memcpy(&Bits, &Value.Number, sizeof(Bits));
+			return FindOrMakeSharedValue<FJsonValueNumber>(NumberValues.FindOrAdd(Bits), Value.Number);
+		}
+	case EJson::Boolean:
+		return Value.bBool ? FindOrMakeSharedValue<FJsonValueBoolean>(TrueValue, true) : FindOrMakeSharedValue<FJsonValueBoolean>(FalseValue, false);
+	case EJson::String:
+		if (StringValues.Num() == 0)
+		{
+			StringValues.SetNum(Strings.Num());
+		}
+		return FindOrMakeSharedValue<FJsonValueString>(StringValues[UE_PTRDIFF_TO_INT32(Value.String - Strings.GetData())], *Value.String);
+	case EJson::Array:
+	case EJson::Object:
+		{
+			TSharedPtr<FJsonValue> JsonValue;
+			const TSharedRef<TJsonReader<TCHAR>> JsonReader = MakeShared<FPMXlsxJsonStringViewReader>(**Value.String, Value.String->Len());
+			if (FJsonSerializer::Deserialize(JsonReader, JsonValue) && JsonValue.IsValid())
+			{
+				return JsonValue;
+			}
+			return nullptr;
+		}
+	default:
+		return FindOrMakeSharedValue<FJsonValueNull>(NullValue);
+	}
+}
+
+TSharedPtr<FJsonObject> FPMXlsxWorksheetData::MakeRowObject(int32 RowIndex, FString& OutError) const
+{
+	if (!IsRowValid(RowIndex, OutError))
+	{
+		return nullptr;
+	}
+
+	TSharedRef<FJsonObject> RowObject = MakeShared<FJsonObject>();
+	RowObject->Values.Reserve(Columns.Num());
+	for (int32 ColumnIndex = 0; ColumnIndex < Columns.Num(); ++ColumnIndex)
+	{
+		const FPMXlsxCellValue Cell = GetValue(RowIndex, ColumnIndex);
+		if (Cell.Type == EJson::None)
+		{
+			continue;
+		}
+
+		TSharedPtr<FJsonValue> Value = MakeValue(Cell);
+		if (!Value.IsValid())
+		{
+			OutError = FString::Printf(TEXT("Row '%d' has invalid JSON in column %s."), RowIndex, *Columns[ColumnIndex].Name);
+			return nullptr;
+		}
+		RowObject->SetField(Columns[ColumnIndex].Name, Value);
+	}
+	return RowObject;
+}
+
+bool FPMXlsxWorksheetData::TryGetRowString(int32 RowIndex, int32 ColumnIndex, FString& OutValue) const
+{
+	if (!Columns.IsValidIndex(ColumnIndex))
+	{
+		return false;
+	}
+
+	const FString* Value = GetValue(RowIndex, ColumnIndex).TryGetString(OutValue);
+	if (Value != nullptr && Value != &OutValue)
+	{
+		OutValue = *Value;
+	}
+	return Value != nullptr;
+}
+
+FString FPMXlsxWorksheetData::ComputeRowHash(int32 RowIndex, const FString& Seed) const
+{
+	FSHA1 Sha;
+	Sha.UpdateWithString(*Seed, Seed.Len());
+
+	if (!JsonString.IsEmpty())
+	{
+		// Readers write the same row the same way every time, so its text can be hashed as it is
+		const TPair<int32, int32>& Span = JsonRowSpans[RowIndex];
+		Sha.UpdateWithString(*JsonString + Span.Key, Span.Value);
+	}
+	else
+	{
+		// Hash the bytes of each value, except that strings are hashed by content since their indices depend on the rest of the worksheet
+		for (const FColumn& Column : Columns)
+		{
+			Sha.UpdateWithString(*Column.Name, Column.Name.Len());
+			const uint8 ColumnType = static_cast<uint8>(Column.Type);
+			Sha.Update(&ColumnType, sizeof(ColumnType));
+
+			switch (Column.Type)
+			{
+			case EColumnType::Number:
+				Sha.Update(Binary.GetData() + Column.ValuesOffset + RowIndex * static_cast<int32>(sizeof(double)), sizeof(double));
+				break;
+			case EColumnType::Bool:
+				Sha.Update(Binary.GetData() + Column.ValuesOffset + RowIndex, 1);
+				break;
+			case EColumnType::Variant:
+				{
+					const int32 Offset = Column.VariantOffsets[RowIndex];
+					Sha.Update(Binary.GetData() + Offset, 1);
+					switch (static_cast<EValueType>(Binary[Offset]))
+					{
+					case EValueType::Number:
+						Sha.Update(Binary.GetData() + Offset + 1, sizeof(double));
+						break;
+					case EValueType::String:
+					case EValueType::Json:
+						{
+							const FString& String = Strings[FBinaryReader::ReadUInt32At(Binary, Offset + 1)];
+							const uint32 Length = String.Len();
+							Sha.Update(reinterpret_cast<const uint8*>(&Length), sizeof(Length));
+							Sha.UpdateWithString(*String, Length);
+						}
+						break;
+					default:
+						break;
+					}
+				}
+				break;
+			}
+		}
+	}
+
+	Sha.Final();
+	FSHAHash Hash;
+	Sha.GetHash(Hash.Hash);
+	return Hash.ToString();
+}
+
+FString FPMXlsxWorksheetData::MakeJsonString(bool bPretty) const
+{
+	if (!JsonString.IsEmpty() && !bPretty)
+	{
+		return JsonString;
+	}
+
+	return bPretty ? WriteJsonRows<TPrettyJsonPrintPolicy<TCHAR>>() : WriteJsonRows<TCondensedJsonPrintPolicy<TCHAR>>();
+}
+
+template <class PrintPolicy>
+FString FPMXlsxWorksheetData::WriteJsonRows() const
+{
+	FString Result;
+	const TSharedRef<TJsonWriter<TCHAR, PrintPolicy>> JsonWriter = TJsonWriterFactory<TCHAR, PrintPolicy>::Create(&Result);
+	JsonWriter->WriteArrayStart();
+	for (int32 RowIndex = 0; RowIndex < RowCount; ++RowIndex)
+	{
+		FString Error;
+		const TSharedPtr<FJsonObject> RowObject = MakeRowObject(RowIndex, Error);
+		if (RowObject.IsValid())
+		{
+			FJsonSerializer::Serialize(RowObject.ToSharedRef(), JsonWriter, false);
+		}
+		else
+		{
+			JsonWriter->WriteNull();
+		}
+	}
+	JsonWriter->WriteArrayEnd();
+	JsonWriter->Close();
+	return Result;
+}
@@ -0,0 +1,175 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PMXlsxImporterPythonBridge.h"
+#include "Serialization/BufferReader.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonTypes.h"
+
+class FJsonObject;
+class FJsonValue;
+
+/**
+ * One value of a worksheet row, read straight from the worksheet data instead of being made into a json value.
+ * Converts the same way as the json value of its type. Points into the worksheet data, which must outlive it.
+ */
+struct FPMXlsxCellValue
+{
+	// None if the row has no value in the column
+	EJson Type = EJson::None;
+	bool bBool = false;
+	double Number = 0.0;
+	// The string of a String, or the condensed json of an Array or Object
+	const FString* String = nullptr;
+
+	// Returns a String as it is, or converts other values into Scratch. Returns nullptr if the value has no string.
+	const FString* TryGetString(FString& Scratch) const;
+	bool TryGetNumber(double& OutNumber) const;
+	bool TryGetNumber(int64& OutNumber) const;
+	bool TryGetBool(bool& OutBool) const;
+};
+
+/**
+ * Reads json from characters in place, where TJsonStringReader would copy them into a string of its own first.
+ * Made on the stack, the characters must outlive it.
+ */
+class FPMXlsxJsonStringViewReader : public TJsonReader<TCHAR>
+{
+public:
+	FPMXlsxJsonStringViewReader(const TCHAR* Chars, int32 Len)
+		: Archive(const_cast<TCHAR*>(Chars), Len * sizeof(TCHAR), false)
+	{
+		Stream = &Archive;
+	}
+
+	// Number of characters read so far. Right after ReadNext returns the start or end of an array or object, the bracket is the last one read.
+	int32 GetCharOffset() { return static_cast<int32>(Archive.Tell() / sizeof(TCHAR)); }
+
+private:
+	FBufferReader Archive;
+};
+
+/**
+ * The rows of a worksheet as sent by a reader in FPMXlsxImporterPythonBridgeJsonString.
+ *
+ * Readers send either a json array of row objects (JsonString, for debugging) or, by default, a compact binary format
+ * (BinaryData, base64 encoded) which stores the worksheet column by column, one column per top field. All numbers are little endian:
+ *
+ *   "PMXB", uint32 Version, uint32 RowCount, uint32 ColumnCount, uint32 StringCount
+ *   StringCount x (uint32 ByteCount, UTF-8 bytes)                      deduplicated string table
+ *   ColumnCount x (uint32 NameStringIndex, uint8 ColumnType, values)
+ *     Number:  RowCount x double
+ *     Bool:    RowCount x uint8
+ *     Variant: RowCount x (uint8 ValueType, payload)                   Null, False and True have no payload, Number has a double,
+ *                                                                      String and Json have the uint32 index of a string.
+ *                                                                      Json strings hold an array or object as condensed json.
+ *
+ * Neither format is turned into a json DOM. Json data is read into the same columns as binary data, one variant column per key,
+ * in a single pass that streams the tokens of each row: its strings go into the string table, arrays and objects are kept as their
+ * json text there, and a row with invalid json is reported when it is used. Either way values are read in place by column (GetValue),
+ * and a row's FJsonObject is only built when asked for. Those share their string, number, bool and null values, so a row only
+ * allocates its objects and arrays.
+ * pm_xlsx_columnar.py is the Python encoder.
+ */
+class FPMXlsxWorksheetData
+{
+public:
+	// Encodes Rows, json objects keyed by ColumnNames, in the binary format. Returns the base64 encoded data.
+	static FString EncodeBinary(const TArray<FString>& ColumnNames, const TArray<TSharedPtr<FJsonValue>>& Rows);
+
+	// Returns false and sets OutError if Data holds neither valid binary data nor a valid json array
+	bool Read(const FPMXlsxImporterPythonBridgeJsonString& Data, FString& OutError);
+
+	int32 Num() const { return RowCount; }
+
+	// Returns false and sets OutError if the row of json data is not a valid json object. Its values are all missing then.
+	bool IsRowValid(int32 RowIndex, FString& OutError) const;
+
+	int32 NumColumns() const { return Columns.Num(); }
+	const FString& GetColumnName(int32 ColumnIndex) const { return Columns[ColumnIndex].Name; }
+
+	// Returns the index of the column named ColumnName, ignoring case like json keys do, or INDEX_NONE
+	int32 FindColumn(const FString& ColumnName) const;
+
+	// The value is None if the row has no value in the column
+	FPMXlsxCellValue GetValue(int32 RowIndex, int32 ColumnIndex) const;
+
+	// Returns nullptr and sets OutError if the row is not a json object, or has invalid json in a column.
+	// Rows share values made on first use, so only call this from one thread at a time.
+	TSharedPtr<FJsonObject> MakeRowObject(int32 RowIndex, FString& OutError) const;
+
+	// Reads a single value of a row as a string without building the row's FJsonObject. Returns false if the row has no value in the column
+	bool TryGetRowString(int32 RowIndex, int32 ColumnIndex, FString& OutValue) const;
+
+	// Hash of the values of a row, the same in every import run as long as the row does not change. Seed is hashed first.
+	// The hash of a row differs between binary and json data.
+	FString ComputeRowHash(int32 RowIndex, const FString& Seed) const;
+
+	// All rows as a json array, the same as UDataTable::CreateTableFromJSONString reads, for json debug dumps. Indented if bPretty is true
+	FString MakeJsonString(bool bPretty = false) const;
+
+private:
+	enum class EColumnType : uint8
+	{
+		Number,
+		Bool,
+		Variant
+	};
+
+	enum class EValueType : uint8
+	{
+		Null,
+		False,
+		True,
+		Number,
+		String,
+		Json
+	};
+
+	struct FColumn
+	{
+		FString Name;
+		EColumnType Type = EColumnType::Variant;
+		// Offset of the first value in Binary
+		int32 ValuesOffset = 0;
+		// Offset of each row's value in Binary, only used by variant columns since their values differ in size
+		TArray<int32> VariantOffsets;
+	};
+
+	// Returns nullptr if Value is json that can't be parsed
+	TSharedPtr<FJsonValue> MakeValue(const FPMXlsxCellValue& Value) const;
+
+	template <class PrintPolicy>
+	FString WriteJsonRows() const;
+
+	bool ReadBinary(const FString& BinaryData, FString& OutError);
+
+	// Reads the rows of JsonString into variant columns
+	bool ReadJson(FString& OutError);
+
+	int32 RowCount = 0;
+
+	// Json data, kept since rows of json data are hashed as they were sent
+	FString JsonString;
+	// Start and length of each row in JsonString
+	TArray<TPair<int32, int32>> JsonRowSpans;
+	// Rows of JsonString that are not valid json objects
+	TBitArray<> InvalidJsonRows;
+
+	// The values of all columns. For json data, Binary only holds the values and Strings the strings of the rows.
+	TArray<uint8> Binary;
+	TArray<FString> Strings;
+	TArray<FColumn> Columns;
+
+	// Values that rows share instead of allocating their own, made the first time a row uses them and freed with the data.
+	// Json values can't be changed once made, so every row holding the same string, number, bool or null can point to the same one.
+	// One per string of the string table, null until a row uses it as a string value
+	mutable TArray<TSharedPtr<FJsonValue>> StringValues;
+	// By the bits of the number
+	mutable TMap<uint64, TSharedPtr<FJsonValue>> NumberValues;
+	mutable TSharedPtr<FJsonValue> FalseValue;
+	mutable TSharedPtr<FJsonValue> TrueValue;
+	mutable TSharedPtr<FJsonValue> NullValue;
+};
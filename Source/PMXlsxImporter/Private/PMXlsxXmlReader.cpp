@@ -0,0 +1,388 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+
+#include "PMXlsxXmlReader.h"
+
+namespace
+{
+	bool IsXmlWhitespace(uint8 Char)
+	{
+		return Char == ' ' || Char == '\t' || Char == '\r' || Char == '\n';
+	}
+
+	void AppendCodepoint(uint32 Codepoint, FString& OutText)
+	{
+		if (sizeof(TCHAR) == 2 && Codepoint > 0xFFFF)
+		{
+			Codepoint -= 0x10000;
+			OutText.AppendChar((TCHAR)(0xD800 + (Codepoint >> 10)));
+			OutText.AppendChar((TCHAR)(0xDC00 + (Codepoint & 0x3FF)));
+		}
+		else
+		{
+			OutText.AppendChar((TCHAR)Codepoint);
+		}
+	}
+
+	uint32 DigitValue(ANSICHAR Char)
+	{
+		if (Char >= '0' && Char <= '9')
+		{
+			return Char - '0';
+		}
+		if (Char >= 'a' && Char <= 'f')
+		{
+			return Char - 'a' + 10;
+		}
+		if (Char >= 'A' && Char <= 'F')
+		{
+			return Char - 'A' + 10;
+		}
+		return 0;
+	}
+
+	void AppendUTF8(const uint8* Start, int32 Len, FString& OutText)
+	{
+		if (Len > 0)
+		{
+			const FUTF8ToTCHAR Converter((const ANSICHAR*)Start, Len);
+			OutText.AppendChars(Converter.Get(), Converter.Length());
+		}
+	}
+}
+
+FPMXlsxXmlReader::FPMXlsxXmlReader(const uint8* InData, int32 InSize)
+	: Data(InData)
+	, Size(InSize)
+{
+	// Skip the UTF-8 byte order mark
+	if (Size >= 3 && Data[0] == 0xEF && Data[1] == 0xBB && Data[2] == 0xBF)
+	{
+		Pos = 3;
+	}
+}
+
+bool FPMXlsxXmlReader::Next()
+{
+	if (bPendingEndElement)
+	{
+		bPendingEndElement = false;
+		NodeType = ENodeType::EndElement;
+		--Depth;
+		return true;
+	}
+
+	while (Pos < Size)
+	{
+		if (Data[Pos] != '<')
+		{
+			Text.Start = Pos;
+			while (Pos < Size && Data[Pos] != '<')
+			{
+				++Pos;
+			}
+			Text.Len = Pos - Text.Start;
+			bTextIsCData = false;
+			NodeType = ENodeType::Text;
+			return true;
+		}
+
+		const ANSICHAR* Remaining = (const ANSICHAR*)Data + Pos;
+		const int32 RemainingSize = Size - Pos;
+		auto StartsWith = [Remaining, RemainingSize](const ANSICHAR* Prefix, int32 PrefixLen)
+		{
+			return RemainingSize >= PrefixLen && FCStringAnsi::Strncmp(Remaining, Prefix, PrefixLen) == 0;
+		};
+		auto SkipPast = [this](const ANSICHAR* Terminator, int32 TerminatorLen)
+		{
+			while (Pos + TerminatorLen <= Size && FCStringAnsi::Strncmp((const ANSICHAR*)Data + Pos, Terminator, TerminatorLen) != 0)
+			{
+				++Pos;
+			}
+			Pos = FMath::Min(Pos + TerminatorLen, Size);
+		};
+
+		if (StartsWith("<?", 2))
+		{
+			SkipPast("?>", 2);
+		}
+		else if (StartsWith("<!--", 4))
+		{
+			SkipPast("-->", 3);
+		}
+		else if (StartsWith("<![CDATA[", 9))
+		{
+			Pos += 9;
+			Text.Start = Pos;
+			SkipPast("]]>", 3);
+			Text.Len = FMath::Max(0, Pos - 3 - Text.Start);
+			bTextIsCData = true;
+			NodeType = ENodeType::Text;
+			return true;
+		}
+		else if (StartsWith("<!", 2))
+		{
+			SkipPast(">", 1);
+		}
+		else
+		{
+			return ReadTag();
+		}
+	}
+
+	NodeType = ENodeType::None;
+	return false;
+}
+
+bool FPMXlsxXmlReader::ReadTag()
+{
+	++Pos; // '<'
+	const bool bIsEndElement = Pos < Size && Data[Pos] == '/';
+	if (bIsEndElement)
+	{
+		++Pos;
+	}
+
+	Name.Start = Pos;
+	while (Pos < Size && !IsXmlWhitespace(Data[Pos]) && Data[Pos] != '>' && Data[Pos] != '/')
+	{
+		++Pos;
+	}
+	Name.Len = Pos - Name.Start;
+	Attributes.Reset();
+
+	if (bIsEndElement)
+	{
+		while (Pos < Size && Data[Pos] != '>')
+		{
+			++Pos;
+		}
+		++Pos;
+		NodeType = ENodeType::EndElement;
+		--Depth;
+		return true;
+	}
+
+	for (;;)
+	{
+		SkipWhitespace();
+		if (Pos >= Size)
+		{
+			Error = TEXT("Unexpected end of xml document");
+			NodeType = ENodeType::None;
+			return false;
+		}
+
+		if (Data[Pos] == '>')
+		{
+			++Pos;
+			break;
+		}
+
+		if (Data[Pos] == '/')
+		{
+			Pos += 2; // "/>"
+			bPendingEndElement = true;
+			break;
+		}
+
+		FAttribute& Attribute = Attributes.AddDefaulted_GetRef();
+		Attribute.Name.Start = Pos;
+		while (Pos < Size && Data[Pos] != '=' && !IsXmlWhitespace(Data[Pos]) && Data[Pos] != '>')
+		{
+			++Pos;
+		}
+		Attribute.Name.Len = Pos - Attribute.Name.Start;
+
+		SkipWhitespace();
+		if (Pos >= Size || Data[Pos] != '=')
+		{
+			Error = FString::Printf(TEXT("Malformed xml attribute at offset %i"), Pos);
+			NodeType = ENodeType::None;
+			return false;
+		}
+		++Pos;
+		SkipWhitespace();
+
+		const uint8 Quote = Pos < Size ? Data[Pos] : 0;
+		if (Quote != '"' && Quote != '\'')
+		{
+			Error = FString::Printf(TEXT("Malformed xml attribute at offset %i"), Pos);
+			NodeType = ENodeType::None;
+			return false;
+		}
+		++Pos;
+
+		Attribute.Value.Start = Pos;
+		while (Pos < Size && Data[Pos] != Quote)
+		{
+			++Pos;
+		}
+		Attribute.Value.Len = Pos - Attribute.Value.Start;
+		++Pos;
+	}
+
+	NodeType = ENodeType::StartElement;
+	++Depth;
+	return true;
+}
+
+bool FPMXlsxXmlReader::IsElement(const ANSICHAR* LocalName) const
+{
+	return (NodeType == ENodeType::StartElement || NodeType == ENodeType::EndElement) && LocalNameEquals(Name, LocalName);
+}
+
+bool FPMXlsxXmlReader::GetAttribute(const ANSICHAR* LocalName, FString& OutValue) const
+{
+	for (const FAttribute& Attribute : Attributes)
+	{
+		if (LocalNameEquals(Attribute.Name, LocalName))
+		{
+			OutValue.Reset();
+			AppendDecoded(Attribute.Value, OutValue);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FPMXlsxXmlReader::GetRawAttribute(const ANSICHAR* LocalName, const ANSICHAR*& OutValue, int32& OutLen) const
+{
+	for (const FAttribute& Attribute : Attributes)
+	{
+		if (LocalNameEquals(Attribute.Name, LocalName))
+		{
+			OutValue = (const ANSICHAR*)Data + Attribute.Value.Start;
+			OutLen = Attribute.Value.Len;
+			return true;
+		}
+	}
+	return false;
+}
+
+void FPMXlsxXmlReader::AppendText(FString& OutText) const
+{
+	if (NodeType != ENodeType::Text)
+	{
+		return;
+	}
+
+	if (bTextIsCData)
+	{
+		AppendUTF8(Data + Text.Start, Text.Len, OutText);
+	}
+	else
+	{
+		AppendDecoded(Text, OutText);
+	}
+}
+
+void FPMXlsxXmlReader::SkipElement()
+{
+	if (NodeType != ENodeType::StartElement)
+	{
+		return;
+	}
+
+	const int32 TargetDepth = Depth - 1;
+	while (Depth > TargetDepth && Next())
+	{
+	}
+}
+
+bool FPMXlsxXmlReader::LocalNameEquals(const FRange& Range, const ANSICHAR* LocalName) const
+{
+	const ANSICHAR* Start = (const ANSICHAR*)Data + Range.Start;
+	int32 Len = Range.Len;
+
+	// Strip the namespace prefix
+	for (int32 Index = Len - 1; Index >= 0; --Index)
+	{
+		if (Start[Index] == ':')
+		{
+			Start += Index + 1;
+			Len -= Index + 1;
+			break;
+		}
+	}
+
+	return FCStringAnsi::Strlen(LocalName) == Len && FCStringAnsi::Strncmp(Start, LocalName, Len) == 0;
+}
+
+void FPMXlsxXmlReader::AppendDecoded(const FRange& Range, FString& OutText) const
+{
+	const uint8* Start = Data + Range.Start;
+	const uint8* End = Start + Range.Len;
+	const uint8* SegmentStart = Start;
+
+	for (const uint8* Ptr = Start; Ptr < End; ++Ptr)
+	{
+		if (*Ptr != '&')
+		{
+			continue;
+		}
+
+		const uint8* Semicolon = Ptr + 1;
+		while (Semicolon < End && *Semicolon != ';')
+		{
+			++Semicolon;
+		}
+		if (Semicolon == End)
+		{
+			break; // Not a complete entity, keep it as text
+		}
+
+		AppendUTF8(SegmentStart, Ptr - SegmentStart, OutText);
+
+		const ANSICHAR* Entity = (const ANSICHAR*)Ptr + 1;
+		const int32 EntityLen = Semicolon - Ptr - 1;
+		if (EntityLen == 2 && FCStringAnsi::Strncmp(Entity, "lt", 2) == 0)
+		{
+			OutText.AppendChar(TEXT('<'));
+		}
+		else if (EntityLen == 2 && FCStringAnsi::Strncmp(Entity, "gt", 2) == 0)
+		{
+			OutText.AppendChar(TEXT('>'));
+		}
+		else if (EntityLen == 3 && FCStringAnsi::Strncmp(Entity, "amp", 3) == 0)
+		{
+			OutText.AppendChar(TEXT('&'));
+		}
+		else if (EntityLen == 4 && FCStringAnsi::Strncmp(Entity, "quot", 4) == 0)
+		{
+			OutText.AppendChar(TEXT('"'));
+		}
+		else if (EntityLen == 4 && FCStringAnsi::Strncmp(Entity, "apos", 4) == 0)
+		{
+			OutText.AppendChar(TEXT('\''));
+		}
+		else if (EntityLen > 1 && Entity[0] == '#')
+		{
+			const bool bHex = Entity[1] == 'x' || Entity[1] == 'X';
+			uint32 Codepoint = 0;
+			for (int32 Index = bHex ? 2 : 1; Index < EntityLen; ++Index)
+			{
+				Codepoint = Codepoint * (bHex ? 16 : 10) + DigitValue(Entity[Index]);
+			}
+			AppendCodepoint(Codepoint, OutText);
+		}
+		else
+		{
+			// Unknown entity, keep it as written
+			AppendUTF8(Ptr, Semicolon - Ptr + 1, OutText);
+		}
+
+		Ptr = Semicolon;
+		SegmentStart = Semicolon + 1;
+	}
+
+	AppendUTF8(SegmentStart, End - SegmentStart, OutText);
+}
+
+void FPMXlsxXmlReader::SkipWhitespace()
+{
+	while (Pos < Size && IsXmlWhitespace(Data[Pos]))
+	{
+		++Pos;
+	}
+}
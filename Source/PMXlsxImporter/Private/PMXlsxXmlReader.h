@@ -0,0 +1,82 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Forward-only pull parser for the UTF-8 xml parts of an xlsx file.
+ * Does not build a DOM, so a worksheet can be streamed row by row without holding more than the current element.
+ * Namespace prefixes are ignored: element and attribute names are matched by their local name.
+ */
+class FPMXlsxXmlReader
+{
+public:
+	enum class ENodeType : uint8
+	{
+		None,
+		StartElement,
+		EndElement,
+		Text
+	};
+
+	// Data must outlive the reader
+	FPMXlsxXmlReader(const uint8* InData, int32 InSize);
+
+	// Advances to the next node. Returns false at the end of the document or on a syntax error (see GetError).
+	// Empty elements such as <c/> produce a StartElement immediately followed by an EndElement.
+	bool Next();
+
+	ENodeType GetNodeType() const { return NodeType; }
+
+	// Checks the local name of the current start or end element
+	bool IsElement(const ANSICHAR* LocalName) const;
+	bool IsStartElement(const ANSICHAR* LocalName) const { return NodeType == ENodeType::StartElement && IsElement(LocalName); }
+	bool IsEndElement(const ANSICHAR* LocalName) const { return NodeType == ENodeType::EndElement && IsElement(LocalName); }
+
+	// Finds an attribute of the current start element by local name and decodes its value
+	bool GetAttribute(const ANSICHAR* LocalName, FString& OutValue) const;
+
+	// Finds an attribute without decoding or copying it. Only use for values that never contain entities, like cell references.
+	bool GetRawAttribute(const ANSICHAR* LocalName, const ANSICHAR*& OutValue, int32& OutLen) const;
+
+	// Appends the decoded content of the current text node
+	void AppendText(FString& OutText) const;
+
+	// Skips to the end element matching the current start element
+	void SkipElement();
+
+	const FString& GetError() const { return Error; }
+
+private:
+	struct FRange
+	{
+		int32 Start = 0;
+		int32 Len = 0;
+	};
+
+	struct FAttribute
+	{
+		FRange Name;
+		FRange Value;
+	};
+
+	bool ReadTag();
+	bool LocalNameEquals(const FRange& Name, const ANSICHAR* LocalName) const;
+	void AppendDecoded(const FRange& Range, FString& OutText) const;
+	void SkipWhitespace();
+
+	const uint8* Data;
+	int32 Size;
+	int32 Pos = 0;
+	int32 Depth = 0;
+
+	ENodeType NodeType = ENodeType::None;
+	FRange Name;
+	FRange Text;
+	bool bTextIsCData = false;
+	bool bPendingEndElement = false;
+	TArray<FAttribute, TInlineAllocator<8>> Attributes;
+
+	FString Error;
+};
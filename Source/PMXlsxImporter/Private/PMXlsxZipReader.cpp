@@ -0,0 +1,169 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+
+#include "PMXlsxZipReader.h"
+
+#include "Misc/Compression.h"
+
+namespace
+{
+	constexpr uint32 END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
+	constexpr uint32 CENTRAL_DIRECTORY_SIGNATURE = 0x02014b50;
+	constexpr uint32 LOCAL_HEADER_SIGNATURE = 0x04034b50;
+
+	constexpr int32 END_OF_CENTRAL_DIRECTORY_SIZE = 22;
+	constexpr int32 CENTRAL_DIRECTORY_HEADER_SIZE = 46;
+	constexpr int32 LOCAL_HEADER_SIZE = 30;
+
+	constexpr uint16 METHOD_STORED = 0;
+	constexpr uint16 METHOD_DEFLATED = 8;
+
+	// Zip files are always little endian
+	uint16 ReadUInt16(const uint8* Ptr)
+	{
+		return (uint16)Ptr[0] | ((uint16)Ptr[1] << 8);
+	}
+
+	uint32 ReadUInt32(const uint8* Ptr)
+	{
+		return (uint32)Ptr[0] | ((uint32)Ptr[1] << 8) | ((uint32)Ptr[2] << 16) | ((uint32)Ptr[3] << 24);
+	}
+}
+
+bool FPMXlsxZipReader::Open(TArray<uint8>&& InData, FString& OutError)
+{
+	Data = MoveTemp(InData);
+	Entries.Reset();
+
+	// The end of central directory record is at the end of the file, followed by a comment of up to 64k
+	int32 EndOfCentralDirectory = INDEX_NONE;
+	const int32 SearchStart = Data.Num() - END_OF_CENTRAL_DIRECTORY_SIZE;
+	const int32 SearchEnd = FMath::Max(0, SearchStart - (int32)MAX_uint16);
+	for (int32 Offset = SearchStart; Offset >= SearchEnd; --Offset)
+	{
+		if (ReadUInt32(&Data[Offset]) == END_OF_CENTRAL_DIRECTORY_SIGNATURE)
+		{
+			EndOfCentralDirectory = Offset;
+			break;
+		}
+	}
+
+	if (EndOfCentralDirectory == INDEX_NONE)
+	{
+		OutError = TEXT("File is not a valid xlsx file (could not find zip central directory)");
+		return false;
+	}
+
+	const uint8* EndRecord = &Data[EndOfCentralDirectory];
+	const int32 NumEntries = ReadUInt16(EndRecord + 10);
+	const uint32 CentralDirectoryOffset = ReadUInt32(EndRecord + 16);
+	if (CentralDirectoryOffset == MAX_uint32)
+	{
+		OutError = TEXT("Zip64 xlsx files are not supported");
+		return false;
+	}
+
+	int64 Offset = CentralDirectoryOffset;
+	for (int32 EntryIndex = 0; EntryIndex < NumEntries; ++EntryIndex)
+	{
+		if (Offset + CENTRAL_DIRECTORY_HEADER_SIZE > Data.Num() || ReadUInt32(&Data[Offset]) != CENTRAL_DIRECTORY_SIGNATURE)
+		{
+			OutError = TEXT("File is not a valid xlsx file (corrupt zip central directory)");
+			return false;
+		}
+
+		const uint8* Header = &Data[Offset];
+		const uint16 Flags = ReadUInt16(Header + 8);
+		const uint16 NameLength = ReadUInt16(Header + 28);
+		const uint16 ExtraLength = ReadUInt16(Header + 30);
+		const uint16 CommentLength = ReadUInt16(Header + 32);
+		if (Offset + CENTRAL_DIRECTORY_HEADER_SIZE + NameLength > Data.Num())
+		{
+			OutError = TEXT("File is not a valid xlsx file (corrupt zip central directory)");
+			return false;
+		}
+
+		FEntry Entry;
+		Entry.Method = ReadUInt16(Header + 10);
+		Entry.CompressedSize = ReadUInt32(Header + 20);
+		Entry.UncompressedSize = ReadUInt32(Header + 24);
+		Entry.LocalHeaderOffset = ReadUInt32(Header + 42);
+
+		const FUTF8ToTCHAR NameConverter((const ANSICHAR*)Header + CENTRAL_DIRECTORY_HEADER_SIZE, NameLength);
+		const FString Name(NameConverter.Length(), NameConverter.Get());
+
+		if (Flags & 0x1)
+		{
+			OutError = FString::Printf(TEXT("Encrypted xlsx files are not supported (%s is encrypted)"), *Name);
+			return false;
+		}
+
+		Entries.Add(Name, Entry);
+		Offset += CENTRAL_DIRECTORY_HEADER_SIZE + NameLength + ExtraLength + CommentLength;
+	}
+
+	return true;
+}
+
+bool FPMXlsxZipReader::Contains(const FString& EntryName) const
+{
+	return Entries.Contains(EntryName);
+}
+
+bool FPMXlsxZipReader::ReadEntry(const FString& EntryName, TArray<uint8>& OutData, FString& OutError) const
+{
+	const FEntry* Entry = Entries.Find(EntryName);
+	if (Entry == nullptr)
+	{
+		OutError = FString::Printf(TEXT("%s is missing from the xlsx file"), *EntryName);
+		return false;
+	}
+
+	const int64 LocalHeaderOffset = Entry->LocalHeaderOffset;
+	if (LocalHeaderOffset + LOCAL_HEADER_SIZE > Data.Num() || ReadUInt32(&Data[LocalHeaderOffset]) != LOCAL_HEADER_SIGNATURE)
+	{
+		OutError = FString::Printf(TEXT("Corrupt zip header for %s"), *EntryName);
+		return false;
+	}
+
+	// Sizes in the local header may be zero when a data descriptor is used, so only the name and extra lengths are read from it
+	const uint8* LocalHeader = &Data[LocalHeaderOffset];
+	const int64 DataOffset = LocalHeaderOffset + LOCAL_HEADER_SIZE + ReadUInt16(LocalHeader + 26) + ReadUInt16(LocalHeader + 28);
+	if (DataOffset + Entry->CompressedSize > Data.Num())
+	{
+		OutError = FString::Printf(TEXT("Corrupt zip data for %s"), *EntryName);
+		return false;
+	}
+
+	// Stored entries are copied as is, so both sizes must agree or the copy would read past the compressed data
+	if (Entry->UncompressedSize > static_cast<uint32>(MAX_int32) ||
+		(Entry->Method == METHOD_STORED && Entry->UncompressedSize != Entry->CompressedSize))
+	{
+		OutError = FString::Printf(TEXT("Corrupt zip sizes for %s"), *EntryName);
+		return false;
+	}
+
+	OutData.SetNumUninitialized(Entry->UncompressedSize);
+
+	if (Entry->Method == METHOD_STORED)
+	{
+		FMemory::Memcpy(OutData.GetData(), &Data[DataOffset], Entry->UncompressedSize);
+		return true;
+	}
+
+	if (Entry->Method == METHOD_DEFLATED)
+	{
+		// A negative bit window tells zlib to expect raw deflate data without a zlib header
+		if (FCompression::UncompressMemory(NAME_Zlib, OutData.GetData(), Entry->UncompressedSize, &Data[DataOffset], Entry->CompressedSize,
+			COMPRESS_NoFlags, -DEFAULT_ZLIB_BIT_WINDOW))
+		{
+			return true;
+		}
+
+		OutError = FString::Printf(TEXT("Unable to decompress %s"), *EntryName);
+		return false;
+	}
+
+	OutError = FString::Printf(TEXT("Unsupported zip compression method %i for %s"), Entry->Method, *EntryName);
+	return false;
+}
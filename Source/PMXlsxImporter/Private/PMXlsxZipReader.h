@@ -0,0 +1,33 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Minimal reader for the zip container of an xlsx file.
+ * Only supports what Excel and openpyxl write: stored or deflated entries, no encryption, no zip64.
+ */
+class FPMXlsxZipReader
+{
+public:
+	// Takes ownership of the raw bytes of a zip file and reads its central directory
+	bool Open(TArray<uint8>&& InData, FString& OutError);
+
+	bool Contains(const FString& EntryName) const;
+
+	// Decompresses the entry called EntryName (e.g. "xl/workbook.xml") into OutData
+	bool ReadEntry(const FString& EntryName, TArray<uint8>& OutData, FString& OutError) const;
+
+private:
+	struct FEntry
+	{
+		uint16 Method = 0;
+		uint32 CompressedSize = 0;
+		uint32 UncompressedSize = 0;
+		uint32 LocalHeaderOffset = 0;
+	};
+
+	TArray<uint8> Data;
+	TMap<FString, FEntry> Entries;
+};
@@ -0,0 +1,127 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+
+#include "PMXlsxZipWriter.h"
+
+#include "Misc/Compression.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+
+namespace
+{
+	constexpr uint32 END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
+	constexpr uint32 CENTRAL_DIRECTORY_SIGNATURE = 0x02014b50;
+	constexpr uint32 LOCAL_HEADER_SIGNATURE = 0x04034b50;
+
+	constexpr uint16 METHOD_STORED = 0;
+	constexpr uint16 METHOD_DEFLATED = 8;
+
+	// Version 2.0, the first one with deflate
+	constexpr uint16 ZIP_VERSION = 20;
+	// Names are UTF-8
+	constexpr uint16 FLAG_UTF8 = 1 << 11;
+
+	// Zip files are always little endian
+	void WriteUInt16(TArray<uint8>& Out, uint16 Value)
+	{
+		Out.Add(Value & 0xff);
+		Out.Add((Value >> 8) & 0xff);
+	}
+
+	void WriteUInt32(TArray<uint8>& Out, uint32 Value)
+	{
+		WriteUInt16(Out, Value & 0xffff);
+		WriteUInt16(Out, (Value >> 16) & 0xffff);
+	}
+}
+
+void FPMXlsxZipWriter::AddEntry(const FString& EntryName, const TArray<uint8>& EntryData)
+{
+	FEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Name = EntryName;
+	Entry.Crc = FCrc::MemCrc32(EntryData.GetData(), EntryData.Num());
+	Entry.UncompressedSize = EntryData.Num();
+	Entry.LocalHeaderOffset = Data.Num();
+
+	// A negative bit window makes zlib write raw deflate data without a zlib header, see FPMXlsxZipReader::ReadEntry
+	TArray<uint8> CompressedData;
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, EntryData.Num(), COMPRESS_NoFlags, -DEFAULT_ZLIB_BIT_WINDOW);
+	CompressedData.SetNumUninitialized(CompressedSize);
+	if (EntryData.Num() > 0 && FCompression::CompressMemory(NAME_Zlib, CompressedData.GetData(), CompressedSize, EntryData.GetData(), EntryData.Num(),
+		COMPRESS_NoFlags, -DEFAULT_ZLIB_BIT_WINDOW) && CompressedSize < EntryData.Num())
+	{
+		Entry.Method = METHOD_DEFLATED;
+		CompressedData.SetNum(CompressedSize);
+	}
+	else
+	{
+		Entry.Method = METHOD_STORED;
+		CompressedData = EntryData;
+	}
+	Entry.CompressedSize = CompressedData.Num();
+
+	const FTCHARToUTF8 Name(*Entry.Name);
+	WriteUInt32(Data, LOCAL_HEADER_SIGNATURE);
+	WriteUInt16(Data, ZIP_VERSION);
+	WriteUInt16(Data, FLAG_UTF8);
+	WriteUInt16(Data, Entry.Method);
+	WriteUInt32(Data, 0); // Modification time and date
+	WriteUInt32(Data, Entry.Crc);
+	WriteUInt32(Data, Entry.CompressedSize);
+	WriteUInt32(Data, Entry.UncompressedSize);
+	WriteUInt16(Data, Name.Length());
+	WriteUInt16(Data, 0); // Extra field length
+	Data.Append(reinterpret_cast<const uint8*>(Name.Get()), Name.Length());
+	Data.Append(CompressedData);
+}
+
+bool FPMXlsxZipWriter::Save(const FString& AbsoluteFilePath, FString& OutError)
+{
+	TArray<uint8> CentralDirectory;
+	for (const FEntry& Entry : Entries)
+	{
+		const FTCHARToUTF8 Name(*Entry.Name);
+		WriteUInt32(CentralDirectory, CENTRAL_DIRECTORY_SIGNATURE);
+		WriteUInt16(CentralDirectory, ZIP_VERSION); // Version made by
+		WriteUInt16(CentralDirectory, ZIP_VERSION); // Version needed to extract
+		WriteUInt16(CentralDirectory, FLAG_UTF8);
+		WriteUInt16(CentralDirectory, Entry.Method);
+		WriteUInt32(CentralDirectory, 0); // Modification time and date
+		WriteUInt32(CentralDirectory, Entry.Crc);
+		WriteUInt32(CentralDirectory, Entry.CompressedSize);
+		WriteUInt32(CentralDirectory, Entry.UncompressedSize);
+		WriteUInt16(CentralDirectory, Name.Length());
+		WriteUInt16(CentralDirectory, 0); // Extra field length
+		WriteUInt16(CentralDirectory, 0); // Comment length
+		WriteUInt16(CentralDirectory, 0); // Disk number
+		WriteUInt16(CentralDirectory, 0); // Internal attributes
+		WriteUInt32(CentralDirectory, 0); // External attributes
+		WriteUInt32(CentralDirectory, Entry.LocalHeaderOffset);
+		CentralDirectory.Append(reinterpret_cast<const uint8*>(Name.Get()), Name.Length());
+	}
+
+	if (Entries.Num() > MAX_uint16 || static_cast<int64>(Data.Num()) + CentralDirectory.Num() >= MAX_uint32)
+	{
+		OutError = FString::Printf(TEXT("%s is too big for a zip file without zip64"), *AbsoluteFilePath);
+		return false;
+	}
+
+	const uint32 CentralDirectoryOffset = Data.Num();
+	Data.Append(CentralDirectory);
+
+	WriteUInt32(Data, END_OF_CENTRAL_DIRECTORY_SIGNATURE);
+	WriteUInt16(Data, 0); // Number of this disk
+	WriteUInt16(Data, 0); // Disk with the central directory
+	WriteUInt16(Data, Entries.Num());
+	WriteUInt16(Data, Entries.Num());
+	WriteUInt32(Data, CentralDirectory.Num());
+	WriteUInt32(Data, CentralDirectoryOffset);
+	WriteUInt16(Data, 0); // Comment length
+
+	if (!FFileHelper::SaveArrayToFile(Data, *AbsoluteFilePath))
+	{
+		OutError = FString::Printf(TEXT("Unable to write file %s"), *AbsoluteFilePath);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,34 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Minimal writer for the zip container of an xlsx file, the counterpart of FPMXlsxZipReader.
+ * Entries are deflated like Excel does. No zip64, so the whole file must stay under 4 GB.
+ */
+class FPMXlsxZipWriter
+{
+public:
+	// Compresses EntryData into an entry called EntryName (e.g. "xl/workbook.xml")
+	void AddEntry(const FString& EntryName, const TArray<uint8>& EntryData);
+
+	// Writes the central directory after the entries and saves the zip file. Call once, after all entries were added.
+	bool Save(const FString& AbsoluteFilePath, FString& OutError);
+
+private:
+	struct FEntry
+	{
+		FString Name;
+		uint16 Method = 0;
+		uint32 Crc = 0;
+		uint32 CompressedSize = 0;
+		uint32 UncompressedSize = 0;
+		uint32 LocalHeaderOffset = 0;
+	};
+
+	// Local headers and data of all entries added so far
+	TArray<uint8> Data;
+	TArray<FEntry> Entries;
+};
@@ -7,6 +7,94 @@
 #include "PMXlsxImporterContextLogger.h"
 #include "PMXlsxDataAsset.generated.h"
 
+class UPMXlsxDataAsset;
+class FPMXlsxWorksheetData;
+struct FPMXlsxColumnBindings;
+
+#ifdef WITH_EDITOR
+// Copies of the properties an import can change (those marked ImportFromXLSX, and XlsxRowHash), taken before the import
+// so that UPMXlsxDataAsset::WasModified can compare them with FProperty::Identical afterwards.
+// Also holds the state written by UPMXlsxDataAsset::SerializeExtraImportState, compared byte by byte.
+// The buffer holding the copies is kept between snapshots so that it can be reused for every row of a worksheet.
+class PMXLSXIMPORTER_API FPMXlsxDataAssetSnapshot
+{
+public:
+	FPMXlsxDataAssetSnapshot() = default;
+	~FPMXlsxDataAssetSnapshot();
+
+	FPMXlsxDataAssetSnapshot(const FPMXlsxDataAssetSnapshot&) = delete;
+	FPMXlsxDataAssetSnapshot& operator=(const FPMXlsxDataAssetSnapshot&) = delete;
+
+	void Take(const UPMXlsxDataAsset& Asset);
+
+	// Destroys the copies but keeps the buffer
+	void Reset();
+
+	// Returns the first snapshotted property whose value in Asset differs from the snapshot, or nullptr if none does
+	const FProperty* FindModifiedProperty(const UPMXlsxDataAsset& Asset) const;
+
+	// True if what Asset writes in SerializeExtraImportState differs from what it wrote when the snapshot was taken
+	bool WasExtraStateModified(const UPMXlsxDataAsset& Asset) const;
+
+	// The asset of the last Take
+	const UPMXlsxDataAsset* GetAsset() const { return Asset; }
+
+private:
+	struct FPropertyCopy
+	{
+		const FProperty* Property = nullptr;
+		// Offset of the copy in Buffer
+		int32 Offset = 0;
+	};
+
+	const UPMXlsxDataAsset* Asset = nullptr;
+	// Properties snapshotted for LayoutClass, reused while assets of the same class are snapshotted
+	const UClass* LayoutClass = nullptr;
+	TArray<FPropertyCopy> Copies;
+	int32 BufferSize = 0;
+	TArray<uint8, TAlignedHeapAllocator<16>> Buffer;
+	bool bHasCopies = false;
+	TArray<uint8> ExtraState;
+	// Written by WasExtraStateModified, kept to reuse its allocation
+	mutable TArray<uint8> ComparedExtraState;
+};
+
+// The values of one XLSX row converted to the properties of an asset's class, without modifying the asset.
+// Rows are read into these on worker threads when UPMXlsxImporterSettings::bParallelParseData is set,
+// then UPMXlsxDataAsset::ImportFromStagedRow copies them into their assets on the game thread.
+class PMXLSXIMPORTER_API FPMXlsxDataAssetStagedRow
+{
+public:
+	FPMXlsxDataAssetStagedRow() = default;
+	~FPMXlsxDataAssetStagedRow();
+
+	FPMXlsxDataAssetStagedRow(const FPMXlsxDataAssetStagedRow&) = delete;
+	FPMXlsxDataAssetStagedRow& operator=(const FPMXlsxDataAssetStagedRow&) = delete;
+
+	// Converts row RowIndex of WorksheetData for Asset, reading it by column index. ColumnBindings must have been made for Asset's class,
+	// see FPMXlsxDataAssetImporterJSON::PrepareColumnBindings. Only reads Asset. Safe to call on a worker thread if Asset->CanImportInParallel()
+	void Read(UPMXlsxDataAsset& Asset, const FPMXlsxWorksheetData& WorksheetData, int32 RowIndex, const FPMXlsxColumnBindings& ColumnBindings);
+
+	void Reset();
+
+	// Copies the properties that were read into Asset, which must be the asset passed to Read.
+	// Returns false if nothing could be read.
+	bool CopyTo(UPMXlsxDataAsset& Asset) const;
+
+	const TArray<FString>& GetProblems() const { return Problems; }
+
+	// True if no property of Class needs the game thread to be read (hard object references have to be resolved there)
+	static bool CanReadInParallel(const UClass& Class);
+
+private:
+	const UClass* Class = nullptr;
+	TArray<uint8, TAlignedHeapAllocator<16>> Buffer;
+	TArray<const FProperty*> ReadProperties;
+	TArray<FString> Problems;
+	bool bWasRead = false;
+};
+#endif
+
 UCLASS()
 class PMXLSXIMPORTER_API UPMXlsxDataAsset : public UPrimaryDataAsset
 {
@@ -23,6 +111,13 @@ public:
 	UPROPERTY(EditAnywhere, Category = ImportOptions)
 	uint8 bIgnoreMissingFields : 1;
 
+#if WITH_EDITORONLY_DATA
+	// Hash of the XLSX row this asset was last imported from without errors, see FPMXlsxWorksheetData::ComputeRowHash.
+	// It's an asset registry tag so that the importer can skip unchanged rows without loading their assets.
+	UPROPERTY(AssetRegistrySearchable)
+	FString XlsxRowHash;
+#endif
+
 #ifdef WITH_EDITOR
 public:
 	// Input: A map of column headers to stringified values for each of those headers.
@@ -30,7 +125,20 @@ public:
 	// or Unreal won't be able to convert the map properly.
 	// Record all errors by adding them to InOutErrors
 	// Override this function if you want to parse non-UPROPERTY fields.
-	void ImportFromXLSX(const TSharedRef<FJsonObject>& JsonData, FPMXlsxImporterContextLogger& InOutErrors);
+	// RowHash is stored in XlsxRowHash if the row is imported without problems.
+	void ImportFromXLSX(const TSharedRef<FJsonObject>& JsonData, FPMXlsxImporterContextLogger& InOutErrors, const FString& RowHash = FString());
+
+	// Same as ImportFromXLSX, for a row that has already been converted by FPMXlsxDataAssetStagedRow::Read
+	void ImportFromStagedRow(const FPMXlsxDataAssetStagedRow& Row, FPMXlsxImporterContextLogger& InOutErrors, const FString& RowHash = FString());
+
+	// Whether rows may be converted for this asset on worker threads (see UPMXlsxImporterSettings::bParallelParseData).
+	// False by default. Override it to return true only if your subclass doesn't override ImportFromXLSXImpl or ParseValue,
+	// since staged rows skip both. Rows are always read as staged rows for these assets, straight from the worksheet data
+	// by column index, even without bParallelParseData.
+	virtual bool SupportsParallelImport() const;
+
+	// True if SupportsParallelImport and no property holds a hard object reference, which has to be resolved on the game thread
+	bool CanImportInParallel() const;
 
 	// Validate that this object has been set up correctly against both itself and the UPMXlsxDataAsset that came
 	// before it in the XLSX file.
@@ -38,10 +146,18 @@ public:
 
 protected:
 
-	// ImportFromXLSX makes a copy of this before parsing anything. This function checks if anything has changed
-	// by exporting this and the copy to text, then comparing the text results.
-	// If your subclass parses non-UPROPERTY properties, override WasModified and check those properties here.
-	virtual bool WasModified(UPMXlsxDataAsset* Original);
+	// ImportFromXLSX snapshots the ImportFromXLSX properties of this before parsing anything. This function checks if any
+	// of them, or the state written by SerializeExtraImportState, has changed by comparing them with the snapshot.
+	virtual bool WasModified(const FPMXlsxDataAssetSnapshot& Original);
+
+	// Replaced by the overload above, which doesn't need a copy of the asset. Final so that overrides fail to compile instead of
+	// no longer being called: move what they compared into SerializeExtraImportState. Still compares Original with this if called.
+	virtual bool WasModified(UPMXlsxDataAsset* Original) final;
+
+	// If your subclass sets non-UPROPERTY fields or properties without ImportFromXLSX, serialize them here.
+	// Called before and after each import to tell whether the import modified them.
+	virtual void SerializeExtraImportState(FArchive& Ar) {}
+
 	virtual void ImportFromXLSXImpl(const TSharedRef<FJsonObject>& JsonData, FPMXlsxImporterContextLogger& InOutErrors);
 	virtual void ValidateImpl(FPMXlsxImporterContextLogger& InOutErrors) const;
 	virtual void ValidateAgainstPreviousImpl(const UPMXlsxDataAsset* Previous, FPMXlsxImporterContextLogger& InOutErrors) const {}
@@ -131,5 +247,11 @@ protected:
 private:
 	// Parses an Int64 but does not add an error if it fails. Used by ParseInt and ParseEnum.
 	bool ParseInt64Internal(const FString& Value, int64& OutResult);
+
+	// Stores the pending row hash, then saves this if the import modified it. Original is the snapshot taken before the import
+	void FinishImport(FPMXlsxDataAssetSnapshot& Original, bool bWasDirty, const TArray<FString>& Problems, FPMXlsxImporterContextLogger& InOutErrors);
+
+	// RowHash of the ImportFromXLSX call in progress
+	FString PendingXlsxRowHash;
 #endif
 };
@@ -5,27 +5,159 @@
 #include "CoreMinimal.h"
 #include "PMXlsxDataAsset.h"
 
+class FPMXlsxImportValue;
+class FPMXlsxWorksheetData;
+class UDataTable;
+
+// How FPMXlsxDataAssetImporterJSON reads one property of a struct, worked out once instead of for every row
+struct FPMXlsxPropertyBinding
+{
+	FProperty* Property = nullptr;
+
+	// Name of the property in problems
+	FString ColumnName;
+
+	// Json keys the property is read from, the first one found in a row wins
+	TArray<FString> ImportNames;
+
+	// Set for DataTableImportOptional properties, which are never reported as missing
+	bool bImportOptional = false;
+
+	// Set for ImportFromXLSX properties, which are reported as missing unless the asset ignores missing fields. Rows of a DataTable
+	// report every property that isn't optional, as the table's own json import does.
+	bool bImportFromXlsx = false;
+};
+
+// A json key or column name that a property is read from
+struct FPMXlsxKeyBinding
+{
+	// Index in FPMXlsxStructBindings::Properties, INDEX_NONE for property names that aren't import names: those aren't read,
+	// but aren't unknown either
+	int32 PropertyIndex = INDEX_NONE;
+
+	// Index of the key in the property's import names. When an object has several of them, the lowest one is read.
+	int32 ImportNameIndex = 0;
+};
+
+// Bindings of all properties of a struct, in the order they're read
+struct FPMXlsxStructBindings
+{
+	explicit FPMXlsxStructBindings(const UStruct* Struct);
+
+	TArray<FPMXlsxPropertyBinding> Properties;
+
+	// Names of all properties, to find the json keys that don't match any property
+	TSet<FName> PropertyNames;
+
+	// Names and import names of all properties as they appear in a header, ignoring case like json keys do. Every key named after
+	// a property is found here with a single lookup, only other keys need to be made valid names and checked against PropertyNames.
+	TMap<FString, FPMXlsxKeyBinding> Keys;
+};
+
+// How the columns of a worksheet are read into the properties of a struct, worked out once per struct and column layout so that
+// rows are read by column index instead of looking up every property's import names in every row
+struct FPMXlsxColumnBindings
+{
+	// RowKey names the column that holds row names, which is never unknown
+	FPMXlsxColumnBindings(const FPMXlsxStructBindings& StructBindings, const FPMXlsxWorksheetData& WorksheetData, const FString& RowKey);
+
+	// For each property of FPMXlsxStructBindings::Properties, the columns it can be read from in the order of its import names.
+	// The first one that has a value in a row is read.
+	TArray<TArray<int32, TInlineAllocator<1>>> PropertyColumns;
+
+	// Column holding row names, or INDEX_NONE
+	int32 RowKeyColumn = INDEX_NONE;
+
+	// Columns that match no property, as they're named in problems
+	TArray<FName> UnknownColumnNames;
+};
+
 /**
- * 
+ * Reads a row into the properties of a UPMXlsxDataAsset, either from a json object or straight from the worksheet data.
+ * Also reads worksheet rows into the rows of a UDataTable, see ReadTableRow.
  */
 class PMXLSXIMPORTER_API FPMXlsxDataAssetImporterJSON
 {
 public:
 	FPMXlsxDataAssetImporterJSON(UPMXlsxDataAsset& InDataAsset, const TSharedRef<FJsonObject>& InJSONData, TArray<FString>& OutProblems);
 
+	// Reads row InRowIndex of InWorksheetData by column index, as InColumnBindings, made for the asset's class, bind them
+	FPMXlsxDataAssetImporterJSON(UPMXlsxDataAsset& InDataAsset, const FPMXlsxWorksheetData& InWorksheetData, int32 InRowIndex,
+		const FPMXlsxColumnBindings& InColumnBindings, TArray<FString>& OutProblems);
+
 	~FPMXlsxDataAssetImporterJSON();
 
 	bool ReadAsset();
 
+	// Reads into OutAssetData, a buffer laid out like an instance of the asset's class, instead of the asset. Each property that gets read
+	// starts from the asset's current value and is added to OutReadProperties.
+	// Only reads the asset, so this may run on a worker thread if the asset's class supports it (see UPMXlsxDataAsset::CanImportInParallel).
+	bool ReadAssetInto(void* OutAssetData, TArray<const FProperty*>& OutReadProperties);
+
+	// Makes the bindings of Struct and of the structs it contains for the current import run, if there is one.
+	// Call on the game thread before reading assets of Struct on worker threads, so that workers share them without locking.
+	static void PrepareStructBindings(const UStruct* Struct);
+
+	// Returns the bindings of the columns of WorksheetData to the properties of Struct, made once per import run, struct and
+	// column layout if there is a run. Also prepares the struct bindings of Struct. Game thread only.
+	static TSharedRef<const FPMXlsxColumnBindings> PrepareColumnBindings(const UStruct* Struct, const FPMXlsxWorksheetData& WorksheetData, const FString& RowKey);
+
+	// Reads row InRowIndex of InWorksheetData into OutRowData, an initialized instance of the row struct of InDataTable, as
+	// InColumnBindings, made for the row struct, bind them. Follows the table's settings, like UDataTable::CreateTableFromJSONString.
+	static bool ReadTableRow(const UDataTable& InDataTable, const FPMXlsxWorksheetData& InWorksheetData, int32 InRowIndex,
+		const FPMXlsxColumnBindings& InColumnBindings, void* OutRowData, TArray<FString>& OutProblems);
+
 private:
-	bool ReadStruct(const TSharedRef<FJsonObject>& InParsedObject, UStruct* InStruct, const FName InRowName, void* InStructData);
+	FPMXlsxDataAssetImporterJSON(const UDataTable& InDataTable, const FPMXlsxWorksheetData& InWorksheetData, int32 InRowIndex,
+		const FPMXlsxColumnBindings& InColumnBindings, TArray<FString>& OutProblems);
+
+	// The class of the asset, or the row struct of the table
+	const UStruct* GetRowStruct() const;
+
+	bool IgnoresExtraFields() const;
+
+	bool IgnoresMissingFields() const;
+
+	bool ReadAssetProperties(void* AssetData);
 
-	bool ReadStructEntry(const TSharedRef<FJsonValue>& InParsedPropertyValue, const FName InRowName, const FString& InColumnName, const void* InRowData, FProperty* InProperty, void* InPropertyData);
+	bool ReadJsonRow(void* AssetData);
 
-	bool ReadContainerEntry(const TSharedRef<FJsonValue>& InParsedPropertyValue, const FName InRowName, const FString& InColumnName, const int32 InArrayEntryIndex, FProperty* InProperty, void* InPropertyData);
+	bool ReadWorksheetRow(void* AssetData);
+
+	// Reads the fields of InObject that match properties of InStruct, then reports the properties it has none for
+	bool ReadStruct(const FPMXlsxImportValue& InObject, const UStruct* InStruct, const FName InRowName, void* InStructData);
+
+	// Returns false if the rest of the struct should not be read
+	bool ReadProperty(const FPMXlsxPropertyBinding& Binding, const FPMXlsxImportValue& InValue, const FName InRowName, void* InStructData);
+
+	void ReportMissingProperty(const FPMXlsxPropertyBinding& Binding, const FName InRowName);
+
+	// When staging, the asset's value of a property is copied into the staging data before the property is read
+	void PrepareStagedProperty(const FProperty* Property, void* InStructData);
+
+	// Prepared by the import run if there is one, so that they're only made once per struct. Otherwise made by this importer
+	const FPMXlsxStructBindings& GetStructBindings(const UStruct* Struct);
+
+	bool ReadStructEntry(const FPMXlsxImportValue& InParsedPropertyValue, const FName InRowName, const FString& InColumnName, const void* InRowData, FProperty* InProperty, void* InPropertyData);
+
+	bool ReadContainerEntry(const FPMXlsxImportValue& InParsedPropertyValue, const FName InRowName, const FString& InColumnName, const int32 InArrayEntryIndex, FProperty* InProperty, void* InPropertyData);
 
 	// ReSharper disable once CppUE4ProbableMemoryIssuesWithUObject
-	UPMXlsxDataAsset* DataAsset;
-	const TSharedRef<FJsonObject>& JSONData;
+	UPMXlsxDataAsset* DataAsset = nullptr;
+	// Set instead of DataAsset when reading a row of a table
+	const UDataTable* DataTable = nullptr;
 	TArray<FString>& ImportProblems;
+
+	// The row, either a json object or a row of worksheet data
+	TSharedPtr<FJsonObject> JSONData;
+	const FPMXlsxWorksheetData* WorksheetData = nullptr;
+	int32 RowIndex = INDEX_NONE;
+	const FPMXlsxColumnBindings* ColumnBindings = nullptr;
+
+	// Bindings made by this importer when the import run has none
+	TMap<const UStruct*, TUniquePtr<const FPMXlsxStructBindings>> LocalStructBindings;
+
+	// Set while ReadAssetInto runs
+	void* StagingData = nullptr;
+	TArray<const FProperty*>* StagedProperties = nullptr;
 };
@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 
 class FPMXlsxImporterContextLogger;
+class FPMXlsxWorksheetData;
 
 /**
  * 
@@ -12,7 +13,9 @@ class FPMXlsxImporterContextLogger;
 class PMXLSXIMPORTER_API FPMXlsxDataTableImportUtils
 {
 public:
-	static void ImportDataTableFromXlsx(UDataTable* DataTable, const FString JsonString, FPMXlsxImporterContextLogger& InOutErrors);
+	// Reads the rows of WorksheetData into DataTable by column index, without making json, and saves the table if any row changed
+	static void ImportDataTableFromXlsx(UDataTable* DataTable, const FPMXlsxWorksheetData& WorksheetData, FPMXlsxImporterContextLogger& InOutErrors);
 
+	// Compares the row names and the data of each row
 	static bool WasDataTableModified(UDataTable* Updated, UDataTable* Original);
 };
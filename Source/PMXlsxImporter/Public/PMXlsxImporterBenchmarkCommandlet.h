@@ -0,0 +1,31 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PMXlsxImporterBenchmarkCommandlet.generated.h"
+
+// Generates an xlsx file, imports it into UPMXlsxBenchmarkDataAsset assets and a DataTable of FPMXlsxBenchmarkTableRow,
+// then writes the throughput, peak memory and time of each import stage as json ("StageCpuSeconds" for the stages summed over threads). Needs no configured entries and no network.
+// Run using -run=PMXlsxImporterBenchmark
+// To count allocations, add -trace=default,memalloc,callstack,memtag and open the trace in Memory Insights: the import runs between
+// the "PMXlsxImporterBenchmark import started" and "import finished" bookmarks, compare the allocations made there between two builds.
+// Shape:   -Rows=N (data rows per worksheet, 1000 by default)
+//          -Columns=N (pads the worksheets with unimported "Note<i>" columns up to N columns)
+//          -SplitStructs=N (elements of the StructArray split struct array, 2 by default)
+//          -CellArray=N (elements in the CellArray cell, 4 by default)
+//          -SplitArray=N (SplitArray[<i>] columns, 4 by default, at least 1)
+//          -Tags=N (gameplay tags in the Tags cell, 2 by default)
+//          -ImportType=DataAsset|DataTable|Both (Both by default)
+// Options: -Reader=Native|Python, -PipelineDepth=N, -ParallelParseData, -JsonInterchange (override the project settings for this run)
+//          -Output=<file> (where the json goes, Saved/PMXlsxImporterBenchmark/Results.json by default)
+//          -KeepAssets (don't delete the generated xlsx file and assets at the end, the next run then imports into the kept assets)
+UCLASS()
+class UPMXlsxImporterBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+};
@@ -9,6 +9,7 @@
 // Imports all XLSX files currently configured in project settings.
 // Run using -run=PMXlsxImporter
 // Options: -c (only import XLSX files that are locally checked out in source control)
+//          -Force (also import entries that did not change since they were last imported)
 UCLASS()
 class UPMXlsxImporterCommandlet : public UCommandlet
 {
@@ -3,9 +3,15 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include <atomic>
+
+class FProperty;
 
 // In-memory collection of FStrings to be logged out later.
 // Tracks context in a stack system and prepends that context to each log.
+// May be used from several threads at once: each thread has its own context stack and error buffer. A context must be popped
+// by the thread that pushed it. Flush must not run while other threads are still logging.
 class PMXLSXIMPORTER_API FPMXlsxImporterContextLogger : public FOutputDevice
 {
 public:
@@ -16,25 +22,90 @@ public:
 	// FOutputDevice interface
 	// "Error" is the only verbosity used by this class. Category is ignored.
 	virtual void Serialize(const TCHAR* V, ELogVerbosity::Type Verbosity, const FName& Category) override;
+	// Logs the errors of all threads, sorted by the orders they were logged under (see PushOrder)
 	virtual void Flush() override;
 	virtual bool IsMemoryOnly() const override
 	{
 		return true;
 	}
+	virtual bool CanBeUsedOnMultipleThreads() const override
+	{
+		return true;
+	}
 
 	// Context is prepended to each log statement, from oldest to newest.
 	// For example: PushContext("classname"); PushContext(".propertyname"); Log("foo");
 	// will serialize "classname.propertyname foo"
 	class FPMXlsxImporterContextLoggerScopedContext PushContext(const FString& Context);
 
-	// Returns the number of errors that have been collected
+	// Cheaper than PushContext: only a pointer or an index is pushed, the text is made if something gets logged.
+	// Object must outlive the context. Adds ": <class> <name>"
+	class FPMXlsxImporterContextLoggerScopedContext PushObjectContext(const UObject& Object);
+	// Adds ".<name> <type>"
+	class FPMXlsxImporterContextLoggerScopedContext PushPropertyContext(const FProperty& Property);
+	// Adds "[<index>]"
+	class FPMXlsxImporterContextLoggerScopedContext PushIndexContext(int32 Index);
+
+	// Adds no text. Errors are flushed in the order of the orders they were logged under, outermost first, e.g. by entry and then by row,
+	// so that they come out the same no matter which thread logged them first. Errors under the same orders keep the order they were logged in.
+	class FPMXlsxImporterContextLoggerScopedContext PushOrder(int32 Order);
+
+	// Returns the number of errors that have been collected by all threads
 	int32 Num() const;
 
 private:
 	void PopContext(); // Called when a ScopedContext falls out of scope
 
-	TArray<FString> Errors;
-	TArray<FString> ContextStack;
+	struct FContextFrame
+	{
+		enum class EKind : uint8
+		{
+			String, // Index into ContextStrings
+			Object,
+			Property,
+			Index,
+			Order
+		};
+
+		EKind Kind = EKind::String;
+		int32 Index = 0;
+		const UObject* Object = nullptr;
+		const FProperty* Property = nullptr;
+	};
+
+	struct FError
+	{
+		FString Message;
+		// Index of each Order frame on the stack when the error was logged
+		TArray<int32, TInlineAllocator<4>> Orders;
+		// Across all threads, so that errors under the same orders keep the order they were logged in
+		int32 Sequence = 0;
+	};
+
+	struct FThreadState
+	{
+		// Pushing and popping doesn't allocate unless the stack gets deeper than this
+		TArray<FContextFrame, TInlineAllocator<8>> ContextStack;
+		TArray<FString> ContextStrings;
+		TArray<FError> Errors;
+	};
+
+	// Returns the state of the calling thread
+	FThreadState& GetThreadState();
+
+	class FPMXlsxImporterContextLoggerScopedContext PushFrame(const FContextFrame& Frame);
+	void AppendFrame(const FThreadState& State, const FContextFrame& Frame, FString& OutContext) const;
+
+	// State of the thread that created the logger, used without locking
+	uint32 OwnerThreadId = 0;
+	FThreadState OwnerState;
+
+	// State of every other thread that used the logger, keyed by thread id. The map is guarded by ThreadStatesCriticalSection,
+	// each state is only used by its own thread.
+	TMap<uint32, TUniquePtr<FThreadState>> ThreadStates;
+	mutable FCriticalSection ThreadStatesCriticalSection;
+
+	std::atomic<int32> NumErrors{ 0 };
 };
 
 // Object that automatically pops a FPMXlsxImporterContextLogger's context when leaving scope
@@ -30,10 +30,54 @@ public:
 	UPROPERTY(BlueprintReadWrite, Category = XlsxImporter)
 	FString JsonString;
 
+	// Base64 encoded worksheet data in the binary format described in PMXlsxWorksheetData.h. Set instead of JsonString unless json was requested
+	UPROPERTY(BlueprintReadWrite, Category = XlsxImporter)
+	FString BinaryData;
+
 	UPROPERTY(BlueprintReadWrite, Category = XlsxImporter)
 	FString Error;
 };
 
+// One worksheet to read in a UPMXlsxImporterPythonBridge::ReadWorksheets call
+USTRUCT(Blueprintable, BlueprintType)
+struct FPMXlsxImporterPythonBridgeWorksheetRequest
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintReadWrite, Category = XlsxImporter)
+	FString WorksheetName;
+
+	UPROPERTY(BlueprintReadWrite, Category = XlsxImporter)
+	int32 HeaderRow = 1;
+
+	UPROPERTY(BlueprintReadWrite, Category = XlsxImporter)
+	int32 DataStartRow = 2;
+
+	UPROPERTY(BlueprintReadWrite, Category = XlsxImporter)
+	FPMXlsxWorksheetTypeInfo WorksheetTypeInfo;
+
+	// Return the data as JsonString instead of BinaryData
+	UPROPERTY(BlueprintReadWrite, Category = XlsxImporter)
+	bool bUseJson = false;
+};
+
+USTRUCT(Blueprintable, BlueprintType)
+struct FPMXlsxImporterPythonBridgeWorksheetResult
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintReadWrite, Category = XlsxImporter)
+	FString WorksheetName;
+
+	UPROPERTY(BlueprintReadWrite, Category = XlsxImporter)
+	FPMXlsxImporterPythonBridgeAssetNames AssetNames;
+
+	UPROPERTY(BlueprintReadWrite, Category = XlsxImporter)
+	FPMXlsxImporterPythonBridgeJsonString JsonString;
+};
+
 UCLASS(Blueprintable)
 class UPMXlsxImporterPythonBridge : public UObject
 {
@@ -46,6 +90,13 @@ public:
 	// See https://forums.unrealengine.com/t/running-a-python-script-with-c/114117/3
 	static UPMXlsxImporterPythonBridge* Get(FPMXlsxImporterContextLogger* InOutErrors = nullptr);
 
+	// Workbooks opened between these calls are cached until the import run ends
+	UFUNCTION(BlueprintImplementableEvent, Category = Python)
+	void BeginImportRun();
+
+	UFUNCTION(BlueprintImplementableEvent, Category = Python)
+	void EndImportRun();
+
 	UFUNCTION(BlueprintImplementableEvent, Category = Python)
 	TArray<FString> ReadWorksheetNames(const FString& AbsoluteFilePath);
 
@@ -54,4 +105,8 @@ public:
 
 	UFUNCTION(BlueprintImplementableEvent, Category = Python)
 	FPMXlsxImporterPythonBridgeJsonString ReadWorksheetAsJson(const FString& AbsoluteFilePath, const FString& WorksheetName, int32 HeaderRow, int32 DataStartRow, const FPMXlsxWorksheetTypeInfo& WorksheetTypeInfo);
+
+	// Reads the asset names and data of several worksheets of one file in a single call. Returns one result per request, in the same order.
+	UFUNCTION(BlueprintImplementableEvent, Category = Python)
+	TArray<FPMXlsxImporterPythonBridgeWorksheetResult> ReadWorksheets(const FString& AbsoluteFilePath, const TArray<FPMXlsxImporterPythonBridgeWorksheetRequest>& Requests);
 };
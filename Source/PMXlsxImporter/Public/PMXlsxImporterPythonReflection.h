@@ -87,6 +87,10 @@ public:
 
 	void InternalReadStruct(const UStruct* InStruct, TArray<int32>& OutIndices);
 
+	// Describes the struct, every field read from the worksheet and the enums and structs their values are converted to.
+	// Changes whenever the columns or the way they are parsed change
+	FString MakeSchemaFingerprint() const;
+
 	UPROPERTY()
 	const UStruct* Struct = nullptr;
 	
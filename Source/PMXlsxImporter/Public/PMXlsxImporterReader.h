@@ -0,0 +1,40 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PMXlsxImporterPythonBridge.h"
+
+class FPMXlsxImporterContextLogger;
+
+/**
+ * Reads worksheets out of xlsx files.
+ * Implemented natively in C++ (FPMXlsxNativeReader) and by the Python subclass of UPMXlsxImporterPythonBridge.
+ */
+class PMXLSXIMPORTER_API IPMXlsxImporterReader
+{
+public:
+	virtual ~IPMXlsxImporterReader() {}
+
+	// Returns the reader selected by UPMXlsxImporterSettings::ReaderBackend, or nullptr if that reader is not available.
+	// Logs an error to InOutErrors (or the output log if InOutErrors is null) when it returns nullptr.
+	static IPMXlsxImporterReader* Get(FPMXlsxImporterContextLogger* InOutErrors = nullptr);
+
+	// Called at the start and end of an import run (see FPMXlsxImporterRunContext).
+	// Between these calls a reader may keep workbooks open and reuse them for every worksheet it reads.
+	virtual void BeginImportRun() {}
+	virtual void EndImportRun() {}
+
+	// True if ReadWorksheets may be called from worker threads, including several at once
+	virtual bool CanReadOnAnyThread() const { return false; }
+
+	virtual TArray<FString> ReadWorksheetNames(const FString& AbsoluteFilePath) = 0;
+
+	virtual FPMXlsxImporterPythonBridgeAssetNames ReadWorksheetAssetNames(const FString& AbsoluteFilePath, const FString& WorksheetName, int32 HeaderRow, int32 DataStartRow) = 0;
+
+	virtual FPMXlsxImporterPythonBridgeJsonString ReadWorksheetAsJson(const FString& AbsoluteFilePath, const FString& WorksheetName, int32 HeaderRow, int32 DataStartRow, const FPMXlsxWorksheetTypeInfo& WorksheetTypeInfo) = 0;
+
+	// Reads the asset names and data of several worksheets of one file. Returns one result per request, in the same order.
+	// The default implementation calls ReadWorksheetAssetNames and ReadWorksheetAsJson for each request, so it always returns json.
+	virtual TArray<FPMXlsxImporterPythonBridgeWorksheetResult> ReadWorksheets(const FString& AbsoluteFilePath, const TArray<FPMXlsxImporterPythonBridgeWorksheetRequest>& Requests);
+};
@@ -0,0 +1,114 @@
+﻿// Copyright Tianqi Li. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+// Parts of an import run that are timed. Each one is also a CPU trace scope named PMXlsxImporter_<Stage> in Unreal Insights.
+enum class EPMXlsxImportStage : uint8
+{
+	// Reader calls that read worksheets out of xlsx files. CPU time, see FPMXlsxImporterRunStats::IsSummedOverThreads
+	Read,
+	// Time the game thread waited for worker threads to read or decode a worksheet
+	Wait,
+	// Turning reader data into FPMXlsxWorksheetData, and rows into json objects. CPU time
+	Decode,
+	SyncAssets,
+	ParseData,
+	// Reading json rows into assets or DataTable rows. CPU time
+	ReadAsset,
+	// Comparing assets with what they were before the import
+	WasModified,
+	Validate,
+	// Saving created and modified assets
+	Save,
+	// Checking out, marking for add and deleting files
+	SourceControl,
+
+	Num
+};
+
+// Stage times measured on one thread, summed without locking and added to the run's stats at once (see FPMXlsxImporterStageTimeCollector)
+struct PMXLSXIMPORTER_API FPMXlsxImporterStageTimes
+{
+	// In FPlatformTime::Cycles64 units
+	uint64 Cycles[static_cast<int32>(EPMXlsxImportStage::Num)] = {};
+
+	void Add(const FPMXlsxImporterStageTimes& Other);
+};
+
+/**
+ * Times and counters of one import run, filled in by the run it's passed to (e.g. UPMXlsxImporterSettings::ImportAll).
+ * Stages are counted towards the entry being imported while they run, otherwise towards the run as a whole.
+ * Stages that run on worker threads (see IsSummedOverThreads) count the CPU time of all threads working on them, and stages nest
+ * (e.g. ReadAsset is part of ParseData), so the times of a row don't add up to the time of the run.
+ */
+class PMXLSXIMPORTER_API FPMXlsxImporterRunStats
+{
+public:
+	struct FEntry
+	{
+		// "<xlsx file>:<worksheet>", or "(run)" for work that is not done for a single entry
+		FString Name;
+		double StageSeconds[static_cast<int32>(EPMXlsxImportStage::Num)] = {};
+		int64 NumRows = 0;
+		// Size of the worksheet data sent by the reader, counting one byte per character
+		int64 NumBytes = 0;
+	};
+
+	FPMXlsxImporterRunStats();
+
+	FPMXlsxImporterRunStats(const FPMXlsxImporterRunStats&) = delete;
+	FPMXlsxImporterRunStats& operator=(const FPMXlsxImporterRunStats&) = delete;
+
+	// Adds an entry and returns its index. Called by the run, on the game thread.
+	int32 AddEntry(const FString& Name);
+	// Stages are counted towards this entry until it's changed, INDEX_NONE counts them towards the run.
+	// Called by the run on the game thread while no other thread is timing a stage for the previous entry.
+	void SetCurrentEntry(int32 EntryIndex);
+
+	// May be called from any thread. bForRun counts the time towards the run, for work that is not done for the current entry
+	void AddTime(EPMXlsxImportStage Stage, double Seconds, bool bForRun = false);
+	// Adds all of Times to the current entry with a single lock. May be called from any thread
+	void AddTimes(const FPMXlsxImporterStageTimes& Times);
+	void AddRows(int64 NumRows);
+	void AddBytes(int64 NumBytes);
+	void AddSavedAssets(int32 NumAssets);
+
+	// Called by the run when it ends
+	void Finish();
+
+	const TArray<FEntry>& GetEntries() const { return Entries; }
+	const FEntry& GetRun() const { return Run; }
+	// Sum of a stage over the run and all entries
+	double GetStageSeconds(EPMXlsxImportStage Stage) const;
+	int64 GetNumRows() const;
+	int64 GetNumBytes() const;
+	int32 GetNumSavedAssets() const { return NumSavedAssets; }
+	// Wall time of the run
+	double GetTotalSeconds() const { return TotalSeconds; }
+
+	static const TCHAR* GetStageName(EPMXlsxImportStage Stage);
+	// True for the stages that also run on worker threads. Their time is CPU time summed over all threads, which can exceed the
+	// wall time they took, rather than time spent on the game thread
+	static bool IsSummedOverThreads(EPMXlsxImportStage Stage);
+
+	// Logs a table of the time each stage took for each entry, with one line for the run and one for the totals.
+	// The columns of stages summed over threads are labeled CPU
+	void LogSummary() const;
+
+private:
+	// Returns the entry that stages are currently counted towards
+	FEntry& GetCurrentEntry(bool bForRun);
+
+	FEntry Run;
+	TArray<FEntry> Entries;
+	int32 CurrentEntryIndex = INDEX_NONE;
+	int32 NumSavedAssets = 0;
+
+	double StartTime = 0.0;
+	double TotalSeconds = 0.0;
+
+	FCriticalSection CriticalSection;
+};
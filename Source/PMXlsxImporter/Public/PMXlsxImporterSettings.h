@@ -5,8 +5,29 @@
 #include "Engine/DeveloperSettings.h"
 #include "PMXlsxImporterSettingsEntry.h"
 #include "PMXlsxImporterContextLogger.h"
+#include "PMXlsxImporterRunStats.h"
 #include "PMXlsxImporterSettings.generated.h"
 
+UENUM()
+enum class EPMXlsxReaderBackend : uint8
+{
+	// Read xlsx files in C++. Fast, and does not need Python or openpyxl
+	Native,
+	// Read xlsx files with the openpyxl based Python implementation in Content/Python
+	Python
+};
+
+UENUM()
+enum class EPMXlsxJsonDumpMode : uint8
+{
+	// Don't write json files
+	Off,
+	// Write condensed json
+	Compact,
+	// Write indented json, easiest to read but slowest to write
+	Pretty
+};
+
 UCLASS(config = Plugins, defaultconfig, DisplayName="XLSX Import Settings")
 class PMXLSXIMPORTER_API UPMXlsxImporterSettings : public UDeveloperSettings
 {
@@ -25,6 +46,29 @@ public:
 	UPROPERTY(EditAnywhere, Config, Category = XlsxImporter)
 	TArray<FPMXlsxImporterSettingsEntry> AssetImportSettings;
 
+	// Which implementation reads the xlsx files
+	UPROPERTY(EditAnywhere, Config, Category = XlsxImporter)
+	EPMXlsxReaderBackend ReaderBackend = EPMXlsxReaderBackend::Native;
+
+	// Pass worksheet data from the reader to the importer as json instead of the compact binary format. Slower, only useful for debugging
+	UPROPERTY(EditAnywhere, Config, Category = XlsxImporter, AdvancedDisplay)
+	bool bUseJsonInterchange = false;
+
+	// For debugging, write the data of every imported worksheet to Intermediate/XlsxJsonFiles/<xlsx file>/<worksheet>.json.
+	// Files are written in the background while the import goes on
+	UPROPERTY(EditAnywhere, Config, Category = XlsxImporter, AdvancedDisplay)
+	EPMXlsxJsonDumpMode JsonDebugDump = EPMXlsxJsonDumpMode::Off;
+
+	// Convert the rows of DataAsset worksheets to property values on worker threads. Assets are still loaded, compared and saved on the
+	// game thread. Only used for classes that opt in by overriding UPMXlsxDataAsset::SupportsParallelImport
+	UPROPERTY(EditAnywhere, Config, Category = XlsxImporter, AdvancedDisplay)
+	bool bParallelParseData = false;
+
+	// How many xlsx files are read, and how many worksheets are decoded, on worker threads ahead of the entry being imported.
+	// 0 reads every file up front on the game thread. Only the native reader reads files on worker threads, Python reads them up front
+	UPROPERTY(EditAnywhere, Config, Category = XlsxImporter, AdvancedDisplay, meta = (ClampMin = 0))
+	int32 PipelineDepth = 2;
+
 	UPROPERTY(EditAnywhere, Config, Category = XlsxImporter)
 	int32 XlsxHeaderRow = 1;
 
@@ -41,9 +85,11 @@ public:
 	UPROPERTY(EditAnywhere, Config, Category = XlsxImporter)
 	FString DataTableAssetPrefix = TEXT("DT_");
 
-	void ImportCheckedOut(FPMXlsxImporterContextLogger& InOutErrors) const;
-	void ImportAll(FPMXlsxImporterContextLogger& InOutErrors) const;
-	void ImportEntry(int32 Index, FPMXlsxImporterContextLogger& InOutErrors) const;
+	// Entries whose inputs did not change since they were last imported successfully are skipped unless bForce is true (see FPMXlsxImporterManifest)
+	// If OutStats is not null, it receives the time each stage of the run took
+	void ImportCheckedOut(FPMXlsxImporterContextLogger& InOutErrors, bool bForce = false, FPMXlsxImporterRunStats* OutStats = nullptr) const;
+	void ImportAll(FPMXlsxImporterContextLogger& InOutErrors, bool bForce = false, FPMXlsxImporterRunStats* OutStats = nullptr) const;
+	void ImportEntry(int32 Index, FPMXlsxImporterContextLogger& InOutErrors, FPMXlsxImporterRunStats* OutStats = nullptr) const;
 
 	// Unreal will call this function because FPMXlsxImporterSettingsEntry's WorksheetName UPROPERTY has the GetOptions meta tag
 	// We can't put this function on that struct because USTRUCTS can't have UFUNCTIONS, so instead it looks for this function
@@ -52,6 +98,8 @@ public:
 	TArray<FString> GetWorksheetNames() const;
 
 private:
+	void ImportEntries(const TArray<const FPMXlsxImporterSettingsEntry*>& Entries, bool bForce, FPMXlsxImporterContextLogger& InOutErrors, FPMXlsxImporterRunStats* OutStats) const;
+
 #if WITH_EDITORONLY_DATA
 	// Save off the index of the last edited SettingEntry so that when it calls GetWorksheetNames(), we know which worksheet to read
 	int32 LastEditedSettingsIndex;
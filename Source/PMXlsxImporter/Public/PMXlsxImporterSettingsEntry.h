@@ -9,6 +9,8 @@
 #include "SourceControlHelpers.h"
 #include "PMXlsxImporterSettingsEntry.generated.h"
 
+class IPMXlsxImporterReader;
+
 UENUM()
 enum class EPMXlsxImportType : uint8
 {
@@ -60,6 +62,9 @@ public:
 
 	FSourceControlState GetXlsxFileSourceControlState(bool bSilent = false) const;
 
+	// Gets a complete path in the format "C:/.../<ProjectName>/Content/<XlsxFile>"
+	FString GetXlsxAbsolutePath() const;
+
 #ifdef WITH_EDITOR
 	// This is a struct, not a UObject-derived class. This function is called by the owning UPMXlsxImporterSettings
 	// rather than directly from the Unreal editor.
@@ -68,10 +73,16 @@ public:
 
 	TArray<FString> GetWorksheetNames() const;
 
+	// Fills in what FPMXlsxImporterRunContext::PrefetchWorksheets needs to read this entry's worksheet.
+	// Returns false if the entry is not set up correctly. SyncAssets and ParseData report why.
+	bool MakeWorksheetRequest(FString& OutXlsxAbsolutePath, FPMXlsxImporterPythonBridgeWorksheetRequest& OutRequest) const;
+
 private:
+	// Uses the asset names prefetched for the current import run if there are any, otherwise reads the worksheet with Reader
+	FPMXlsxImporterPythonBridgeAssetNames ReadAssetNames(IPMXlsxImporterReader& Reader, const FString& XlsxAbsolutePath) const;
+	// Reads the worksheet with Reader. Prefetched data is taken decoded from the run instead, see FPMXlsxImporterRunContext::TakeDecodedWorksheet
+	FPMXlsxImporterPythonBridgeJsonString ReadJson(IPMXlsxImporterReader& Reader, const FString& XlsxAbsolutePath, const FPMXlsxWorksheetTypeInfo& WorksheetTypeInfo) const;
 
-	// Gets a complete path in the format "C:/.../<ProjectName>/Content/<XlsxFile>"
-	FString GetXlsxAbsolutePath() const;
 
 	// Returns "/Game/<OutputDir>", which is the format required by UEditorAssetLibrary functions
 	FString GetProjectRootOutputDir() const;
@@ -80,8 +91,9 @@ private:
 
 	UStruct* GetReflectionStruct(FPMXlsxImporterContextLogger& InOutErrors) const;
 
-	// AssetPath is from UEditorAssetLibrary::ListAssets, so format is "/Game/.../AssetName.AssetName"
-	bool ShouldAssetExist(const FString& AssetPath, const TArray<FString>& AssetNames) const;
+	// Lists the assets directly in the output dir with one asset registry query. Keyed by asset name, case-insensitively.
+	// Values are asset paths in the format "/Game/.../AssetName.AssetName"
+	TMap<FString, FString> ListOutputDirAssets() const;
 
 	FString GetDataTableName() const;
 };